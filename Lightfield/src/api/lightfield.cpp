@@ -0,0 +1,328 @@
+#include "pch.hpp"
+#include "cpu/CpuDepthEngine.hpp"
+#include "cpu/DepthQuery.hpp"
+#include "cpu/GuidedFilter.hpp"
+#include "lightfield.h"
+
+#include <deque>
+#include <future>
+
+// engine behind the handle, frames run one after another on its worker thread
+// views and outputs are only wrapped in views with the caller's pitch, nothing is copied
+struct LfEngine_T
+{
+	struct Frame
+	{
+		std::array<LfView, CameraGrid::nViews> views;
+		LfDepthOutput output;
+		std::function<void(LfResult)> onComplete;
+	};
+
+	LfEngine_T(const LfEngineDesc& desc) : width(desc.width), height(desc.height), bRefine(desc.flags & LF_ENGINE_REFINE_DEPTH)
+	{
+		if (desc.refineRadius > 0u) guidedFilter.GetParams().radius = desc.refineRadius;
+		if (desc.refineEpsilon > 0.0f) guidedFilter.GetParams().epsilon = desc.refineEpsilon;
+		if (bRefine) confidence = { width, height, Image::Format::eR32Float, std::vector<BYTE>(static_cast<size_t>(width) * height * sizeof(float)) };
+		worker = std::thread(&LfEngine_T::WorkerLoop, this);
+	}
+	~LfEngine_T()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			bRunning = false;
+		}
+		queueCondition.notify_all();
+		worker.join(); // remaining frames still complete
+	}
+	ROF_DELETE(LfEngine_T);
+
+	void Submit(Frame&& frame)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queue.push_back(std::move(frame));
+		}
+		queueCondition.notify_one();
+	}
+	void WaitIdle()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		idleCondition.wait(lock, [this] { return queue.empty() && !bActive; });
+	}
+
+	// completion callbacks run on the worker, blocking on the queue from there would never return
+	inline bool IsWorkerThread() const { return std::this_thread::get_id() == worker.get_id(); }
+
+	LfResult Fail(LfResult result, const char* message)
+	{
+		std::lock_guard<std::mutex> lock(errorMutex);
+		lastError = message;
+		return result;
+	}
+	// exceptions never cross the c boundary
+	template<typename Func>
+	LfResult Guard(Func&& func)
+	{
+		try {
+			func();
+			return LF_SUCCESS;
+		}
+		catch (const std::bad_alloc&) {
+			return Fail(LF_ERROR_OUT_OF_MEMORY, "Out of memory");
+		}
+		catch (const std::exception& e) {
+			return Fail(LF_ERROR_INTERNAL, e.what());
+		}
+		catch (...) {
+			return Fail(LF_ERROR_INTERNAL, "Unknown error");
+		}
+	}
+
+	void WorkerLoop()
+	{
+		Profiler::Get().SetThreadName("Lightfield engine");
+		while (true) {
+			Frame frame;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				queueCondition.wait(lock, [this] { return !queue.empty() || !bRunning; });
+				if (queue.empty()) break; // only stops once drained
+				frame = std::move(queue.front());
+				queue.pop_front();
+				bActive = true;
+			}
+			const LfResult result = Guard([&] { Process(frame); });
+			frame.onComplete(result);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				bActive = false;
+			}
+			idleCondition.notify_all();
+		}
+	}
+	void Process(const Frame& frame)
+	{
+		PROFILE_SCOPE("lfProcessFrame");
+		const std::array<ImageView, CameraGrid::nViews> views = WrapViews(frame.views.data());
+		const MutableImageView depth(reinterpret_cast<BYTE*>(frame.output.pDepth), width, height, Image::Format::eR32Float, frame.output.depthRowPitch);
+
+		// the refinement weighs by confidence, which goes into internal scratch if the caller did not ask for it
+		const MutableImageView confidenceView = frame.output.pConfidence
+			? MutableImageView(reinterpret_cast<BYTE*>(frame.output.pConfidence), width, height, Image::Format::eR32Float, frame.output.confidenceRowPitch)
+			: MutableImageView(confidence);
+		const bool bConfidence = frame.output.pConfidence || bRefine;
+		depthEngine.DeduceDepthFused(views, depth, bConfidence ? &confidenceView : nullptr);
+		if (bRefine) guidedFilter.Filter(views[CameraGrid::iCenterView], depth, confidenceView, depth);
+	}
+	std::array<ImageView, CameraGrid::nViews> WrapViews(const LfView* pViews) const
+	{
+		std::array<ImageView, CameraGrid::nViews> views;
+		for (UINT i = 0u; i < CameraGrid::nViews; i++) {
+			views[i] = { static_cast<const BYTE*>(pViews[i].pData), width, height, Image::Format::eBGRA8, pViews[i].rowPitch };
+		}
+		return views;
+	}
+	// copies the query results inside a rectangle into the caller's frame sized outputs
+	void CopyRegion(const LfRect& rect, const LfDepthOutput& output) const
+	{
+		const Image& depth = depthQuery.GetDepth();
+		const Image& confidence = depthQuery.GetConfidence();
+		const UINT regionWidth = std::min(rect.width, width - rect.x), regionHeight = std::min(rect.height, height - rect.y);
+		const size_t rowSize = static_cast<size_t>(regionWidth) * sizeof(float);
+		for (UINT y = rect.y; y < rect.y + regionHeight; y++) {
+			const size_t offset = (static_cast<size_t>(y) * width + rect.x) * sizeof(float);
+			memcpy(reinterpret_cast<BYTE*>(output.pDepth) + y * output.depthRowPitch + rect.x * sizeof(float), &depth.data[offset], rowSize);
+			if (!output.pConfidence) continue;
+			memcpy(reinterpret_cast<BYTE*>(output.pConfidence) + y * output.confidenceRowPitch + rect.x * sizeof(float), &confidence.data[offset], rowSize);
+		}
+	}
+	LfResult ValidateViews(const LfView* pViews, uint32_t nViews)
+	{
+		const size_t viewRowSize = static_cast<size_t>(width) * 4u;
+		if (!pViews || nViews != CameraGrid::nViews) return Fail(LF_ERROR_INVALID_ARGUMENT, "Every view of the camera grid has to be submitted");
+		for (uint32_t i = 0u; i < nViews; i++) {
+			if (!pViews[i].pData || pViews[i].rowPitch < viewRowSize) return Fail(LF_ERROR_INVALID_ARGUMENT, "View has no data or a row pitch below its width");
+		}
+		return LF_SUCCESS;
+	}
+	LfResult ValidateOutput(const LfDepthOutput* pOutput)
+	{
+		const size_t outputRowSize = static_cast<size_t>(width) * sizeof(float);
+		if (!pOutput || !pOutput->pDepth || pOutput->depthRowPitch < outputRowSize) return Fail(LF_ERROR_INVALID_ARGUMENT, "Depth output has no data or a row pitch below its width");
+		if (pOutput->pConfidence && pOutput->confidenceRowPitch < outputRowSize) return Fail(LF_ERROR_INVALID_ARGUMENT, "Confidence output has a row pitch below its width");
+		return LF_SUCCESS;
+	}
+	LfResult Validate(const LfView* pViews, uint32_t nViews, const LfDepthOutput* pOutput)
+	{
+		const LfResult result = ValidateViews(pViews, nViews);
+		return result == LF_SUCCESS ? ValidateOutput(pOutput) : result;
+	}
+	Frame CreateFrame(const LfView* pViews, const LfDepthOutput* pOutput)
+	{
+		Frame frame;
+		std::copy_n(pViews, CameraGrid::nViews, frame.views.begin());
+		frame.output = *pOutput;
+		return frame;
+	}
+
+	const UINT width, height;
+	const bool bRefine;
+	CpuDepthEngine depthEngine;
+	GuidedFilter guidedFilter;
+	Image confidence; // only for refinement without a confidence output
+
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable queueCondition, idleCondition;
+	std::deque<Frame> queue;
+	bool bRunning = true, bActive = false;
+
+	std::mutex errorMutex;
+	std::string lastError;
+
+	// sparse queries run on the calling threads, one at a time
+	std::mutex queryMutex;
+	DepthQuery depthQuery;
+	bool bQueryFrame = false;
+};
+
+extern "C" {
+
+LF_API uint32_t lfGetApiVersion(void)
+{
+	return LF_API_VERSION;
+}
+LF_API const char* lfGetResultString(LfResult result)
+{
+	switch (result)
+	{
+		case LF_SUCCESS: return "Success";
+		case LF_ERROR_INVALID_ARGUMENT: return "Invalid argument";
+		case LF_ERROR_UNSUPPORTED: return "Unsupported";
+		case LF_ERROR_OUT_OF_MEMORY: return "Out of memory";
+		case LF_ERROR_INTERNAL: return "Internal error";
+		case LF_ERROR_WORKER_THREAD: return "Called from the worker thread";
+	}
+	return "Unknown result";
+}
+
+LF_API LfResult lfCreateEngine(const LfEngineDesc* pDesc, LfEngine* pEngine)
+{
+	if (!pDesc || !pEngine) return LF_ERROR_INVALID_ARGUMENT;
+	*pEngine = nullptr;
+	if (pDesc->apiVersion != LF_API_VERSION || pDesc->nViewsPerAxis != CameraGrid::nViewsPerAxis) return LF_ERROR_UNSUPPORTED;
+	if (pDesc->width == 0u || pDesc->height == 0u || pDesc->refineRadius > 32u) return LF_ERROR_INVALID_ARGUMENT;
+	try {
+		*pEngine = new LfEngine_T(*pDesc);
+		return LF_SUCCESS;
+	}
+	catch (const std::bad_alloc&) {
+		return LF_ERROR_OUT_OF_MEMORY;
+	}
+	catch (...) {
+		return LF_ERROR_INTERNAL;
+	}
+}
+LF_API void lfDestroyEngine(LfEngine engine)
+{
+	if (engine && engine->IsWorkerThread()) {
+		engine->Fail(LF_ERROR_WORKER_THREAD, "Engines cannot be destroyed from their completion callbacks");
+		return;
+	}
+	delete engine;
+}
+
+LF_API LfResult lfProcessFrame(LfEngine engine, const LfView* pViews, uint32_t nViews, const LfDepthOutput* pOutput)
+{
+	if (!engine) return LF_ERROR_INVALID_ARGUMENT;
+	if (engine->IsWorkerThread()) return engine->Fail(LF_ERROR_WORKER_THREAD, "Frames cannot be processed from completion callbacks, submit them instead");
+	const LfResult validation = engine->Validate(pViews, nViews, pOutput);
+	if (validation != LF_SUCCESS) return validation;
+
+	// goes through the queue as well, so it never races a submitted frame for the engine's scratch
+	std::promise<LfResult> promise;
+	std::future<LfResult> future = promise.get_future();
+	const LfResult result = engine->Guard([&] {
+		LfEngine_T::Frame frame = engine->CreateFrame(pViews, pOutput);
+		frame.onComplete = [&promise](LfResult result) { promise.set_value(result); };
+		engine->Submit(std::move(frame));
+	});
+	return result == LF_SUCCESS ? future.get() : result;
+}
+LF_API LfResult lfSubmitFrame(LfEngine engine, const LfView* pViews, uint32_t nViews, const LfDepthOutput* pOutput, LfCompletionCallback callback, void* pUserData)
+{
+	if (!engine) return LF_ERROR_INVALID_ARGUMENT;
+	const LfResult validation = engine->Validate(pViews, nViews, pOutput);
+	if (validation != LF_SUCCESS) return validation;
+	return engine->Guard([&] {
+		LfEngine_T::Frame frame = engine->CreateFrame(pViews, pOutput);
+		frame.onComplete = [callback, pUserData](LfResult result) { if (callback) callback(result, pUserData); };
+		engine->Submit(std::move(frame));
+	});
+}
+LF_API LfResult lfWaitIdle(LfEngine engine)
+{
+	if (!engine) return LF_ERROR_INVALID_ARGUMENT;
+	if (engine->IsWorkerThread()) return engine->Fail(LF_ERROR_WORKER_THREAD, "Completion callbacks cannot wait for the engine to become idle");
+	return engine->Guard([&] { engine->WaitIdle(); });
+}
+
+LF_API LfResult lfBeginQueryFrame(LfEngine engine, const LfView* pViews, uint32_t nViews)
+{
+	if (!engine) return LF_ERROR_INVALID_ARGUMENT;
+	const LfResult validation = engine->ValidateViews(pViews, nViews);
+	if (validation != LF_SUCCESS) return validation;
+	std::lock_guard<std::mutex> lock(engine->queryMutex);
+	return engine->Guard([&] {
+		engine->depthQuery.BeginFrame(engine->WrapViews(pViews));
+		engine->bQueryFrame = true;
+	});
+}
+LF_API LfResult lfQueryRegions(LfEngine engine, const LfRect* pRects, uint32_t nRects, const LfDepthOutput* pOutput)
+{
+	if (!engine) return LF_ERROR_INVALID_ARGUMENT;
+	if (!pRects && nRects > 0u) return engine->Fail(LF_ERROR_INVALID_ARGUMENT, "Regions are missing");
+	const LfResult validation = engine->ValidateOutput(pOutput);
+	if (validation != LF_SUCCESS) return validation;
+	std::lock_guard<std::mutex> lock(engine->queryMutex);
+	if (!engine->bQueryFrame) return engine->Fail(LF_ERROR_INVALID_ARGUMENT, "Queries need the views of a frame first");
+	for (uint32_t i = 0u; i < nRects; i++) {
+		if (pRects[i].x >= engine->width || pRects[i].y >= engine->height) return engine->Fail(LF_ERROR_INVALID_ARGUMENT, "Queried rectangle lies outside the frame");
+	}
+	return engine->Guard([&] {
+		std::vector<DepthQuery::Rect> rects(nRects);
+		for (uint32_t i = 0u; i < nRects; i++) rects[i] = { pRects[i].x, pRects[i].y, pRects[i].width, pRects[i].height };
+		engine->depthQuery.Evaluate(rects.data(), rects.size());
+		for (uint32_t i = 0u; i < nRects; i++) engine->CopyRegion(pRects[i], *pOutput);
+	});
+}
+LF_API LfResult lfQueryPixels(LfEngine engine, const LfPixel* pPixels, uint32_t nPixels, float* pDepth, float* pConfidence)
+{
+	if (!engine) return LF_ERROR_INVALID_ARGUMENT;
+	if ((!pPixels || !pDepth) && nPixels > 0u) return engine->Fail(LF_ERROR_INVALID_ARGUMENT, "Pixels or their depth output are missing");
+	std::lock_guard<std::mutex> lock(engine->queryMutex);
+	if (!engine->bQueryFrame) return engine->Fail(LF_ERROR_INVALID_ARGUMENT, "Queries need the views of a frame first");
+	for (uint32_t i = 0u; i < nPixels; i++) {
+		if (pPixels[i].x >= engine->width || pPixels[i].y >= engine->height) return engine->Fail(LF_ERROR_INVALID_ARGUMENT, "Queried pixel lies outside the frame");
+	}
+	return engine->Guard([&] {
+		std::vector<DepthQuery::Pixel> pixels(nPixels);
+		for (uint32_t i = 0u; i < nPixels; i++) pixels[i] = { pPixels[i].x, pPixels[i].y };
+		engine->depthQuery.Evaluate(pixels.data(), pixels.size());
+		for (uint32_t i = 0u; i < nPixels; i++) {
+			pDepth[i] = engine->depthQuery.GetDepth(pPixels[i].x, pPixels[i].y);
+			if (pConfidence) pConfidence[i] = engine->depthQuery.GetConfidence(pPixels[i].x, pPixels[i].y);
+		}
+	});
+}
+
+LF_API const char* lfGetLastError(LfEngine engine)
+{
+	if (!engine) return "";
+	static thread_local std::string message;
+	std::lock_guard<std::mutex> lock(engine->errorMutex);
+	message = engine->lastError;
+	return message.c_str();
+}
+
+}
\ No newline at end of file
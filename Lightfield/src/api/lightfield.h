@@ -0,0 +1,109 @@
+#pragma once
+
+// c interface of the cpu depth engine, built as the lightfield shared library
+// views are read where the caller keeps them and results are written straight into caller memory
+// every function returns instead of throwing, failures come back as LfResult with a message from lfGetLastError
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+	#ifdef LIGHTFIELD_EXPORTS
+		#define LF_API __declspec(dllexport)
+	#else
+		#define LF_API __declspec(dllimport)
+	#endif
+#else
+	#define LF_API __attribute__((visibility("default")))
+#endif
+
+// bumped whenever a struct or signature below changes
+#define LF_API_VERSION 1u
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct LfEngine_T* LfEngine;
+
+typedef enum LfResult {
+	LF_SUCCESS = 0,
+	LF_ERROR_INVALID_ARGUMENT = -1,
+	LF_ERROR_UNSUPPORTED = -2, // api version or camera grid this build was not made for
+	LF_ERROR_OUT_OF_MEMORY = -3,
+	LF_ERROR_INTERNAL = -4,
+	LF_ERROR_WORKER_THREAD = -5 // a blocking call was made from a completion callback, it would wait on itself
+} LfResult;
+
+typedef enum LfEngineFlagBits {
+	LF_ENGINE_REFINE_DEPTH = 0x1 // guided filter on the deduced depth, with the center view as guide
+} LfEngineFlagBits;
+
+typedef struct LfEngineDesc {
+	uint32_t apiVersion; // LF_API_VERSION of the header the caller was built with
+	uint32_t width, height; // of every view
+	uint32_t nViewsPerAxis; // the camera grid is square, 3 in this build
+	uint32_t flags; // LfEngineFlagBits
+	uint32_t refineRadius; // 0 keeps the default
+	float refineEpsilon; // 0 keeps the default
+} LfEngineDesc;
+
+// 8-bit bgra texels, rows are rowPitch bytes apart
+typedef struct LfView {
+	const void* pData;
+	size_t rowPitch;
+} LfView;
+
+// caller owned single channel floats, rows are rowPitch bytes apart, confidence may be left null
+// depth is the texel shift between neighbouring views, confidence grows with the texture the estimate is based on
+typedef struct LfDepthOutput {
+	float* pDepth;
+	size_t depthRowPitch;
+	float* pConfidence;
+	size_t confidenceRowPitch;
+} LfDepthOutput;
+
+typedef struct LfRect {
+	uint32_t x, y, width, height;
+} LfRect;
+
+typedef struct LfPixel {
+	uint32_t x, y;
+} LfPixel;
+
+// runs on the engine's worker thread once the outputs of the frame are written
+// submitting and querying from it is fine, lfProcessFrame and lfWaitIdle fail with LF_ERROR_WORKER_THREAD and lfDestroyEngine is ignored
+typedef void (*LfCompletionCallback)(LfResult result, void* pUserData);
+
+LF_API uint32_t lfGetApiVersion(void);
+LF_API const char* lfGetResultString(LfResult result);
+
+LF_API LfResult lfCreateEngine(const LfEngineDesc* pDesc, LfEngine* pEngine);
+// finishes all submitted frames first, has to be called from outside the completion callbacks
+LF_API void lfDestroyEngine(LfEngine engine);
+
+// views in camera grid order, view i sits at grid cell (i / nViewsPerAxis, i % nViewsPerAxis)
+// blocks until the outputs are written
+LF_API LfResult lfProcessFrame(LfEngine engine, const LfView* pViews, uint32_t nViews, const LfDepthOutput* pOutput);
+// returns right away, frames run in submission order and views and outputs have to stay valid until the callback
+LF_API LfResult lfSubmitFrame(LfEngine engine, const LfView* pViews, uint32_t nViews, const LfDepthOutput* pOutput, LfCompletionCallback callback, void* pUserData);
+// blocks until every submitted frame has completed
+LF_API LfResult lfWaitIdle(LfEngine engine);
+
+// sparse queries for consumers that only need depth in a few places, detections or picked pixels for example
+// only the tiles under the queried regions are computed, and kept for later queries until the next frame begins
+// results match lfProcessFrame without LF_ENGINE_REFINE_DEPTH, the refinement needs the whole frame
+// views have to stay valid until the next lfBeginQueryFrame, queries run on the calling thread independent of submitted frames
+// rectangles and pixels have to start inside the frame, otherwise nothing is computed and LF_ERROR_INVALID_ARGUMENT is returned
+LF_API LfResult lfBeginQueryFrame(LfEngine engine, const LfView* pViews, uint32_t nViews);
+// outputs are frame sized like for lfProcessFrame, only texels inside the rectangles are written, rectangles reaching past the edges are clipped
+LF_API LfResult lfQueryRegions(LfEngine engine, const LfRect* pRects, uint32_t nRects, const LfDepthOutput* pOutput);
+// one depth per pixel, confidence may be left null
+LF_API LfResult lfQueryPixels(LfEngine engine, const LfPixel* pPixels, uint32_t nPixels, float* pDepth, float* pConfidence);
+
+// message of the last failure on this engine, valid until the calling thread asks again
+LF_API const char* lfGetLastError(LfEngine engine);
+
+#ifdef __cplusplus
+}
+#endif
\ No newline at end of file
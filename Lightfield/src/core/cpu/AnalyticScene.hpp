@@ -0,0 +1,133 @@
+#pragma once
+
+#include <limits>
+#include "cpu/Math.hpp"
+
+// scene made of analytic primitives, ray cast by the cpu backend instead of rasterizing meshes
+// primitives match the generated meshes: unit radius sphere, unit cube and unit quad facing -z
+class AnalyticScene
+{
+public:
+	enum class Shape : UINT { eCube, eSphere, eQuad };
+	struct Object
+	{
+		Shape shape;
+		Float3 position, rotation, scale = { 1.0f, 1.0f, 1.0f }; // rotation as pitch, yaw, roll
+		Float3 color = { 1.0f, 1.0f, 1.0f };
+		float checker = 0.0f; // checker cells per local unit, zero for a plain color
+
+		// cached on Add()
+		Mat3 rot, invRot;
+	};
+	struct Hit
+	{
+		float t; // ray parameter, not normalized
+		Float3 normal; // world space
+		Float3 color;
+	};
+
+public:
+	AnalyticScene() = default;
+	~AnalyticScene() = default;
+	ROF_DELETE(AnalyticScene);
+
+public:
+	void Add(Object object)
+	{
+		object.rot = Mat3::FromEuler(object.rotation.x, object.rotation.y, object.rotation.z);
+		object.invRot = object.rot.Transposed();
+		objects.push_back(object);
+	}
+	inline void Clear() { objects.clear(); }
+	inline std::vector<Object>& GetObjects() { return objects; }
+
+	// closest hit in front of the origin
+	bool Intersect(const Float3& origin, const Float3& dir, Hit& hit) const
+	{
+		hit.t = std::numeric_limits<float>::max();
+		bool bHit = false;
+		for (const auto& object : objects) {
+			// into local space, the direction is left unnormalized so t stays the same in both spaces
+			const Float3 localOrigin = object.invRot.Transform(origin - object.position) / object.scale;
+			const Float3 localDir = object.invRot.Transform(dir) / object.scale;
+
+			float t;
+			Float3 localNormal;
+			if (!IntersectLocal(object.shape, localOrigin, localDir, t, localNormal) || t >= hit.t) continue;
+
+			// normals go through the model matrix as in the forward shader
+			hit.t = t;
+			hit.normal = Float3::Normalize(object.rot.Transform(localNormal * object.scale));
+			hit.color = object.color;
+			if (object.checker > 0.0f) {
+				const Float3 p = (localOrigin + localDir * t) * object.checker;
+				const int parity = static_cast<int>(std::floor(p.x) + std::floor(p.y) + (object.shape == Shape::eQuad ? 0.0f : std::floor(p.z)));
+				if (parity & 1) hit.color = hit.color * .25f;
+			}
+			bHit = true;
+		}
+		return bHit;
+	}
+
+private:
+	static bool IntersectLocal(Shape shape, const Float3& o, const Float3& d, float& t, Float3& normal)
+	{
+		switch (shape)
+		{
+			case Shape::eSphere:
+			{
+				const float a = Float3::Dot(d, d);
+				const float b = Float3::Dot(o, d);
+				const float c = Float3::Dot(o, o) - 1.0f;
+				const float disc = b * b - a * c;
+				if (disc < 0.0f) return false;
+				const float root = std::sqrt(disc);
+				t = (-b - root) / a;
+				if (t <= 0.0f) t = (-b + root) / a;
+				if (t <= 0.0f) return false;
+				normal = o + d * t;
+				return true;
+			}
+			case Shape::eCube:
+			{
+				// slabs, the normal belongs to the axis entered last
+				float tNear = -std::numeric_limits<float>::max(), tFar = std::numeric_limits<float>::max();
+				UINT iNear = 0u, iFar = 0u;
+				const float origin[3] = { o.x, o.y, o.z }, dir[3] = { d.x, d.y, d.z };
+				for (UINT i = 0u; i < 3u; i++) {
+					if (dir[i] == 0.0f) {
+						if (std::abs(origin[i]) > .5f) return false;
+						continue;
+					}
+					float t0 = (-.5f - origin[i]) / dir[i], t1 = (.5f - origin[i]) / dir[i];
+					if (t0 > t1) std::swap(t0, t1);
+					if (t0 > tNear) { tNear = t0; iNear = i; }
+					if (t1 < tFar) { tFar = t1; iFar = i; }
+				}
+				if (tNear > tFar || tFar <= 0.0f) return false;
+				const bool bInside = tNear <= 0.0f;
+				t = bInside ? tFar : tNear;
+				const UINT axis = bInside ? iFar : iNear;
+				const float p[3] = { o.x + d.x * t, o.y + d.y * t, o.z + d.z * t };
+				float n[3] = { 0.0f, 0.0f, 0.0f };
+				n[axis] = p[axis] > 0.0f ? 1.0f : -1.0f;
+				normal = { n[0], n[1], n[2] };
+				return true;
+			}
+			case Shape::eQuad:
+			{
+				if (d.z == 0.0f) return false;
+				t = -o.z / d.z;
+				if (t <= 0.0f) return false;
+				const Float3 p = o + d * t;
+				if (std::abs(p.x) > .5f || std::abs(p.y) > .5f) return false;
+				normal = { 0.0f, 0.0f, -1.0f }; // no culling, both sides share the normal
+				return true;
+			}
+		}
+		return false;
+	}
+
+private:
+	std::vector<Object> objects;
+};
\ No newline at end of file
@@ -0,0 +1,304 @@
+#pragma once
+
+#include "pipeline/CameraGrid.hpp"
+
+// cpu version of GradientsPS, DepthDeductionPS and FusedDepthCS
+// the 4d gradient filters are separable, so each view gets two 1d passes over x and y instead of 81 taps per pixel
+// the unfused gradients work on luma packed once up front, so the filters stream through contiguous rows instead of 9 bgra images
+class CpuDepthEngine
+{
+public:
+	static constexpr UINT tileSize = 32u; // of the fused depth, small enough for the gradient scratch to stay in l1
+
+public:
+	CpuDepthEngine() = default;
+	~CpuDepthEngine() = default;
+	ROF_DELETE(CpuDepthEngine);
+
+public:
+	// views are bgra8 images laid out as in the camera grid, view index = u * 3 + v
+	// gradients receive Lx, Ly, Lu, Lv per pixel as a 4 channel float image of the same size
+	void ComputeGradients(const std::array<ImageView, CameraGrid::nViews>& views, Image& gradients)
+	{
+		PROFILE_SCOPE("CpuDepthEngine::ComputeGradients");
+		const UINT width = gradients.width, height = gradients.height;
+		if (gradients.format != Image::Format::eR32G32B32A32Float) throw std::runtime_error("Gradients need a 4 channel float image");
+		for (const ImageView& view : views) {
+			if (view.width != width || view.height != height || view.format != Image::Format::eBGRA8) throw std::runtime_error("View does not match the gradients layout");
+		}
+		Resize(width, height);
+		PackLuma(views, width, height);
+
+		// x pass on the luma of every view, smoothed and derived, into row interleaved planes like the luma
+		// the border pixels are split off so the inner loop is branch free and vectorizes
+		ParallelFor(0u, height, [&](size_t y) {
+			for (UINT iView = 0u; iView < CameraGrid::nViews; iView++) {
+				const size_t iRow = (y * CameraGrid::nViews + iView) * width;
+				const float* pLuma = &luma[iRow];
+				float* pP = &prefiltered[iRow];
+				float* pD = &derived[iRow];
+				for (size_t x = 0u; x < width; x += std::max<size_t>(width - 1u, 1u)) {
+					// out of bounds loads return zero
+					float sumP = 0.0f, sumD = 0.0f;
+					for (int i = 0; i < 3; i++) {
+						const int64_t sx = static_cast<int64_t>(x) + i - 1;
+						if (sx < 0 || sx >= static_cast<int64_t>(width)) continue;
+						sumP += p[i] * pLuma[sx];
+						sumD += d[i] * pLuma[sx];
+					}
+					pP[x] = sumP;
+					pD[x] = sumD;
+				}
+				for (size_t x = 1u; x + 1u < width; x++) {
+					pP[x] = p[0] * pLuma[x - 1u] + p[1] * pLuma[x] + p[2] * pLuma[x + 1u];
+					pD[x] = d[0] * pLuma[x - 1u] + d[1] * pLuma[x] + d[2] * pLuma[x + 1u];
+				}
+			}
+		});
+
+		// y pass, the gradients of a row are accumulated over all views in cache resident rows and interleaved once at the end
+		float* pGradients = reinterpret_cast<float*>(gradients.data.data());
+		ParallelFor(0u, height, [&](size_t y) {
+			ScopedArena arena;
+			ArenaVector<float> rows(static_cast<size_t>(width) * 4u, 0.0f); // Lx, Ly, Lu, Lv one after another
+			float* pLx = &rows[0u];
+			float* pLy = &rows[width];
+			float* pLu = &rows[2u * width];
+			float* pLv = &rows[3u * width];
+			const bool bInner = y > 0u && y + 1u < height;
+			for (UINT iView = 0u; iView < CameraGrid::nViews; iView++) {
+				const float pu = p[iView / CameraGrid::nViewsPerAxis], pv = p[iView % CameraGrid::nViewsPerAxis];
+				const float du = d[iView / CameraGrid::nViewsPerAxis], dv = d[iView % CameraGrid::nViewsPerAxis];
+				const float wXY = pu * pv, wU = du * pv, wV = pu * dv;
+				if (bInner) {
+					const size_t i0 = ((y - 1u) * CameraGrid::nViews + iView) * width, rowStride = static_cast<size_t>(CameraGrid::nViews) * width;
+					const float* pD0 = &derived[i0];
+					const float* pD1 = pD0 + rowStride;
+					const float* pD2 = pD1 + rowStride;
+					const float* pP0 = &prefiltered[i0];
+					const float* pP1 = pP0 + rowStride;
+					const float* pP2 = pP1 + rowStride;
+					for (size_t x = 0u; x < width; x++) {
+						const float dxpy = p[0] * pD0[x] + p[1] * pD1[x] + p[2] * pD2[x];
+						const float pxdy = d[0] * pP0[x] + d[1] * pP1[x] + d[2] * pP2[x];
+						const float pxpy = p[0] * pP0[x] + p[1] * pP1[x] + p[2] * pP2[x];
+						pLx[x] += wXY * dxpy;
+						pLy[x] += wXY * pxdy;
+						pLu[x] += wU * pxpy;
+						pLv[x] += wV * pxpy;
+					}
+					continue;
+				}
+				// first and last row, out of bounds rows count as zero
+				for (size_t x = 0u; x < width; x++) {
+					float dxpy = 0.0f, pxdy = 0.0f, pxpy = 0.0f;
+					for (int j = 0; j < 3; j++) {
+						const int64_t sy = static_cast<int64_t>(y) + j - 1;
+						if (sy < 0 || sy >= static_cast<int64_t>(height)) continue;
+						const size_t i = (static_cast<size_t>(sy) * CameraGrid::nViews + iView) * width + x;
+						dxpy += p[j] * derived[i];
+						pxdy += d[j] * prefiltered[i];
+						pxpy += p[j] * prefiltered[i];
+					}
+					pLx[x] += wXY * dxpy;
+					pLy[x] += wXY * pxdy;
+					pLu[x] += wU * pxpy;
+					pLv[x] += wV * pxpy;
+				}
+			}
+			float* pRow = &pGradients[y * width * 4u];
+			for (size_t x = 0u; x < width; x++) {
+				pRow[x * 4u + 0u] = pLx[x];
+				pRow[x * 4u + 1u] = pLy[x];
+				pRow[x * 4u + 2u] = pLu[x];
+				pRow[x * 4u + 3u] = pLv[x];
+			}
+		});
+	}
+	// least squares depth over a 3x3 window of gradients, pixels without any spatial gradient get zero
+	// confidence is optional and grows with the spatial gradient energy the estimate is based on
+	void DeduceDepth(const Image& gradients, Image& depth, Image* pConfidence = nullptr)
+	{
+		PROFILE_SCOPE("CpuDepthEngine::DeduceDepth");
+		const UINT width = gradients.width, height = gradients.height;
+		if (depth.width != width || depth.height != height || depth.format != Image::Format::eR32Float) throw std::runtime_error("Depth does not match the gradients layout");
+		const float* pGradients = reinterpret_cast<const float*>(gradients.data.data());
+		float* pDepth = reinterpret_cast<float*>(depth.data.data());
+		float* pConfidenceData = GetConfidenceData(pConfidence, width, height);
+		ParallelFor(0u, height, [&](size_t y) {
+			for (size_t x = 0u; x < width; x++) {
+				float a = 0.0f, b = 0.0f;
+				for (int64_t sy = static_cast<int64_t>(y) - 1; sy <= static_cast<int64_t>(y) + 1; sy++) {
+					if (sy < 0 || sy >= static_cast<int64_t>(height)) continue;
+					for (int64_t sx = static_cast<int64_t>(x) - 1; sx <= static_cast<int64_t>(x) + 1; sx++) {
+						if (sx < 0 || sx >= static_cast<int64_t>(width)) continue;
+						const float* g = &pGradients[(sy * width + sx) * 4u];
+						a += g[0] * g[2] + g[1] * g[3];
+						b += g[0] * g[0] + g[1] * g[1];
+					}
+				}
+				pDepth[y * width + x] = b > 0.0f ? a / b : 0.0f;
+				if (pConfidenceData) pConfidenceData[y * width + x] = GetConfidence(b);
+			}
+		});
+	}
+
+	// both of the above per tile, gradients of a tile plus its 1 pixel halo stay in a small cache resident scratch
+	// gives the same result without ever writing the 16 bytes per pixel gradient image
+	void DeduceDepthFused(const std::array<ImageView, CameraGrid::nViews>& views, Image& depth, Image* pConfidence = nullptr)
+	{
+		const MutableImageView confidenceView = pConfidence ? MutableImageView(*pConfidence) : MutableImageView();
+		DeduceDepthFused(views, MutableImageView(depth), pConfidence ? &confidenceView : nullptr);
+	}
+	// same on outputs owned by someone else, rows may be padded
+	void DeduceDepthFused(const std::array<ImageView, CameraGrid::nViews>& views, const MutableImageView& depth, const MutableImageView* pConfidence = nullptr)
+	{
+		PROFILE_SCOPE("CpuDepthEngine::DeduceDepthFused");
+		const UINT width = depth.width, height = depth.height;
+		if (depth.format != Image::Format::eR32Float) throw std::runtime_error("Depth needs a single channel float image");
+		if (pConfidence && (pConfidence->width != width || pConfidence->height != height || pConfidence->format != Image::Format::eR32Float)) throw std::runtime_error("Confidence does not match the depth layout");
+		for (const ImageView& view : views) {
+			if (view.width != width || view.height != height || view.format != Image::Format::eBGRA8) throw std::runtime_error("View does not match the depth layout");
+		}
+
+		ParallelForTiles(width, height, tileSize, [&](UINT tileX0, UINT tileY0, UINT tileX1, UINT tileY1) {
+			DeduceDepthTile(views, tileX0, tileY0, tileX1, tileY1, depth, pConfidence);
+		});
+	}
+	// fused depth of one tile at most tileSize wide and high, written into full size depth and confidence of the views' size
+	// every pixel only depends on the views, so any set of tiles matches the same tiles of a full frame
+	void DeduceDepthTile(const std::array<ImageView, CameraGrid::nViews>& views, UINT tileX0, UINT tileY0, UINT tileX1, UINT tileY1, const MutableImageView& depth, const MutableImageView* pConfidence) const
+	{
+		const UINT width = views[CameraGrid::iCenterView].width, height = views[CameraGrid::iCenterView].height;
+		// scratch lives on the stack, about 30 KiB
+		std::array<float, gradSize * gradSize * 4u> tileGradients; // Lx, Ly, Lu, Lv
+		std::array<float, (gradSize + 2u) * gradSize> tilePrefiltered, tileDerived;
+		std::array<float, gradSize + 2u> lumaRow;
+		tileGradients.fill(0.0f);
+
+		// gradient region is the tile plus halo, clipped to the image since outside gradients count as zero
+		const int64_t tileX = tileX0, tileY = tileY0;
+		const int64_t gx0 = std::max<int64_t>(tileX - 1, 0), gx1 = std::min<int64_t>(tileX + tileSize + 1, width);
+		const int64_t gy0 = std::max<int64_t>(tileY - 1, 0), gy1 = std::min<int64_t>(tileY + tileSize + 1, height);
+		const size_t nCols = static_cast<size_t>(gx1 - gx0);
+
+		for (UINT iView = 0u; iView < CameraGrid::nViews; iView++) {
+			const ImageView& view = views[iView];
+			const float pu = p[iView / CameraGrid::nViewsPerAxis], pv = p[iView % CameraGrid::nViewsPerAxis];
+			const float du = d[iView / CameraGrid::nViewsPerAxis], dv = d[iView % CameraGrid::nViewsPerAxis];
+
+			// x pass over the gradient columns, one extra row above and below for the y pass
+			for (int64_t sy = gy0 - 1; sy <= gy1; sy++) {
+				float* pP = &tilePrefiltered[static_cast<size_t>(sy - gy0 + 1) * gradSize];
+				float* pD = &tileDerived[static_cast<size_t>(sy - gy0 + 1) * gradSize];
+				if (sy < 0 || sy >= static_cast<int64_t>(height)) {
+					std::fill(pP, pP + nCols, 0.0f);
+					std::fill(pD, pD + nCols, 0.0f);
+					continue;
+				}
+				const BYTE* pRow = view.GetRow(static_cast<size_t>(sy));
+				for (int64_t sx = gx0 - 1; sx <= gx1; sx++) {
+					// out of bounds loads return zero
+					lumaRow[static_cast<size_t>(sx - gx0 + 1)] = sx < 0 || sx >= static_cast<int64_t>(width) ? 0.0f : GetLuma(&pRow[sx * 4]);
+				}
+				for (size_t x = 0u; x < nCols; x++) {
+					float sumP = 0.0f, sumD = 0.0f;
+					for (int i = 0; i < 3; i++) {
+						sumP += p[i] * lumaRow[x + i];
+						sumD += d[i] * lumaRow[x + i];
+					}
+					pP[x] = sumP;
+					pD[x] = sumD;
+				}
+			}
+
+			// y pass, weighted by the view's position in the grid
+			for (int64_t gy = gy0; gy < gy1; gy++) {
+				const size_t iRow = static_cast<size_t>(gy - gy0);
+				for (size_t x = 0u; x < nCols; x++) {
+					float dxpy = 0.0f, pxdy = 0.0f, pxpy = 0.0f;
+					for (int j = 0; j < 3; j++) {
+						const size_t i = (iRow + j) * gradSize + x;
+						dxpy += p[j] * tileDerived[i];
+						pxdy += d[j] * tilePrefiltered[i];
+						pxpy += p[j] * tilePrefiltered[i];
+					}
+					float* g = &tileGradients[(iRow * gradSize + x) * 4u];
+					g[0] += pu * pv * dxpy;
+					g[1] += pu * pv * pxdy;
+					g[2] += du * pv * pxpy;
+					g[3] += pu * dv * pxpy;
+				}
+			}
+		}
+
+		// 3x3 window straight from the scratch
+		const int64_t x1 = tileX1, y1 = tileY1;
+		for (int64_t y = tileY; y < y1; y++) {
+			float* pDepth = reinterpret_cast<float*>(depth.GetRow(static_cast<size_t>(y)));
+			float* pConfidenceData = pConfidence ? reinterpret_cast<float*>(pConfidence->GetRow(static_cast<size_t>(y))) : nullptr;
+			for (int64_t x = tileX; x < x1; x++) {
+				float a = 0.0f, b = 0.0f;
+				for (int64_t sy = std::max(y - 1, gy0); sy <= std::min(y + 1, gy1 - 1); sy++) {
+					for (int64_t sx = std::max(x - 1, gx0); sx <= std::min(x + 1, gx1 - 1); sx++) {
+						const float* g = &tileGradients[(static_cast<size_t>(sy - gy0) * gradSize + static_cast<size_t>(sx - gx0)) * 4u];
+						a += g[0] * g[2] + g[1] * g[3];
+						b += g[0] * g[0] + g[1] * g[1];
+					}
+				}
+				pDepth[x] = b > 0.0f ? a / b : 0.0f;
+				if (pConfidenceData) pConfidenceData[x] = GetConfidence(b);
+			}
+		}
+	}
+
+private:
+	void Resize(UINT width, UINT height)
+	{
+		const size_t nPixels = static_cast<size_t>(width) * height;
+		if (luma.size() == nPixels * CameraGrid::nViews) return;
+		luma.assign(nPixels * CameraGrid::nViews, 0.0f);
+		prefiltered.assign(nPixels * CameraGrid::nViews, 0.0f);
+		derived.assign(nPixels * CameraGrid::nViews, 0.0f);
+		scratchMemory.Track(MemoryTag::eRenderTargets, (luma.size() + prefiltered.size() + derived.size()) * sizeof(float));
+	}
+	// luma of all views in row interleaved planes, the rows of the 9 views at one image row follow each other
+	// every bgra texel is read once, the filters after it only do contiguous loads along a row
+	void PackLuma(const std::array<ImageView, CameraGrid::nViews>& views, UINT width, UINT height)
+	{
+		PROFILE_SCOPE("CpuDepthEngine::PackLuma");
+		ParallelFor(0u, height, [&](size_t y) {
+			for (UINT iView = 0u; iView < CameraGrid::nViews; iView++) {
+				const BYTE* pRow = views[iView].GetRow(y);
+				float* pLuma = &luma[(y * CameraGrid::nViews + iView) * width];
+				for (size_t x = 0u; x < width; x++) pLuma[x] = GetLuma(&pRow[x * 4u]);
+			}
+		});
+	}
+	static float* GetConfidenceData(Image* pConfidence, UINT width, UINT height)
+	{
+		if (!pConfidence) return nullptr;
+		if (pConfidence->width != width || pConfidence->height != height || pConfidence->format != Image::Format::eR32Float) throw std::runtime_error("Confidence does not match the depth layout");
+		return reinterpret_cast<float*>(pConfidence->data.data());
+	}
+	// maps the gradient energy of the window to [0, 1), same as the shaders
+	static inline float GetConfidence(float b)
+	{
+		return b / (b + confidenceScale);
+	}
+	static inline float GetLuma(const BYTE* pTexel)
+	{
+		return (pTexel[0] + pTexel[1] + pTexel[2]) * (0.333333f / 255.0f);
+	}
+
+private:
+	// 3-tap prefilter and derivative, same as in the gradients shader
+	static constexpr float p[3] = { 0.229879f, 0.540242f, 0.229879f };
+	static constexpr float d[3] = { -0.425287f, 0.0f, 0.425287f };
+	static constexpr UINT gradSize = tileSize + 2u;
+	// gradient energy at which the confidence reaches one half
+	static constexpr float confidenceScale = 1e-3f;
+
+	std::vector<float> luma, prefiltered, derived; // all views row interleaved, luma and its x pass
+	TrackedMemory scratchMemory;
+};
\ No newline at end of file
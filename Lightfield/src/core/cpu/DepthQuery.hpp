@@ -0,0 +1,121 @@
+#pragma once
+
+#include "cpu/CpuDepthEngine.hpp"
+
+// depth on demand for consumers that only look at a few regions of a frame, like detections or picked pixels
+// only the fused tiles under a query are computed, and they are kept until the next frame so overlapping queries share them
+// results match CpuDepthEngine::DeduceDepthFused bit for bit, the guided refinement needs the whole frame and is not applied
+class DepthQuery
+{
+public:
+	struct Rect
+	{
+		UINT x, y, width, height;
+	};
+	struct Pixel
+	{
+		UINT x, y;
+	};
+	struct Stats
+	{
+		size_t nTilesComputed = 0u; // this frame
+		size_t nTiles = 0u; // of a full frame
+	};
+
+public:
+	DepthQuery() = default;
+	~DepthQuery() = default;
+	ROF_DELETE(DepthQuery);
+
+public:
+	// views are bgra8 images laid out as in the camera grid and have to stay valid until the next frame
+	void BeginFrame(const std::array<ImageView, CameraGrid::nViews>& views)
+	{
+		const UINT width = views[CameraGrid::iCenterView].width, height = views[CameraGrid::iCenterView].height;
+		for (const ImageView& view : views) {
+			if (view.width != width || view.height != height || view.format != Image::Format::eBGRA8) throw std::runtime_error("Views of a depth query differ in size or format");
+		}
+		this->views = views;
+		if (depth.width != width || depth.height != height) {
+			depth = { width, height, Image::Format::eR32Float, std::vector<BYTE>(static_cast<size_t>(width) * height * sizeof(float)) };
+			confidence = depth;
+			nTilesX = (width + CpuDepthEngine::tileSize - 1u) / CpuDepthEngine::tileSize;
+			tileFrames.assign(static_cast<size_t>(nTilesX) * ((height + CpuDepthEngine::tileSize - 1u) / CpuDepthEngine::tileSize), 0u);
+			resultMemory.Track(MemoryTag::eRenderTargets, depth.data.size() + confidence.data.size());
+		}
+		// tiles stamped with an older frame are stale, nothing has to be cleared
+		iFrame++;
+		nTilesComputed = 0u;
+	}
+
+	// computes whatever tiles under the rectangles are missing
+	// queries have to start inside the frame, rectangles reaching past its edges are clipped and empty ones are ignored
+	void Evaluate(const Rect* pRects, size_t nRects)
+	{
+		PROFILE_SCOPE("DepthQuery::Evaluate");
+		// the whole batch is checked first, so a bad query never leaves part of the batch half done
+		for (size_t i = 0u; i < nRects; i++) {
+			if (pRects[i].x >= depth.width || pRects[i].y >= depth.height) throw std::runtime_error("Queried rectangle lies outside the frame");
+		}
+		std::vector<size_t> missing;
+		for (size_t i = 0u; i < nRects; i++) {
+			const Rect& rect = pRects[i];
+			if (rect.width == 0u || rect.height == 0u) continue;
+			const UINT tx1 = (rect.x + std::min(rect.width, depth.width - rect.x) - 1u) / CpuDepthEngine::tileSize;
+			const UINT ty1 = (rect.y + std::min(rect.height, depth.height - rect.y) - 1u) / CpuDepthEngine::tileSize;
+			for (UINT ty = rect.y / CpuDepthEngine::tileSize; ty <= ty1; ty++) {
+				for (UINT tx = rect.x / CpuDepthEngine::tileSize; tx <= tx1; tx++) Request(ty * nTilesX + tx, missing);
+			}
+		}
+		Compute(missing);
+	}
+	void Evaluate(const Pixel* pPixels, size_t nPixels)
+	{
+		PROFILE_SCOPE("DepthQuery::Evaluate");
+		for (size_t i = 0u; i < nPixels; i++) {
+			if (pPixels[i].x >= depth.width || pPixels[i].y >= depth.height) throw std::runtime_error("Queried pixel lies outside the frame");
+		}
+		std::vector<size_t> missing;
+		for (size_t i = 0u; i < nPixels; i++) {
+			Request((pPixels[i].y / CpuDepthEngine::tileSize) * nTilesX + pPixels[i].x / CpuDepthEngine::tileSize, missing);
+		}
+		Compute(missing);
+	}
+
+	// full size results, only valid where an evaluation of this frame reached
+	inline const Image& GetDepth() const { return depth; }
+	inline const Image& GetConfidence() const { return confidence; }
+	inline float GetDepth(UINT x, UINT y) const { return reinterpret_cast<const float*>(depth.data.data())[static_cast<size_t>(y) * depth.width + x]; }
+	inline float GetConfidence(UINT x, UINT y) const { return reinterpret_cast<const float*>(confidence.data.data())[static_cast<size_t>(y) * confidence.width + x]; }
+	inline Stats GetStats() const { return { nTilesComputed, tileFrames.size() }; }
+
+private:
+	inline void Request(size_t iTile, std::vector<size_t>& missing) const
+	{
+		if (tileFrames[iTile] != iFrame) missing.push_back(iTile);
+	}
+	// tiles under several queries are only computed once, and only stamped once they are
+	// if the computation throws, the whole batch stays missing and is computed again by the next query
+	void Compute(std::vector<size_t>& missing)
+	{
+		std::sort(missing.begin(), missing.end());
+		missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+		const MutableImageView depthView(depth), confidenceView(confidence);
+		ParallelFor(0u, missing.size(), [&](size_t i) {
+			const UINT x0 = static_cast<UINT>(missing[i] % nTilesX) * CpuDepthEngine::tileSize, y0 = static_cast<UINT>(missing[i] / nTilesX) * CpuDepthEngine::tileSize;
+			engine.DeduceDepthTile(views, x0, y0, std::min(x0 + CpuDepthEngine::tileSize, depth.width), std::min(y0 + CpuDepthEngine::tileSize, depth.height), depthView, &confidenceView);
+		});
+		for (size_t iTile : missing) tileFrames[iTile] = iFrame;
+		nTilesComputed += missing.size();
+	}
+
+private:
+	CpuDepthEngine engine;
+	std::array<ImageView, CameraGrid::nViews> views;
+	Image depth, confidence;
+	UINT nTilesX = 0u;
+	std::vector<UINT> tileFrames; // frame each tile was last computed in
+	UINT iFrame = 0u;
+	size_t nTilesComputed = 0u;
+	TrackedMemory resultMemory;
+};
\ No newline at end of file
@@ -0,0 +1,206 @@
+#pragma once
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define DEPTH_UPSAMPLER_SSE
+#endif
+
+#include "pipeline/CameraGrid.hpp"
+
+// preview depth from views reduced in resolution, a factor of 2 or 4 leaves a quarter or a sixteenth of the texels to the engines
+// views are box filtered down, the reduced depth comes back to full resolution with a joint bilateral upsampling
+// guided by the full resolution center view, same filters as DownsampleViewsCS and JointBilateralUpsampleCS
+class DepthUpsampler
+{
+public:
+	DepthUpsampler() = default;
+	~DepthUpsampler() = default;
+	ROF_DELETE(DepthUpsampler);
+
+public:
+	static inline UINT GetReducedSize(UINT size, UINT factor) { return (size + factor - 1u) / factor; }
+	// reduced views are stored one below the other in a single image, view i starts at row i * height / nViews
+	static std::array<ImageView, CameraGrid::nViews> GetReducedViews(const Image& reduced)
+	{
+		const UINT height = reduced.height / CameraGrid::nViews;
+		std::array<ImageView, CameraGrid::nViews> views;
+		for (UINT i = 0u; i < CameraGrid::nViews; i++) {
+			views[i] = { reduced.data.data() + static_cast<size_t>(i) * height * reduced.GetRowPitch(), reduced.width, height, reduced.format, reduced.GetRowPitch() };
+		}
+		return views;
+	}
+
+	// every reduced texel averages the factor x factor block of texels it covers, blocks along the far edges are clipped
+	static void Downsample(const std::array<ImageView, CameraGrid::nViews>& views, UINT factor, Image& reduced)
+	{
+		PROFILE_SCOPE("DepthUpsampler::Downsample");
+		const UINT width = views[CameraGrid::iCenterView].width, height = views[CameraGrid::iCenterView].height;
+		const UINT reducedWidth = GetReducedSize(width, factor), reducedHeight = GetReducedSize(height, factor);
+		if (reduced.width != reducedWidth || reduced.height != reducedHeight * CameraGrid::nViews || reduced.format != Image::Format::eBGRA8) throw std::runtime_error("Reduced views do not match the views and factor");
+		for (const ImageView& view : views) {
+			if (view.width != width || view.height != height || view.format != Image::Format::eBGRA8) throw std::runtime_error("Views to reduce differ in size or format");
+		}
+
+		ParallelFor(0u, static_cast<size_t>(CameraGrid::nViews) * reducedHeight, [&](size_t i) {
+			const ImageView& view = views[i / reducedHeight];
+			const UINT y0 = static_cast<UINT>(i % reducedHeight) * factor, y1 = std::min(y0 + factor, height);
+			BYTE* pReduced = &reduced.data[i * reduced.GetRowPitch()];
+			switch (factor) {
+				case 2u: DownsampleRow<2u>(view, y0, y1, pReduced); break;
+				case 4u: DownsampleRow<4u>(view, y0, y1, pReduced); break;
+				default: throw std::runtime_error("Views can only be reduced by a factor of 2 or 4");
+			}
+		});
+	}
+
+	// reduced depth is in reduced texels and gets scaled by the factor on the way up
+	// each texel takes the 2x2 reduced texels it lies between, weighted by distance, by how close their color is to its own and by their confidence
+	// the confidence is upsampled along with the same weights minus its own, so the refinement can run on the result
+	void Upsample(const ImageView& guide, const ImageView& reducedGuide, const Image& reducedDepth, const Image& reducedConfidence, UINT factor, Image& depth, Image* pConfidence)
+	{
+		PROFILE_SCOPE("DepthUpsampler::Upsample");
+		const UINT width = depth.width, height = depth.height;
+		const UINT reducedWidth = reducedDepth.width, reducedHeight = reducedDepth.height;
+		if (depth.format != Image::Format::eR32Float || reducedDepth.format != Image::Format::eR32Float) throw std::runtime_error("Depth needs a single channel float image");
+		if (reducedWidth != GetReducedSize(width, factor) || reducedHeight != GetReducedSize(height, factor)) throw std::runtime_error("Reduced depth does not match the depth and factor");
+		if (reducedConfidence.width != reducedWidth || reducedConfidence.height != reducedHeight || reducedConfidence.format != Image::Format::eR32Float) throw std::runtime_error("Reduced confidence does not match the reduced depth");
+		if (guide.width != width || guide.height != height || guide.format != Image::Format::eBGRA8) throw std::runtime_error("Guide does not match the depth layout");
+		if (reducedGuide.width != reducedWidth || reducedGuide.height != reducedHeight || reducedGuide.format != Image::Format::eBGRA8) throw std::runtime_error("Reduced guide does not match the reduced depth");
+		if (pConfidence && (pConfidence->width != width || pConfidence->height != height || pConfidence->format != Image::Format::eR32Float)) throw std::runtime_error("Confidence does not match the depth layout");
+
+		// horizontal taps are the same for every row
+		if (xTaps.size() != static_cast<size_t>(width) * nTaps) {
+			xTaps.resize(static_cast<size_t>(width) * nTaps);
+			xWeights.resize(static_cast<size_t>(width) * nTaps);
+			scratchMemory.Track(MemoryTag::eRenderTargets, xTaps.size() * (sizeof(UINT) + sizeof(float)));
+		}
+		for (UINT x = 0u; x < width; x++) GetTaps(x, factor, reducedWidth, &xTaps[x * nTaps], &xWeights[x * nTaps]);
+
+		const std::array<float, nRangeWeights>& rangeWeights = GetRangeWeights();
+		const float* pReducedDepth = reinterpret_cast<const float*>(reducedDepth.data.data());
+		const float* pReducedConfidence = reinterpret_cast<const float*>(reducedConfidence.data.data());
+		float* pDepth = reinterpret_cast<float*>(depth.data.data());
+		float* pConfidenceData = pConfidence ? reinterpret_cast<float*>(pConfidence->data.data()) : nullptr;
+		const float disparityScale = static_cast<float>(factor);
+		ParallelFor(0u, height, [&](size_t y) {
+			UINT yTaps[nTaps];
+			float yWeights[nTaps];
+			GetTaps(static_cast<UINT>(y), factor, reducedHeight, yTaps, yWeights);
+			const BYTE* pGuideRow = guide.GetRow(y);
+			for (size_t x = 0u; x < width; x++) {
+				const BYTE* pTexel = &pGuideRow[x * 4u];
+				float depthSum = 0.0f, depthWeightSum = 0.0f, confidenceSum = 0.0f, weightSum = 0.0f;
+				for (UINT ty = 0u; ty < nTaps; ty++) {
+					const BYTE* pReducedRow = reducedGuide.GetRow(yTaps[ty]);
+					const size_t rowOffset = static_cast<size_t>(yTaps[ty]) * reducedWidth;
+					for (UINT tx = 0u; tx < nTaps; tx++) {
+						const UINT rx = xTaps[x * nTaps + tx];
+						const float tapDepth = pReducedDepth[rowOffset + rx];
+						if (!std::isfinite(tapDepth)) continue;
+						const BYTE* pReduced = &pReducedRow[rx * 4u];
+						const UINT difference = std::abs(pTexel[0] - pReduced[0]) + std::abs(pTexel[1] - pReduced[1]) + std::abs(pTexel[2] - pReduced[2]);
+						const float weight = yWeights[ty] * xWeights[x * nTaps + tx] * rangeWeights[difference];
+						const float confidence = pReducedConfidence[rowOffset + rx];
+						const float depthWeight = weight * (confidence + confidenceFloor);
+						depthSum += depthWeight * tapDepth;
+						depthWeightSum += depthWeight;
+						confidenceSum += weight * confidence;
+						weightSum += weight;
+					}
+				}
+				pDepth[y * width + x] = depthWeightSum > 0.0f ? depthSum / depthWeightSum * disparityScale : 0.0f;
+				if (pConfidenceData) pConfidenceData[y * width + x] = weightSum > 0.0f ? confidenceSum / weightSum : 0.0f;
+			}
+		});
+	}
+
+private:
+	// the block size is known at compile time, so the full blocks are summed without any bounds checks
+	template<UINT factor>
+	static void DownsampleRow(const ImageView& view, UINT y0, UINT y1, BYTE* pReduced)
+	{
+		const UINT width = view.width, nFullBlocks = width / factor;
+		const UINT nRows = y1 - y0, halfCount = nRows * factor / 2u;
+		UINT rx = 0u;
+#ifdef DEPTH_UPSAMPLER_SSE
+		// 4 texels of every row at a time, summed in 16 bit, only for blocks not clipped at the bottom
+		static constexpr UINT nBlocksPerLoad = 4u / factor;
+		static constexpr int shift = factor == 2u ? 2 : 4; // log2 of the texels per block
+		const __m128i zero = _mm_setzero_si128(), rounding = _mm_set1_epi16(static_cast<short>(factor * factor / 2u));
+		for (; nRows == factor && rx + nBlocksPerLoad <= nFullBlocks; rx += nBlocksPerLoad) {
+			__m128i lo = zero, hi = zero; // texels 0 and 1, texels 2 and 3
+			for (UINT y = y0; y < y1; y++) {
+				const __m128i texels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(view.GetRow(y) + rx * factor * 4u));
+				lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(texels, zero));
+				hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(texels, zero));
+			}
+			if constexpr (factor == 2u) {
+				const __m128i sums = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+				const __m128i means = _mm_srli_epi16(_mm_add_epi16(sums, rounding), shift);
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(&pReduced[rx * 4u]), _mm_packus_epi16(means, zero));
+			}
+			else {
+				__m128i sums = _mm_add_epi16(lo, hi);
+				sums = _mm_add_epi16(sums, _mm_srli_si128(sums, 8));
+				const __m128i means = _mm_srli_epi16(_mm_add_epi16(sums, rounding), shift);
+				const int packed = _mm_cvtsi128_si32(_mm_packus_epi16(means, zero));
+				memcpy(&pReduced[rx * 4u], &packed, 4u);
+			}
+		}
+#endif
+		for (; rx < nFullBlocks; rx++) {
+			UINT sums[4] = { 0u, 0u, 0u, 0u };
+			for (UINT y = y0; y < y1; y++) {
+				const BYTE* pBlock = view.GetRow(y) + rx * factor * 4u;
+				for (UINT x = 0u; x < factor * 4u; x++) sums[x % 4u] += pBlock[x];
+			}
+			for (UINT c = 0u; c < 4u; c++) pReduced[rx * 4u + c] = static_cast<BYTE>((sums[c] + halfCount) / (nRows * factor));
+		}
+		// clipped block along the right edge
+		if (nFullBlocks * factor == width) return;
+		const UINT x0 = nFullBlocks * factor, count = (width - x0) * nRows;
+		UINT sums[4] = { 0u, 0u, 0u, 0u };
+		for (UINT y = y0; y < y1; y++) {
+			const BYTE* pRow = view.GetRow(y);
+			for (UINT x = x0 * 4u; x < width * 4u; x++) sums[x % 4u] += pRow[x];
+		}
+		for (UINT c = 0u; c < 4u; c++) pReduced[nFullBlocks * 4u + c] = static_cast<BYTE>((sums[c] + count / 2u) / count);
+	}
+	// reduced texels around a texel along one axis, clamped to the edges, with their spatial weights
+	static inline void GetTaps(UINT position, UINT factor, UINT reducedSize, UINT* pTaps, float* pWeights)
+	{
+		const float center = (static_cast<float>(position) + .5f) / static_cast<float>(factor) - .5f;
+		const int first = static_cast<int>(std::floor(center)) - static_cast<int>(nTaps / 2u - 1u);
+		for (UINT i = 0u; i < nTaps; i++) {
+			const float distance = center - static_cast<float>(first + static_cast<int>(i));
+			pTaps[i] = static_cast<UINT>(std::clamp(first + static_cast<int>(i), 0, static_cast<int>(reducedSize) - 1));
+			pWeights[i] = std::exp(-.5f * distance * distance / (spatialSigma * spatialSigma));
+		}
+	}
+	// range weights over the summed absolute difference of the 8-bit color channels
+	// floored, so a texel unlike all of its taps still falls back to the spatial weights
+	static const std::array<float, 3u * 255u + 1u>& GetRangeWeights()
+	{
+		static const std::array<float, nRangeWeights> weights = [] {
+			std::array<float, nRangeWeights> weights;
+			for (UINT i = 0u; i < nRangeWeights; i++) {
+				const float difference = static_cast<float>(i) / (3.0f * 255.0f);
+				weights[i] = std::max(std::exp(-.5f * difference * difference / (rangeSigma * rangeSigma)), rangeWeightFloor);
+			}
+			return weights;
+		}();
+		return weights;
+	}
+
+private:
+	static constexpr UINT nTaps = 2u; // per axis, the reduced texels a texel lies between
+	static constexpr UINT nRangeWeights = 3u * 255u + 1u;
+	static constexpr float spatialSigma = .5f; // in reduced texels
+	static constexpr float rangeSigma = .05f; // of the mean channel difference
+	static constexpr float rangeWeightFloor = 1e-4f;
+	static constexpr float confidenceFloor = 1e-3f; // textureless neighbourhoods still get a plain bilateral average
+
+	std::vector<UINT> xTaps;
+	std::vector<float> xWeights;
+	TrackedMemory scratchMemory;
+};
\ No newline at end of file
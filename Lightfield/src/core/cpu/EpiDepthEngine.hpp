@@ -0,0 +1,161 @@
+#pragma once
+
+#include "pipeline/CameraGrid.hpp"
+
+// cpu version of EpiDepthCS, depth from the orientation of lines in epipolar plane images
+// the center row of views forms a horizontal epi per image row and the center column a vertical one per image column,
+// both are stored line by line with the spatial axis contiguous, so the same code runs over either and the inner loops vectorize
+class EpiDepthEngine
+{
+public:
+	EpiDepthEngine() = default;
+	~EpiDepthEngine() = default;
+	ROF_DELETE(EpiDepthEngine);
+
+public:
+	// views are bgra8 images laid out as in the camera grid, view index = u * 3 + v, same as for CpuDepthEngine
+	// disparity along each epi comes from its smoothed structure tensor, the direction with the higher coherence wins
+	// confidence is optional, the coherence of the winner scaled down where the epi has hardly any texture
+	void DeduceDepth(const std::array<ImageView, CameraGrid::nViews>& views, Image& depth, Image* pConfidence = nullptr)
+	{
+		PROFILE_SCOPE("EpiDepthEngine::DeduceDepth");
+		const UINT width = depth.width, height = depth.height;
+		if (depth.format != Image::Format::eR32Float) throw std::runtime_error("Depth needs a single channel float image");
+		if (pConfidence && (pConfidence->width != width || pConfidence->height != height || pConfidence->format != Image::Format::eR32Float)) throw std::runtime_error("Confidence does not match the depth layout");
+		for (const ImageView& view : views) {
+			if (view.width != width || view.height != height || view.format != Image::Format::eBGRA8) throw std::runtime_error("View does not match the depth layout");
+		}
+		Resize(width, height);
+
+		// horizontal epis along the center row of views, image rows as they are
+		// vertical epis along the center column, transposed in tiles so image columns become contiguous lines
+		ParallelFor(0u, height, [&](size_t y) {
+			for (UINT s = 0u; s < CameraGrid::nViewsPerAxis; s++) {
+				const BYTE* pRow = views[s * CameraGrid::nViewsPerAxis + CameraGrid::camLoopLim].GetRow(y);
+				float* pLine = &epiH[(y * CameraGrid::nViewsPerAxis + s) * width];
+				for (size_t x = 0u; x < width; x++) pLine[x] = GetLuma(&pRow[x * 4u]);
+			}
+		});
+		ParallelForTiles(width, height, transposeTile, [&](UINT x0, UINT y0, UINT x1, UINT y1) {
+			for (UINT s = 0u; s < CameraGrid::nViewsPerAxis; s++) {
+				const ImageView& view = views[CameraGrid::camLoopLim * CameraGrid::nViewsPerAxis + s];
+				for (UINT y = y0; y < y1; y++) {
+					const BYTE* pRow = view.GetRow(y);
+					for (UINT x = x0; x < x1; x++) epiV[(static_cast<size_t>(x) * CameraGrid::nViewsPerAxis + s) * height + y] = GetLuma(&pRow[x * 4u]);
+				}
+			}
+		});
+
+		ComputeTensors(epiH, tensorsH, width, height);
+		ComputeTensors(epiV, tensorsV, height, width);
+
+		// fused per tile so the transposed reads of the vertical result stay in cache
+		float* pDepth = reinterpret_cast<float*>(depth.data.data());
+		float* pConfidenceData = pConfidence ? reinterpret_cast<float*>(pConfidence->data.data()) : nullptr;
+		ParallelForTiles(width, height, transposeTile, [&](UINT x0, UINT y0, UINT x1, UINT y1) {
+			for (UINT y = y0; y < y1; y++) {
+				for (UINT x = x0; x < x1; x++) {
+					const Orientation h = GetOrientation(&tensorsH[(static_cast<size_t>(y) * width + x) * 3u]);
+					const Orientation v = GetOrientation(&tensorsV[(static_cast<size_t>(x) * height + y) * 3u]);
+					const Orientation& best = h.coherence >= v.coherence ? h : v;
+					pDepth[y * width + x] = best.disparity;
+					if (pConfidenceData) pConfidenceData[y * width + x] = best.coherence * best.energy / (best.energy + confidenceScale);
+				}
+			}
+		});
+	}
+
+private:
+	struct Orientation
+	{
+		float disparity, coherence, energy;
+	};
+
+	void Resize(UINT width, UINT height)
+	{
+		const size_t nPixels = static_cast<size_t>(width) * height;
+		if (epiH.size() == nPixels * CameraGrid::nViewsPerAxis) return;
+		epiH.assign(nPixels * CameraGrid::nViewsPerAxis, 0.0f);
+		epiV.assign(nPixels * CameraGrid::nViewsPerAxis, 0.0f);
+		tensorsH.assign(nPixels * 3u, 0.0f);
+		tensorsV.assign(nPixels * 3u, 0.0f);
+		smoothed.assign(nPixels * 3u, 0.0f);
+		scratchMemory.Track(MemoryTag::eRenderTargets, (epiH.size() + epiV.size() + tensorsH.size() + tensorsV.size() + smoothed.size()) * sizeof(float));
+	}
+
+	// structure tensor of the center line of every epi, gradients with the filters of the gradient engine
+	// smoothed first along each line, then across neighbouring epis, both with the same gaussian
+	// tensors hold Jss, Jsa, Jaa per pixel, s being the spatial and a the angular axis of the epi
+	void ComputeTensors(const std::vector<float>& epis, std::vector<float>& tensors, UINT length, UINT nEpis)
+	{
+		ParallelFor(0u, nEpis, [&](size_t iEpi) {
+			const float* pLines = &epis[iEpi * CameraGrid::nViewsPerAxis * length];
+			float* pSmoothed = &smoothed[iEpi * length * 3u];
+			ScopedArena arena;
+			ArenaVector<float> raw(length * 3u);
+			for (size_t s = 0u; s < length; s++) {
+				float gs = 0.0f, ga = 0.0f;
+				for (int i = 0; i < 3; i++) {
+					// edges are clamped, a zero border would look like a strong vertical line in the epi
+					const size_t sx = static_cast<size_t>(std::clamp<int64_t>(static_cast<int64_t>(s) + i - 1, 0, length - 1));
+					float column = 0.0f;
+					for (UINT a = 0u; a < CameraGrid::nViewsPerAxis; a++) {
+						column += p[a] * d[i] * pLines[a * length + sx];
+						ga += d[a] * p[i] * pLines[a * length + sx];
+					}
+					gs += column;
+				}
+				raw[s * 3u + 0u] = gs * gs;
+				raw[s * 3u + 1u] = gs * ga;
+				raw[s * 3u + 2u] = ga * ga;
+			}
+			for (size_t s = 0u; s < length; s++) {
+				float sum[3] = { 0.0f, 0.0f, 0.0f };
+				for (int k = -smoothRadius; k <= smoothRadius; k++) {
+					const size_t sk = static_cast<size_t>(std::clamp<int64_t>(static_cast<int64_t>(s) + k, 0, length - 1));
+					for (size_t c = 0u; c < 3u; c++) sum[c] += smoothing[k + smoothRadius] * raw[sk * 3u + c];
+				}
+				for (size_t c = 0u; c < 3u; c++) pSmoothed[s * 3u + c] = sum[c];
+			}
+		});
+		ParallelFor(0u, nEpis, [&](size_t iEpi) {
+			float* pTensors = &tensors[iEpi * length * 3u];
+			std::fill(pTensors, pTensors + length * 3u, 0.0f);
+			for (int k = -smoothRadius; k <= smoothRadius; k++) {
+				const size_t iNeighbour = static_cast<size_t>(std::clamp<int64_t>(static_cast<int64_t>(iEpi) + k, 0, nEpis - 1));
+				const float* pNeighbour = &smoothed[iNeighbour * length * 3u];
+				const float weight = smoothing[k + smoothRadius];
+				for (size_t i = 0u; i < length * 3u; i++) pTensors[i] += weight * pNeighbour[i];
+			}
+		});
+	}
+	// lines in an epi run along s + a * disparity = const, so the dominant gradient points along (1, disparity)
+	static inline Orientation GetOrientation(const float* pTensor)
+	{
+		const float jss = pTensor[0], jsa = pTensor[1], jaa = pTensor[2];
+		const float energy = jss + jaa;
+		if (energy <= 0.0f) return { 0.0f, 0.0f, 0.0f };
+		const float angle = .5f * std::atan2(2.0f * jsa, jss - jaa);
+		const float coherence = std::sqrt((jss - jaa) * (jss - jaa) + 4.0f * jsa * jsa) / energy;
+		return { std::tan(angle), coherence, energy };
+	}
+	static inline float GetLuma(const BYTE* pTexel)
+	{
+		return (pTexel[0] + pTexel[1] + pTexel[2]) * (0.333333f / 255.0f);
+	}
+
+private:
+	// 3-tap prefilter and derivative of the gradient engine, along the views as well as the pixels
+	static constexpr float p[3] = { 0.229879f, 0.540242f, 0.229879f };
+	static constexpr float d[3] = { -0.425287f, 0.0f, 0.425287f };
+	// gaussian with sigma 1.5 the tensors are smoothed with, the same radius as in the shader
+	static constexpr int smoothRadius = 3;
+	static constexpr float smoothing[2 * smoothRadius + 1] = { 0.036633f, 0.111281f, 0.216745f, 0.270682f, 0.216745f, 0.111281f, 0.036633f };
+	static constexpr UINT transposeTile = 32u;
+	// tensor energy at which the confidence reaches one half of the coherence
+	static constexpr float confidenceScale = 1e-3f;
+
+	std::vector<float> epiH, epiV; // three lines per epi, one for each view along it
+	std::vector<float> tensorsH, tensorsV, smoothed;
+	TrackedMemory scratchMemory;
+};
\ No newline at end of file
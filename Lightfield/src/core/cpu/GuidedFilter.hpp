@@ -0,0 +1,221 @@
+#pragma once
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define GUIDED_FILTER_SSE
+#endif
+
+// weighted guided filter (He et al.) with a color guide, edges of the output follow the edges of the guide
+// every window mean is a box filter built from running sums, so the cost per pixel does not depend on the radius
+// weights let unreliable input pixels take their value from confident neighbours on the same side of an edge
+class GuidedFilter
+{
+public:
+	struct Params
+	{
+		UINT radius = 4u; // window is (2 * radius + 1)^2
+		float epsilon = 1e-3f; // regularization, larger values smooth across weaker guide edges
+	};
+
+public:
+	GuidedFilter() = default;
+	~GuidedFilter() = default;
+	ROF_DELETE(GuidedFilter);
+
+public:
+	// guide is a bgra8 image, input, weights and output are single channel float images of the same size
+	// output may be the input itself, non-finite input pixels are ignored
+	void Filter(const ImageView& guide, const ImageView& input, const ImageView& weights, const MutableImageView& output)
+	{
+		PROFILE_SCOPE("GuidedFilter::Filter");
+		width = input.width;
+		height = input.height;
+		if (params.radius > maxRadius) throw std::runtime_error("Guided filter radius is too large");
+		if (guide.width != width || guide.height != height || guide.format != Image::Format::eBGRA8) throw std::runtime_error("Guide does not match the filter input");
+		for (const ImageView& image : { input, weights, static_cast<ImageView>(output) }) {
+			if (image.width != width || image.height != height || image.format != Image::Format::eR32Float) throw std::runtime_error("Guided filter needs single channel float images of the same size");
+		}
+		Resize(static_cast<size_t>(width) * height);
+
+		// weighted moments of guide and input
+		ParallelFor(0u, height, [&](size_t y) {
+			const BYTE* pGuide = guide.GetRow(y);
+			const float* pInput = reinterpret_cast<const float*>(input.GetRow(y));
+			const float* pWeights = reinterpret_cast<const float*>(weights.GetRow(y));
+			for (size_t x = 0u, i = y * width; x < width; x++, i++, pGuide += 4u) {
+				float r, g, b;
+				GetColor(pGuide, r, g, b);
+				float p = pInput[x], w = std::max(pWeights[x], 0.0f) + weightFloor;
+				if (!std::isfinite(p)) {
+					p = 0.0f;
+					w = weightFloor;
+				}
+				Plane(eW)[i] = w;
+				Plane(eWR)[i] = w * r;
+				Plane(eWG)[i] = w * g;
+				Plane(eWB)[i] = w * b;
+				Plane(eWP)[i] = w * p;
+				Plane(eWRR)[i] = w * r * r;
+				Plane(eWRG)[i] = w * r * g;
+				Plane(eWRB)[i] = w * r * b;
+				Plane(eWGG)[i] = w * g * g;
+				Plane(eWGB)[i] = w * g * b;
+				Plane(eWBB)[i] = w * b * b;
+				Plane(eWPR)[i] = w * p * r;
+				Plane(eWPG)[i] = w * p * g;
+				Plane(eWPB)[i] = w * p * b;
+			}
+		});
+		BoxFilter(eMomentCount);
+
+		// linear model per window, output = a . guide + b
+		// the weighted sums share the same window size, so normalizing by the weight sum alone gives weighted means
+		ParallelFor(0u, height, [&](size_t y) {
+			for (size_t i = y * width; i < (y + 1u) * width; i++) {
+				const float invW = 1.0f / Plane(eW)[i];
+				const float mr = Plane(eWR)[i] * invW, mg = Plane(eWG)[i] * invW, mb = Plane(eWB)[i] * invW, mp = Plane(eWP)[i] * invW;
+
+				// covariance of the guide with epsilon on the diagonal, and covariance of guide and input
+				// variances of flat windows may come out slightly negative from the running sums
+				const float crr = std::max(Plane(eWRR)[i] * invW - mr * mr, 0.0f) + params.epsilon;
+				const float crg = Plane(eWRG)[i] * invW - mr * mg;
+				const float crb = Plane(eWRB)[i] * invW - mr * mb;
+				const float cgg = std::max(Plane(eWGG)[i] * invW - mg * mg, 0.0f) + params.epsilon;
+				const float cgb = Plane(eWGB)[i] * invW - mg * mb;
+				const float cbb = std::max(Plane(eWBB)[i] * invW - mb * mb, 0.0f) + params.epsilon;
+				const float cpr = Plane(eWPR)[i] * invW - mp * mr;
+				const float cpg = Plane(eWPG)[i] * invW - mp * mg;
+				const float cpb = Plane(eWPB)[i] * invW - mp * mb;
+
+				// symmetric 3x3 solve through the adjugate
+				const float irr = cgg * cbb - cgb * cgb, irg = cgb * crb - crg * cbb, irb = crg * cgb - cgg * crb;
+				const float igg = crr * cbb - crb * crb, igb = crb * crg - crr * cgb, ibb = crr * cgg - crg * crg;
+				const float invDet = 1.0f / (crr * irr + crg * irg + crb * irb);
+				const float ar = (irr * cpr + irg * cpg + irb * cpb) * invDet;
+				const float ag = (irg * cpr + igg * cpg + igb * cpb) * invDet;
+				const float ab = (irb * cpr + igb * cpg + ibb * cpb) * invDet;
+
+				Plane(eAR)[i] = ar;
+				Plane(eAG)[i] = ag;
+				Plane(eAB)[i] = ab;
+				Plane(eB)[i] = mp - ar * mr - ag * mg - ab * mb;
+			}
+		});
+		BoxFilter(eCoefficientCount);
+
+		// every window covering a pixel contributes its model, windows are clipped at the borders
+		ParallelFor(0u, height, [&](size_t y) {
+			const float ny = static_cast<float>(std::min<size_t>(y + params.radius, height - 1u) - (y > params.radius ? y - params.radius : 0u) + 1u);
+			float* pOutput = reinterpret_cast<float*>(output.GetRow(y));
+			for (size_t x = 0u; x < width; x++) {
+				const size_t i = y * width + x;
+				const float nx = static_cast<float>(std::min<size_t>(x + params.radius, width - 1u) - (x > params.radius ? x - params.radius : 0u) + 1u);
+				float r, g, b;
+				GetColor(&guide.GetRow(y)[x * 4u], r, g, b);
+				pOutput[x] = (Plane(eAR)[i] * r + Plane(eAG)[i] * g + Plane(eAB)[i] * b + Plane(eB)[i]) / (nx * ny);
+			}
+		});
+	}
+
+	inline Params& GetParams() { return params; }
+
+private:
+	// moments first, the linear coefficients reuse the first planes afterwards
+	enum : UINT { eW, eWR, eWG, eWB, eWP, eWRR, eWRG, eWRB, eWGG, eWGB, eWBB, eWPR, eWPG, eWPB, eMomentCount };
+	enum : UINT { eAR, eAG, eAB, eB, eCoefficientCount };
+
+	inline float* Plane(UINT iPlane) { return &planes[iPlane * nPlanePixels]; }
+	static inline void GetColor(const BYTE* pTexel, float& r, float& g, float& b)
+	{
+		r = pTexel[2] * (1.0f / 255.0f);
+		g = pTexel[1] * (1.0f / 255.0f);
+		b = pTexel[0] * (1.0f / 255.0f);
+	}
+	void Resize(size_t nPixels)
+	{
+		if (nPlanePixels == nPixels) return;
+		nPlanePixels = nPixels;
+		planes.assign(nPixels * eMomentCount, 0.0f);
+		planeMemory.Track(MemoryTag::eRenderTargets, planes.size() * sizeof(float));
+	}
+
+	// unnormalized sums over the windows clipped to the image, in place on the first nPlanes planes
+	// both directions slide a running sum, the values leaving the window are kept in a ring of radius + 1 entries
+	// sums accumulate in double, float drift would swamp windows that carry almost no weight
+	void BoxFilter(UINT nPlanes)
+	{
+		const size_t radius = params.radius, nSlots = radius + 1u;
+		ParallelFor(0u, static_cast<size_t>(nPlanes) * height, [&](size_t iRow) {
+			float* pRow = &planes[iRow * width]; // planes are stored back to back, so rows of all planes are consecutive
+			std::array<float, maxRadius + 1u> ring;
+			std::fill_n(ring.begin(), nSlots, 0.0f);
+			double sum = 0.0;
+			for (size_t x = 0u; x < std::min<size_t>(radius, width); x++) sum += pRow[x];
+			for (size_t x = 0u, iSlot = 0u; x < width; x++, iSlot = iSlot + 1u == nSlots ? 0u : iSlot + 1u) {
+				if (x + radius < width) sum += pRow[x + radius];
+				float& slot = ring[iSlot]; // holds x - radius - 1, or zero while the window is clipped
+				sum -= slot;
+				slot = pRow[x];
+				pRow[x] = static_cast<float>(sum);
+			}
+		});
+
+		// columns in strips, vectorized across the strip
+		const size_t nStrips = (width + stripWidth - 1u) / stripWidth;
+		ParallelFor(0u, static_cast<size_t>(nPlanes) * nStrips, [&](size_t iTask) {
+			const size_t x0 = (iTask % nStrips) * stripWidth, n = std::min<size_t>(stripWidth, width - x0);
+			float* pPlane = Plane(static_cast<UINT>(iTask / nStrips)) + x0;
+			alignas(16) std::array<float, (maxRadius + 1u) * stripWidth> ring;
+			alignas(16) std::array<double, stripWidth> sum;
+			std::fill_n(ring.begin(), nSlots * stripWidth, 0.0f);
+			sum.fill(0.0);
+			for (size_t y = 0u; y < std::min<size_t>(radius, height); y++) {
+				for (size_t i = 0u; i < n; i++) sum[i] += pPlane[y * width + i];
+			}
+			for (size_t y = 0u; y < height; y++) {
+				const float* pEnter = y + radius < height ? &pPlane[(y + radius) * width] : nullptr;
+				SlideRow(sum.data(), pEnter, &ring[(y % nSlots) * stripWidth], &pPlane[y * width], n);
+			}
+		});
+	}
+	// one step of the vertical window: add the entering row, drop the leaving one held in the slot, keep the current row in its place
+	static inline void SlideRow(double* pSum, const float* pEnter, float* pSlot, float* pRow, size_t n)
+	{
+		size_t i = 0u;
+#ifdef GUIDED_FILTER_SSE
+		// two double lanes each for the low and high half of four floats
+		for (; i + 4u <= n; i += 4u) {
+			__m128d sumLo = _mm_load_pd(&pSum[i]), sumHi = _mm_load_pd(&pSum[i + 2u]);
+			if (pEnter) {
+				const __m128 enter = _mm_loadu_ps(&pEnter[i]);
+				sumLo = _mm_add_pd(sumLo, _mm_cvtps_pd(enter));
+				sumHi = _mm_add_pd(sumHi, _mm_cvtps_pd(_mm_movehl_ps(enter, enter)));
+			}
+			const __m128 leave = _mm_load_ps(&pSlot[i]);
+			sumLo = _mm_sub_pd(sumLo, _mm_cvtps_pd(leave));
+			sumHi = _mm_sub_pd(sumHi, _mm_cvtps_pd(_mm_movehl_ps(leave, leave)));
+			_mm_store_pd(&pSum[i], sumLo);
+			_mm_store_pd(&pSum[i + 2u], sumHi);
+			_mm_store_ps(&pSlot[i], _mm_loadu_ps(&pRow[i]));
+			_mm_storeu_ps(&pRow[i], _mm_movelh_ps(_mm_cvtpd_ps(sumLo), _mm_cvtpd_ps(sumHi)));
+		}
+#endif
+		for (; i < n; i++) {
+			if (pEnter) pSum[i] += pEnter[i];
+			pSum[i] -= pSlot[i];
+			pSlot[i] = pRow[i];
+			pRow[i] = static_cast<float>(pSum[i]);
+		}
+	}
+
+private:
+	static constexpr UINT maxRadius = 32u;
+	static constexpr size_t stripWidth = 64u;
+	static constexpr float weightFloor = 1e-4f; // keeps windows without any confident pixel solvable
+
+	Params params;
+	UINT width = 0u, height = 0u;
+	size_t nPlanePixels = 0u;
+	std::vector<float> planes;
+	TrackedMemory planeMemory;
+};
\ No newline at end of file
@@ -0,0 +1,352 @@
+#pragma once
+
+#include "pipeline/PipelineBackend.hpp"
+#include "cpu/AnalyticScene.hpp"
+#include "cpu/CpuDepthEngine.hpp"
+#include "cpu/EpiDepthEngine.hpp"
+#include "cpu/PlaneSweepEngine.hpp"
+#include "cpu/GuidedFilter.hpp"
+#include "cpu/DepthUpsampler.hpp"
+
+// cpu implementation of the pipeline without any window or graphics device
+// views are ray cast from the analytic scene and shaded like ForwardPS, depth deduction runs on CpuDepthEngine
+class HeadlessBackend : public PipelineBackend
+{
+public:
+	enum class DepthEngine : UINT {
+		eGradients, // 4d gradients, fused or in two passes
+		eEpi, // structure tensors of epipolar plane images
+		ePlaneSweep // cost volume over disparity hypotheses, for wide baselines
+	};
+
+public:
+	HeadlessBackend(UINT width, UINT height) : width(width), height(height), frameGraph(CreateAllocator(), MemoryTag::eRenderTargets)
+	{
+		BuildFrameGraph();
+	}
+	ROF_DELETE(HeadlessBackend);
+
+public:
+	void RenderFrame() override
+	{
+		PROFILE_SCOPE("HeadlessBackend::RenderFrame");
+		ScopedArena arena; // scratch of the frame is released all at once
+		// views and simulated depths are only kept around when someone is going to read them
+		bCapturedFrame = std::exchange(bCaptureRequested, false);
+		for (UINT i = 0u; i < CameraGrid::nViews; i++) {
+			frameGraph.SetOutput(viewArr[i], bCapturedFrame);
+			frameGraph.SetOutput(simDepthArr[i], bCapturedFrame);
+		}
+		frameGraph.Execute();
+	}
+	UINT GetViewCount() const override { return CameraGrid::nViews; }
+	Image Capture(CaptureTarget target, UINT iView = 0u) override
+	{
+		Image* pImage = nullptr;
+		switch (target)
+		{
+			case CaptureTarget::eColor: pImage = bCapturedFrame ? frameGraph.Get(viewArr[iView]) : nullptr; break;
+			case CaptureTarget::eSimulatedDepth: pImage = bCapturedFrame ? frameGraph.Get(simDepthArr[iView]) : nullptr; break;
+			case CaptureTarget::eOutputDepth: pImage = frameGraph.Get(outputDepth); break;
+		}
+		if (!pImage) throw std::runtime_error("Capture target was not kept for the last frame, request the capture before rendering");
+		return *pImage;
+	}
+
+	// same layout as the default scene of the windowed application, obj models are not supported so a box stands in for the crates
+	// floor and box get a checker pattern so the depth deduction has texture to work with
+	void LoadDefaultScene()
+	{
+		scene.Clear();
+		cameraPosition = { 0.0f, 0.0f, -10.0f };
+		cameraRotation = { 0.0f, 0.0f, 0.0f };
+
+		AnalyticScene::Object sphere{};
+		sphere.shape = AnalyticScene::Shape::eSphere;
+		sphere.position = { 0.0f, 0.0f, 2.0f };
+		scene.Add(sphere);
+
+		AnalyticScene::Object floor{};
+		floor.shape = AnalyticScene::Shape::eQuad;
+		floor.position = { -0.01f, -3.5f, 0.0f };
+		floor.rotation = { static_cast<float>(M_PI_2), 0.0f, 0.0f };
+		floor.scale = { 10.0f, 10.0f, 1.0f };
+		floor.checker = 4.0f;
+		scene.Add(floor);
+
+		AnalyticScene::Object box{};
+		box.shape = AnalyticScene::Shape::eCube;
+		box.position = { -4.0f, -2.49f, -4.0f };
+		box.rotation = { 0.0f, static_cast<float>(M_PI_2) * 0.5f, 0.0f };
+		box.scale = { 2.0f, 2.0f, 2.0f };
+		box.color = { .8f, .6f, .4f };
+		box.checker = 2.0f;
+		scene.Add(box);
+	}
+
+	inline AnalyticScene& GetScene() { return scene; }
+	inline void SetCamera(const Float3& position, const Float3& rotation)
+	{
+		cameraPosition = position;
+		cameraRotation = rotation;
+	}
+	inline FrameGraph<Image>& GetFrameGraph() { return frameGraph; }
+	// fused depth never writes the gradients to memory, the separate passes are kept around for comparison
+	void SetFusedDepth(bool bFused)
+	{
+		bFusedDepth = bFused;
+		UpdateDepthPasses();
+	}
+	void SetDepthEngine(DepthEngine engine)
+	{
+		depthEngineType = engine;
+		UpdateDepthPasses();
+	}
+	inline PlaneSweepEngine& GetPlaneSweepEngine() { return planeSweepEngine; }
+	// depth on views reduced by a factor of 2 or 4 and upsampled guided by the center view, 1 goes back to full resolution
+	// the two pass gradient engine is kept for comparison and always runs at full resolution
+	void SetDepthScale(UINT factor)
+	{
+		if (factor != 1u && factor != 2u && factor != 4u) throw std::runtime_error("Depth scale has to be 1, 2 or 4");
+		depthScale = factor;
+		ResizeReduced();
+		UpdateDepthPasses();
+	}
+	inline UINT GetDepthScale() const { return depthScale; }
+	// guided filter on the deduced depth, the center view is the guide and the confidence the weight
+	inline void SetDepthRefinement(bool bRefine) { frameGraph.SetPassEnabled(refinementPass, bRefine); }
+	inline GuidedFilter& GetGuidedFilter() { return guidedFilter; }
+	// views of a captured lightfield replace the simulated ones, an empty list goes back to simulating the scene
+	// simulated depth is unknown for real captures and stays zero
+	void SetViews(std::vector<Image> views)
+	{
+		for (const Image& view : views) {
+			if (view.width != width || view.height != height || view.format != Image::Format::eBGRA8) throw std::runtime_error("Loaded views must match the backend in size and format");
+		}
+		if (!views.empty() && views.size() != CameraGrid::nViews) throw std::runtime_error("Loaded views must cover the camera grid");
+		loadedViews = std::move(views);
+		frameGraph.SetPassEnabled(simulatePass, loadedViews.empty());
+		frameGraph.SetPassEnabled(loadViewsPass, !loadedViews.empty());
+	}
+
+private:
+	void BuildFrameGraph()
+	{
+		TransientDesc desc;
+		desc.width = width;
+		desc.height = height;
+
+		std::vector<FrameGraph<Image>::ResourceHandle> simulated;
+		for (UINT i = 0u; i < CameraGrid::nViews; i++) {
+			desc.format = static_cast<UINT>(Image::Format::eBGRA8);
+			viewArr[i] = frameGraph.CreateTransient("view" + std::to_string(i), desc);
+			desc.format = static_cast<UINT>(Image::Format::eR16Unorm);
+			simDepthArr[i] = frameGraph.CreateTransient("simDepth" + std::to_string(i), desc);
+			simulated.push_back(viewArr[i]);
+			simulated.push_back(simDepthArr[i]);
+		}
+		desc.format = static_cast<UINT>(Image::Format::eR32G32B32A32Float);
+		gradients = frameGraph.CreateTransient("gradients", desc);
+		desc.format = static_cast<UINT>(Image::Format::eR32Float);
+		outputDepth = frameGraph.CreateTransient("outputDepth", desc);
+		confidence = frameGraph.CreateTransient("confidence", desc); // only allocated while the refinement runs
+		// reduced resolution depth, sized by ResizeReduced
+		reducedViews = frameGraph.CreateTransient("reducedViews", desc);
+		reducedDepth = frameGraph.CreateTransient("reducedDepth", desc);
+		reducedConfidence = frameGraph.CreateTransient("reducedConfidence", desc);
+		ResizeReduced();
+
+		simulatePass = frameGraph.AddPass("Simulate", {}, simulated, [this] { Simulate(); });
+		loadViewsPass = frameGraph.AddPass("LoadViews", {}, simulated, [this] { LoadViews(); });
+		const std::vector<FrameGraph<Image>::ResourceHandle> views(viewArr.begin(), viewArr.end());
+		downsamplePass = frameGraph.AddPass("DownsampleViews", views, { reducedViews }, [this] {
+			DepthUpsampler::Downsample(GetViews(), depthScale, *frameGraph.Get(reducedViews));
+		});
+		gradientsPass = frameGraph.AddPass("Gradients", views, { gradients }, [this] {
+			depthEngine.ComputeGradients(GetViews(), *frameGraph.Get(gradients));
+		});
+		depthDeductionPass = frameGraph.AddPass("DepthDeduction", { gradients }, { outputDepth, confidence }, [this] {
+			depthEngine.DeduceDepth(*frameGraph.Get(gradients), *frameGraph.Get(outputDepth), frameGraph.Get(confidence));
+		});
+		fusedDepthPasses = AddDepthPasses("FusedDepth", [this](const std::array<ImageView, CameraGrid::nViews>& views, Image& depth, Image* pConfidence, float) {
+			depthEngine.DeduceDepthFused(views, depth, pConfidence);
+		});
+		epiDepthPasses = AddDepthPasses("EpiDepth", [this](const std::array<ImageView, CameraGrid::nViews>& views, Image& depth, Image* pConfidence, float) {
+			epiDepthEngine.DeduceDepth(views, depth, pConfidence);
+		});
+		planeSweepPasses = AddDepthPasses("PlaneSweepDepth", [this](const std::array<ImageView, CameraGrid::nViews>& views, Image& depth, Image* pConfidence, float viewScale) {
+			planeSweepEngine.DeduceDepth(views, depth, pConfidence, viewScale); // the range is given in texels of the full views
+		});
+		upsamplePass = frameGraph.AddPass("UpsampleDepth", { viewArr[CameraGrid::iCenterView], reducedViews, reducedDepth, reducedConfidence }, { outputDepth, confidence }, [this] {
+			const ImageView reducedGuide = DepthUpsampler::GetReducedViews(*frameGraph.Get(reducedViews))[CameraGrid::iCenterView];
+			depthUpsampler.Upsample(*frameGraph.Get(viewArr[CameraGrid::iCenterView]), reducedGuide, *frameGraph.Get(reducedDepth), *frameGraph.Get(reducedConfidence), depthScale, *frameGraph.Get(outputDepth), frameGraph.Get(confidence));
+		});
+		refinementPass = frameGraph.AddPass("DepthRefinement", { viewArr[CameraGrid::iCenterView], outputDepth, confidence }, { outputDepth }, [this] {
+			Image& depth = *frameGraph.Get(outputDepth);
+			guidedFilter.Filter(*frameGraph.Get(viewArr[CameraGrid::iCenterView]), depth, *frameGraph.Get(confidence), depth);
+		});
+		frameGraph.SetOutput(outputDepth, true);
+		UpdateDepthPasses();
+		frameGraph.SetPassEnabled(loadViewsPass, false);
+	}
+	// full resolution variant of a single pass depth engine, and one on the reduced views for the upsampling
+	// the last argument is the size of the views relative to the full ones, 1 / depthScale for the reduced pass
+	typedef std::function<void(const std::array<ImageView, CameraGrid::nViews>&, Image&, Image*, float)> DeduceFunc;
+	std::array<FrameGraph<Image>::PassHandle, 2> AddDepthPasses(const std::string& name, DeduceFunc deduce)
+	{
+		const std::vector<FrameGraph<Image>::ResourceHandle> views(viewArr.begin(), viewArr.end());
+		return {
+			frameGraph.AddPass(name, views, { outputDepth, confidence }, [this, deduce] {
+				deduce(GetViews(), *frameGraph.Get(outputDepth), frameGraph.Get(confidence), 1.0f);
+			}),
+			frameGraph.AddPass(name + "Reduced", { reducedViews }, { reducedDepth, reducedConfidence }, [this, deduce] {
+				deduce(DepthUpsampler::GetReducedViews(*frameGraph.Get(reducedViews)), *frameGraph.Get(reducedDepth), frameGraph.Get(reducedConfidence), 1.0f / static_cast<float>(depthScale));
+			})
+		};
+	}
+	void ResizeReduced()
+	{
+		TransientDesc desc;
+		desc.width = DepthUpsampler::GetReducedSize(width, depthScale);
+		desc.height = DepthUpsampler::GetReducedSize(height, depthScale);
+		desc.format = static_cast<UINT>(Image::Format::eR32Float);
+		frameGraph.SetDesc(reducedDepth, desc);
+		frameGraph.SetDesc(reducedConfidence, desc);
+		desc.format = static_cast<UINT>(Image::Format::eBGRA8);
+		desc.arraySize = CameraGrid::nViews;
+		frameGraph.SetDesc(reducedViews, desc);
+	}
+	void UpdateDepthPasses()
+	{
+		const bool bGradients = depthEngineType == DepthEngine::eGradients;
+		const bool bReduced = depthScale > 1u && !(bGradients && !bFusedDepth);
+		frameGraph.SetPassEnabled(gradientsPass, bGradients && !bFusedDepth);
+		frameGraph.SetPassEnabled(depthDeductionPass, bGradients && !bFusedDepth);
+		for (size_t i = 0u; i < 2u; i++) {
+			const bool bResolution = (i == 1u) == bReduced;
+			frameGraph.SetPassEnabled(fusedDepthPasses[i], bResolution && bGradients && bFusedDepth);
+			frameGraph.SetPassEnabled(epiDepthPasses[i], bResolution && depthEngineType == DepthEngine::eEpi);
+			frameGraph.SetPassEnabled(planeSweepPasses[i], bResolution && depthEngineType == DepthEngine::ePlaneSweep);
+		}
+		frameGraph.SetPassEnabled(downsamplePass, bReduced);
+		frameGraph.SetPassEnabled(upsamplePass, bReduced);
+	}
+	std::array<ImageView, CameraGrid::nViews> GetViews() const
+	{
+		std::array<ImageView, CameraGrid::nViews> views;
+		for (UINT i = 0u; i < CameraGrid::nViews; i++) views[i] = *frameGraph.Get(viewArr[i]);
+		return views;
+	}
+	// images are plain byte buffers, so any image large enough can back a smaller one
+	static FrameGraph<Image>::Allocator CreateAllocator()
+	{
+		FrameGraph<Image>::Allocator allocator;
+		allocator.getSize = [](const TransientDesc& desc) {
+			return static_cast<size_t>(desc.width) * desc.height * desc.arraySize * Image::GetTexelSize(static_cast<Image::Format>(desc.format));
+		};
+		allocator.create = [getSize = allocator.getSize](const TransientDesc& desc) {
+			auto pImage = std::make_unique<Image>();
+			pImage->data.reserve(getSize(desc));
+			Reinterpret(*pImage, desc);
+			return pImage;
+		};
+		allocator.canAlias = [getSize = allocator.getSize](const TransientDesc& physical, const TransientDesc& desc) { return getSize(physical) >= getSize(desc); };
+		allocator.reinterpret = &Reinterpret;
+		return allocator;
+	}
+	static void Reinterpret(Image& image, const TransientDesc& desc)
+	{
+		image.width = desc.width;
+		image.height = desc.height * desc.arraySize;
+		image.format = static_cast<Image::Format>(desc.format);
+		image.data.resize(static_cast<size_t>(image.GetRowPitch()) * image.height); // stays within the reserved capacity
+	}
+
+	void Simulate()
+	{
+		PROFILE_SCOPE("HeadlessBackend::Simulate");
+		const Mat3 camRot = Mat3::FromEuler(cameraRotation.x, cameraRotation.y, cameraRotation.z);
+		const float tanY = std::tan(CameraGrid::fovY * .5f);
+		const float tanX = tanY * static_cast<float>(width) / static_cast<float>(height);
+
+		for (UINT iView = 0u; iView < CameraGrid::nViews; iView++) {
+			float offsetX, offsetY;
+			CameraGrid::GetOffset(iView, offsetX, offsetY);
+			const Float3 origin = cameraPosition + camRot.Transform({ offsetX, offsetY, 0.0f });
+
+			// either target may have been culled
+			Image* pColorImage = frameGraph.Get(viewArr[iView]);
+			Image* pDepthImage = frameGraph.Get(simDepthArr[iView]);
+			if (!pColorImage && !pDepthImage) continue;
+			BYTE* pColor = pColorImage ? pColorImage->data.data() : nullptr;
+			uint16_t* pDepth = pDepthImage ? reinterpret_cast<uint16_t*>(pDepthImage->data.data()) : nullptr;
+
+			ParallelFor(0u, height, [&](size_t y) {
+				const float ndcY = 1.0f - 2.0f * (static_cast<float>(y) + .5f) / static_cast<float>(height);
+				for (size_t x = 0u; x < width; x++) {
+					const size_t i = y * width + x;
+					const float ndcX = 2.0f * (static_cast<float>(x) + .5f) / static_cast<float>(width) - 1.0f;
+					const Float3 viewDir = { ndcX * tanX, ndcY * tanY, 1.0f };
+
+					AnalyticScene::Hit hit;
+					if (!scene.Intersect(origin, camRot.Transform(viewDir), hit) || hit.t * viewDir.z > CameraGrid::farPlane) {
+						// cleared to zero like the render targets
+						if (pColor) memset(&pColor[i * 4u], 0, 4u);
+						if (pDepth) pDepth[i] = 0u;
+						continue;
+					}
+
+					if (pColor) {
+						// constant light direction towards the camera, ambient floor at .15
+						const float intensity = std::max(Float3::Dot(hit.normal, { 0.0f, 0.0f, -1.0f }), .1f);
+						const float shade = std::max(std::min(intensity, 1.0f), .15f);
+						const Float3 color = hit.color * shade;
+						pColor[i * 4u + 0u] = ToUnorm8(color.z);
+						pColor[i * 4u + 1u] = ToUnorm8(color.y);
+						pColor[i * 4u + 2u] = ToUnorm8(color.x);
+						pColor[i * 4u + 3u] = ToUnorm8(shade);
+					}
+					if (pDepth) {
+						// distance to the offset camera, inverted so near is bright
+						const float depth = 1.0f - Float3::Length(viewDir * hit.t) / 20.0f;
+						pDepth[i] = static_cast<uint16_t>(std::clamp(depth, 0.0f, 1.0f) * 65535.0f + .5f);
+					}
+				}
+			});
+		}
+	}
+	void LoadViews()
+	{
+		PROFILE_SCOPE("HeadlessBackend::LoadViews");
+		for (UINT iView = 0u; iView < CameraGrid::nViews; iView++) {
+			if (Image* pColorImage = frameGraph.Get(viewArr[iView])) memcpy(pColorImage->data.data(), loadedViews[iView].data.data(), loadedViews[iView].data.size());
+			if (Image* pDepthImage = frameGraph.Get(simDepthArr[iView])) std::fill(pDepthImage->data.begin(), pDepthImage->data.end(), BYTE(0u));
+		}
+	}
+	static inline BYTE ToUnorm8(float value)
+	{
+		return static_cast<BYTE>(std::clamp(value, 0.0f, 1.0f) * 255.0f + .5f);
+	}
+
+private:
+
+	const UINT width, height;
+	AnalyticScene scene;
+	Float3 cameraPosition, cameraRotation;
+
+	FrameGraph<Image> frameGraph;
+	std::array<FrameGraph<Image>::ResourceHandle, CameraGrid::nViews> viewArr, simDepthArr;
+	FrameGraph<Image>::ResourceHandle gradients, outputDepth, confidence, reducedViews, reducedDepth, reducedConfidence;
+	FrameGraph<Image>::PassHandle simulatePass, loadViewsPass, downsamplePass, gradientsPass, depthDeductionPass, upsamplePass, refinementPass;
+	std::array<FrameGraph<Image>::PassHandle, 2> fusedDepthPasses, epiDepthPasses, planeSweepPasses; // full and reduced resolution
+	CpuDepthEngine depthEngine;
+	EpiDepthEngine epiDepthEngine;
+	PlaneSweepEngine planeSweepEngine;
+	GuidedFilter guidedFilter;
+	DepthUpsampler depthUpsampler;
+	std::vector<Image> loadedViews;
+	bool bCapturedFrame = false;
+	DepthEngine depthEngineType = DepthEngine::eGradients;
+	bool bFusedDepth = true;
+	UINT depthScale = 1u;
+};
\ No newline at end of file
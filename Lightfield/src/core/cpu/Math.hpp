@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cmath>
+
+// minimal vector math for the cpu backend, follows the row vector conventions of DirectXMath
+struct Float3
+{
+	float x = 0.0f, y = 0.0f, z = 0.0f;
+
+	inline Float3 operator+(const Float3& o) const { return { x + o.x, y + o.y, z + o.z }; }
+	inline Float3 operator-(const Float3& o) const { return { x - o.x, y - o.y, z - o.z }; }
+	inline Float3 operator*(const Float3& o) const { return { x * o.x, y * o.y, z * o.z }; }
+	inline Float3 operator/(const Float3& o) const { return { x / o.x, y / o.y, z / o.z }; }
+	inline Float3 operator*(float s) const { return { x * s, y * s, z * s }; }
+	inline Float3 operator-() const { return { -x, -y, -z }; }
+
+	static inline float Dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	static inline float Length(const Float3& a) { return std::sqrt(Dot(a, a)); }
+	static inline Float3 Normalize(const Float3& a)
+	{
+		const float length = Length(a);
+		return length > 0.0f ? a * (1.0f / length) : a;
+	}
+};
+
+// 3x3 rotation, vectors are multiplied from the left
+struct Mat3
+{
+	Float3 rows[3] = { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } };
+
+	// same rotation as XMQuaternionRotationRollPitchYaw: roll around z, then pitch around x, then yaw around y
+	static Mat3 FromEuler(float pitch, float yaw, float roll)
+	{
+		const float cp = std::cos(pitch), sp = std::sin(pitch);
+		const float cy = std::cos(yaw), sy = std::sin(yaw);
+		const float cr = std::cos(roll), sr = std::sin(roll);
+		Mat3 rz, rx, ry;
+		rz.rows[0] = { cr, sr, 0.0f };
+		rz.rows[1] = { -sr, cr, 0.0f };
+		rx.rows[1] = { 0.0f, cp, sp };
+		rx.rows[2] = { 0.0f, -sp, cp };
+		ry.rows[0] = { cy, 0.0f, -sy };
+		ry.rows[2] = { sy, 0.0f, cy };
+		return rz * rx * ry;
+	}
+
+	inline Mat3 operator*(const Mat3& o) const
+	{
+		Mat3 result;
+		for (UINT i = 0u; i < 3u; i++) result.rows[i] = o.Transform(rows[i]);
+		return result;
+	}
+	inline Float3 Transform(const Float3& v) const
+	{
+		return rows[0] * v.x + rows[1] * v.y + rows[2] * v.z;
+	}
+	inline Mat3 Transposed() const
+	{
+		Mat3 result;
+		result.rows[0] = { rows[0].x, rows[1].x, rows[2].x };
+		result.rows[1] = { rows[0].y, rows[1].y, rows[2].y };
+		result.rows[2] = { rows[0].z, rows[1].z, rows[2].z };
+		return result;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,210 @@
+#pragma once
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define PLANE_SWEEP_SSE
+#endif
+
+#include "pipeline/CameraGrid.hpp"
+
+// depth by sweeping fronto-parallel planes through the scene, for disparities beyond the linear range of the gradients
+// every hypothesis shifts the 8 outer views onto the center view, the matching cost is box aggregated and the cheapest plane wins
+// the cost volume only ever exists for one tile per thread, so memory stays bounded however large the views or the plane count
+class PlaneSweepEngine
+{
+public:
+	PlaneSweepEngine() = default;
+	~PlaneSweepEngine() = default;
+	ROF_DELETE(PlaneSweepEngine);
+
+public:
+	// disparities in pixels between neighbouring views, positive for near surfaces like the output of the other engines
+	void SetRange(float minDisparity, float maxDisparity, UINT nPlanes)
+	{
+		if (nPlanes < 2u || maxDisparity <= minDisparity) throw std::runtime_error("Plane sweep needs at least two planes over a non-empty range");
+		this->minDisparity = minDisparity;
+		this->maxDisparity = maxDisparity;
+		this->nPlanes = nPlanes;
+	}
+	inline void SetRadius(UINT radius) { this->radius = std::min(radius, maxRadius); }
+
+	// views are bgra8 images laid out as in the camera grid, view index = u * 3 + v, same as for CpuDepthEngine
+	// confidence is optional, how far the winning cost lies below the mean cost over all planes
+	// the range is scaled into texels of the given views, 1/2 for views at half the resolution the range was set for
+	void DeduceDepth(const std::array<ImageView, CameraGrid::nViews>& views, Image& depth, Image* pConfidence = nullptr, float rangeScale = 1.0f)
+	{
+		PROFILE_SCOPE("PlaneSweepEngine::DeduceDepth");
+		const UINT width = depth.width, height = depth.height;
+		if (depth.format != Image::Format::eR32Float) throw std::runtime_error("Depth needs a single channel float image");
+		if (pConfidence && (pConfidence->width != width || pConfidence->height != height || pConfidence->format != Image::Format::eR32Float)) throw std::runtime_error("Confidence does not match the depth layout");
+		for (const ImageView& view : views) {
+			if (view.width != width || view.height != height || view.format != Image::Format::eBGRA8) throw std::runtime_error("View does not match the depth layout");
+		}
+		const float minPlane = minDisparity * rangeScale, maxPlane = maxDisparity * rangeScale;
+		PadLuma(views, width, height, std::max(std::abs(minPlane), std::abs(maxPlane)));
+
+		float* pDepth = reinterpret_cast<float*>(depth.data.data());
+		float* pConfidenceData = pConfidence ? reinterpret_cast<float*>(pConfidence->data.data()) : nullptr;
+		const float step = (maxPlane - minPlane) / static_cast<float>(nPlanes - 1u);
+		ParallelForTiles(width, height, tileSize, [&](UINT x0, UINT y0, UINT x1, UINT y1) {
+			// cost slice of the tile plus aggregation halo, clipped to the image
+			const int r = static_cast<int>(radius);
+			const UINT hx0 = static_cast<UINT>(std::max(static_cast<int>(x0) - r, 0)), hx1 = std::min(x1 + radius, width);
+			const UINT hy0 = static_cast<UINT>(std::max(static_cast<int>(y0) - r, 0)), hy1 = std::min(y1 + radius, height);
+			const size_t sliceWidth = hx1 - hx0, sliceHeight = hy1 - hy0;
+			const size_t tileWidth = x1 - x0, tileHeight = y1 - y0, tilePixels = tileWidth * tileHeight;
+
+			ScopedArena arena;
+			ArenaVector<float> slice(sliceWidth * sliceHeight), rowSums(sliceWidth * sliceHeight);
+			ArenaVector<float> volume(tilePixels * nPlanes); // [plane][y][x] of the tile
+			ArenaVector<double> columnSums(tileWidth);
+
+			for (UINT iPlane = 0u; iPlane < nPlanes; iPlane++) {
+				const float disparity = minPlane + step * static_cast<float>(iPlane);
+				for (size_t y = 0u; y < sliceHeight; y++) ComputeCostRow(disparity, hx0, static_cast<UINT>(hy0 + y), sliceWidth, &slice[y * sliceWidth]);
+
+				// box aggregation, horizontal window sums first, then the vertical ones averaged over the clipped window
+				// both slide a running sum along the tile, so the cost per pixel does not depend on the radius
+				// sums accumulate in double, float drift would build up along a row of large costs
+				const size_t sx0 = x0 - hx0, sx1 = x1 - hx0, sy0 = y0 - hy0;
+				for (size_t y = 0u; y < sliceHeight; y++) {
+					const float* pCost = &slice[y * sliceWidth];
+					float* pSum = &rowSums[y * sliceWidth];
+					size_t wx0 = sx0 >= radius ? sx0 - radius : 0u, wx1 = std::min(sx0 + radius + 1u, sliceWidth);
+					double sum = 0.0;
+					for (size_t wx = wx0; wx < wx1; wx++) sum += pCost[wx];
+					for (size_t x = sx0; x < sx1; x++) {
+						pSum[x] = static_cast<float>(sum / static_cast<double>(wx1 - wx0));
+						if (wx1 < sliceWidth) sum += pCost[wx1++];
+						if (x >= radius) sum -= pCost[wx0++];
+					}
+				}
+				size_t wy0 = sy0 >= radius ? sy0 - radius : 0u, wy1 = std::min(sy0 + radius + 1u, sliceHeight);
+				std::fill(columnSums.begin(), columnSums.end(), 0.0);
+				for (size_t wy = wy0; wy < wy1; wy++) AddRow(columnSums.data(), &rowSums[wy * sliceWidth + sx0], tileWidth, 1.0);
+				float* pPlane = &volume[iPlane * tilePixels];
+				for (size_t ty = 0u; ty < tileHeight; ty++) {
+					float* pOut = &pPlane[ty * tileWidth];
+					const double scale = 1.0 / static_cast<double>(wy1 - wy0);
+					for (size_t tx = 0u; tx < tileWidth; tx++) pOut[tx] = static_cast<float>(columnSums[tx] * scale);
+					if (wy1 < sliceHeight) AddRow(columnSums.data(), &rowSums[wy1++ * sliceWidth + sx0], tileWidth, 1.0);
+					if (sy0 + ty >= radius) AddRow(columnSums.data(), &rowSums[wy0++ * sliceWidth + sx0], tileWidth, -1.0);
+				}
+			}
+
+			// winner takes all, refined by a parabola through the winner and its neighbouring planes
+			for (size_t i = 0u; i < tilePixels; i++) {
+				UINT iBest = 0u;
+				float bestCost = volume[i], totalCost = 0.0f;
+				for (UINT iPlane = 0u; iPlane < nPlanes; iPlane++) {
+					const float cost = volume[iPlane * tilePixels + i];
+					totalCost += cost;
+					if (cost < bestCost) {
+						bestCost = cost;
+						iBest = iPlane;
+					}
+				}
+				float offset = 0.0f;
+				if (iBest > 0u && iBest + 1u < nPlanes) {
+					const float before = volume[(iBest - 1u) * tilePixels + i], after = volume[(iBest + 1u) * tilePixels + i];
+					const float curvature = before - 2.0f * bestCost + after;
+					if (curvature > 0.0f) offset = std::clamp(.5f * (before - after) / curvature, -.5f, .5f);
+				}
+				const size_t iPixel = (y0 + i / tileWidth) * width + x0 + i % tileWidth;
+				pDepth[iPixel] = minPlane + step * (static_cast<float>(iBest) + offset);
+				if (pConfidenceData) {
+					const float meanCost = totalCost / static_cast<float>(nPlanes);
+					pConfidenceData[iPixel] = meanCost > 0.0f ? 1.0f - bestCost / meanCost : 0.0f;
+				}
+			}
+		});
+	}
+
+private:
+	static inline void AddRow(double* pSums, const float* pRow, size_t n, double sign)
+	{
+		for (size_t i = 0u; i < n; i++) pSums[i] += sign * pRow[i];
+	}
+	// luma of every view with a border of repeated edge pixels wide enough for the largest shift
+	// shifted rows are then plain unaligned loads, no matter the hypothesis
+	void PadLuma(const std::array<ImageView, CameraGrid::nViews>& views, UINT width, UINT height, float maxAbsDisparity)
+	{
+		padding = static_cast<UINT>(std::ceil(maxAbsDisparity * CameraGrid::camLoopLim)) + 2u;
+		paddedWidth = width + 2u * padding;
+		const size_t planeSize = static_cast<size_t>(paddedWidth) * (height + 2u * padding);
+		if (luma.size() != planeSize * CameraGrid::nViews) {
+			luma.assign(planeSize * CameraGrid::nViews, 0.0f);
+			scratchMemory.Track(MemoryTag::eRenderTargets, luma.size() * sizeof(float));
+		}
+		ParallelFor(0u, static_cast<size_t>(CameraGrid::nViews) * (height + 2u * padding), [&](size_t i) {
+			const size_t iView = i / (height + 2u * padding), py = i % (height + 2u * padding);
+			const size_t y = static_cast<size_t>(std::clamp<int64_t>(static_cast<int64_t>(py) - padding, 0, height - 1));
+			const BYTE* pRow = views[iView].GetRow(y);
+			float* pLuma = &luma[iView * planeSize + py * paddedWidth];
+			for (size_t px = 0u; px < paddedWidth; px++) {
+				const size_t x = static_cast<size_t>(std::clamp<int64_t>(static_cast<int64_t>(px) - padding, 0, width - 1));
+				pLuma[px] = GetLuma(&pRow[x * 4u]);
+			}
+		});
+		lumaPlaneSize = planeSize;
+	}
+	inline const float* GetLumaRow(UINT iView, int64_t y) const
+	{
+		return &luma[iView * lumaPlaneSize + static_cast<size_t>(y + padding) * paddedWidth + padding];
+	}
+
+	// mean absolute luma difference between the center view and the outer views shifted by the hypothesis
+	// the shift is the same for every pixel of a plane, so the bilinear weights are constants and a row of pixels is four loads per view
+	void ComputeCostRow(float disparity, UINT x0, UINT y, size_t count, float* pCost) const
+	{
+		const float* pCenter = GetLumaRow(CameraGrid::iCenterView, y) + x0;
+		std::fill(pCost, pCost + count, 0.0f);
+		for (UINT iView = 0u; iView < CameraGrid::nViews; iView++) {
+			if (iView == CameraGrid::iCenterView) continue;
+			// the view at grid position (u, v) sees the center pixel c at c - (u, v) * disparity
+			const float shiftX = -disparity * static_cast<float>(static_cast<int>(iView / CameraGrid::nViewsPerAxis) - CameraGrid::camLoopLim);
+			const float shiftY = -disparity * static_cast<float>(static_cast<int>(iView % CameraGrid::nViewsPerAxis) - CameraGrid::camLoopLim);
+			const float floorX = std::floor(shiftX), floorY = std::floor(shiftY);
+			const float fx = shiftX - floorX, fy = shiftY - floorY;
+			const float w00 = (1.0f - fx) * (1.0f - fy), w01 = fx * (1.0f - fy), w10 = (1.0f - fx) * fy, w11 = fx * fy;
+			const int64_t sy = static_cast<int64_t>(y) + static_cast<int64_t>(floorY);
+			const float* pRow0 = GetLumaRow(iView, sy) + x0 + static_cast<int64_t>(floorX);
+			const float* pRow1 = GetLumaRow(iView, sy + 1) + x0 + static_cast<int64_t>(floorX);
+
+			size_t x = 0u;
+#ifdef PLANE_SWEEP_SSE
+			const __m128 v00 = _mm_set1_ps(w00), v01 = _mm_set1_ps(w01), v10 = _mm_set1_ps(w10), v11 = _mm_set1_ps(w11);
+			const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+			for (; x + 4u <= count; x += 4u) {
+				__m128 sample = _mm_mul_ps(v00, _mm_loadu_ps(&pRow0[x]));
+				sample = _mm_add_ps(sample, _mm_mul_ps(v01, _mm_loadu_ps(&pRow0[x + 1u])));
+				sample = _mm_add_ps(sample, _mm_mul_ps(v10, _mm_loadu_ps(&pRow1[x])));
+				sample = _mm_add_ps(sample, _mm_mul_ps(v11, _mm_loadu_ps(&pRow1[x + 1u])));
+				const __m128 difference = _mm_and_ps(_mm_sub_ps(sample, _mm_loadu_ps(&pCenter[x])), absMask);
+				_mm_storeu_ps(&pCost[x], _mm_add_ps(_mm_loadu_ps(&pCost[x]), difference));
+			}
+#endif
+			for (; x < count; x++) {
+				const float sample = w00 * pRow0[x] + w01 * pRow0[x + 1u] + w10 * pRow1[x] + w11 * pRow1[x + 1u];
+				pCost[x] += std::abs(sample - pCenter[x]);
+			}
+		}
+		for (size_t x = 0u; x < count; x++) pCost[x] *= 1.0f / static_cast<float>(CameraGrid::nViews - 1u);
+	}
+	static inline float GetLuma(const BYTE* pTexel)
+	{
+		return (pTexel[0] + pTexel[1] + pTexel[2]) * (0.333333f / 255.0f);
+	}
+
+private:
+	static constexpr UINT tileSize = 32u;
+	static constexpr UINT maxRadius = 16u;
+
+	float minDisparity = -2.0f, maxDisparity = 6.0f;
+	UINT nPlanes = 33u;
+	UINT radius = 3u; // of the box window the costs are aggregated over
+	std::vector<float> luma; // padded luma planes of all views
+	size_t lumaPlaneSize = 0u;
+	UINT padding = 0u, paddedWidth = 0u;
+	TrackedMemory scratchMemory;
+};
\ No newline at end of file
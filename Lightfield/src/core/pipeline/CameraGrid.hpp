@@ -0,0 +1,27 @@
+#pragma once
+
+// layout of the simulated camera array, shared by every backend
+// views are ordered column by column, view i sits at grid cell (i / 3, i % 3)
+struct CameraGrid
+{
+	static constexpr float offset = .01f; // distance to center camera
+	static constexpr int camLoopLim = 1;
+	static constexpr UINT nViewsPerAxis = 2u * camLoopLim + 1u;
+	static constexpr UINT nViews = nViewsPerAxis * nViewsPerAxis;
+	static constexpr UINT iCenterView = nViews / 2u; // the unshifted camera
+	static constexpr float fovY = 1.25f; // vertical field of view of every view
+	static constexpr float nearPlane = .1f, farPlane = 100.0f;
+
+	// view space offset of a camera, y is inverted to match the texture coord grid
+	static inline void GetOffset(UINT iView, float& x, float& y)
+	{
+		x = offset * static_cast<float>(static_cast<int>(iView / nViewsPerAxis) - camLoopLim);
+		y = offset * -static_cast<float>(static_cast<int>(iView % nViewsPerAxis) - camLoopLim);
+	}
+	// focal length in pixels for views of the given height
+	// deduced depth is the pixel shift between neighbouring views, so metric depth is focal length * offset / deduced depth
+	static inline float GetFocalLength(UINT height)
+	{
+		return .5f * static_cast<float>(height) / std::tan(.5f * fovY);
+	}
+};
\ No newline at end of file
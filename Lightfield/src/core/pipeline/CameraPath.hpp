@@ -0,0 +1,102 @@
+#pragma once
+
+#include <fstream>
+
+// camera trajectory of a session together with the input that drove it, recorded by the application and replayed headless
+// replays resample the trajectory at a fixed timestep, so every run renders the same frames however fast the recording ran
+class CameraPath
+{
+public:
+	// keys held during a sample, as a bitmask
+	enum Key : UINT { eForward = 1u << 0u, eBack = 1u << 1u, eLeft = 1u << 2u, eRight = 1u << 3u, eDown = 1u << 4u, eUp = 1u << 5u, eFast = 1u << 6u, eSlow = 1u << 7u };
+	struct Pose
+	{
+		std::array<float, 3> position;
+		std::array<float, 3> rotation; // euler angles in radians, pitch yaw roll
+	};
+	struct Sample
+	{
+		float deltaTime; // seconds since the previous sample, as the frame measured it
+		Pose pose; // camera after the input of this frame was applied
+		float mouseX, mouseY;
+		UINT keys;
+	};
+
+public:
+	CameraPath() = default;
+	~CameraPath() = default;
+	ROF_DELETE(CameraPath);
+
+public:
+	void Add(const Sample& sample)
+	{
+		times.push_back(times.empty() ? 0.0 : times.back() + sample.deltaTime);
+		samples.push_back(sample);
+	}
+	void Clear()
+	{
+		samples.clear();
+		times.clear();
+	}
+	inline const std::vector<Sample>& GetSamples() const { return samples; }
+	inline double GetDuration() const { return times.empty() ? 0.0 : times.back(); }
+	// frames a replay renders at the given timestep, both ends of the path included
+	inline UINT GetFrameCount(double timestep) const { return samples.empty() ? 0u : static_cast<UINT>(GetDuration() / timestep + 1e-6) + 1u; }
+
+	// pose at a time since the first sample, linear between samples and clamped to the ends of the path
+	Pose GetPose(double time) const
+	{
+		if (samples.empty()) throw std::runtime_error("Camera path is empty");
+		const size_t i = std::upper_bound(times.begin(), times.end(), time) - times.begin();
+		if (i == 0u) return samples.front().pose;
+		if (i >= samples.size()) return samples.back().pose;
+		const double span = times[i] - times[i - 1u];
+		const float t = span > 0.0 ? static_cast<float>((time - times[i - 1u]) / span) : 1.0f;
+		const Pose& a = samples[i - 1u].pose;
+		const Pose& b = samples[i].pose;
+		Pose pose;
+		for (size_t c = 0u; c < 3u; c++) {
+			pose.position[c] = a.position[c] + (b.position[c] - a.position[c]) * t;
+			pose.rotation[c] = a.rotation[c] + (b.rotation[c] - a.rotation[c]) * t;
+		}
+		return pose;
+	}
+
+	void Write(const std::filesystem::path& path) const
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file) throw std::runtime_error("Could not open camera path file");
+		const Header header = { pathMagic, pathVersion, static_cast<UINT>(samples.size()) };
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(samples.data()), samples.size() * sizeof(Sample));
+		if (!file) throw std::runtime_error("Writing camera path failed");
+	}
+	void Read(const std::filesystem::path& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file) throw std::runtime_error("Could not open camera path file");
+		Header header;
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (!file || header.magic != pathMagic) throw std::runtime_error("Not a camera path file");
+		if (header.version != pathVersion) throw std::runtime_error("Unsupported camera path version");
+
+		std::vector<Sample> loaded(header.nSamples);
+		file.read(reinterpret_cast<char*>(loaded.data()), loaded.size() * sizeof(Sample));
+		if (!file) throw std::runtime_error("Camera path is truncated");
+		Clear();
+		for (const Sample& sample : loaded) Add(sample);
+	}
+
+private:
+	struct Header
+	{
+		UINT magic, version, nSamples;
+	};
+
+private:
+	static constexpr UINT pathMagic = 0x5043464Cu; // "LFCP"
+	static constexpr UINT pathVersion = 1u;
+
+	std::vector<Sample> samples;
+	std::vector<double> times; // seconds since the first sample
+};
\ No newline at end of file
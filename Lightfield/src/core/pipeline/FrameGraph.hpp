@@ -0,0 +1,311 @@
+#pragma once
+
+#include <chrono>
+
+// size and format of a transient resource, the format is whatever the backend uses (DXGI_FORMAT, Image::Format)
+struct TransientDesc
+{
+	UINT width = 0u, height = 0u;
+	UINT format = 0u;
+	UINT arraySize = 1u;
+
+	inline bool operator==(const TransientDesc& o) const { return width == o.width && height == o.height && format == o.format && arraySize == o.arraySize; }
+	inline bool operator!=(const TransientDesc& o) const { return !(*this == o); }
+};
+
+// declarative description of a frame: passes name the resources they read and write, the graph does the rest
+// - passes whose outputs nobody consumes are culled, written resources nobody consumes are not allocated
+// - transient resources only live from their first to their last use and share memory once their lifetimes end
+// passes execute in declaration order, so a pass may only read what earlier passes wrote or what was imported
+template<typename Resource>
+class FrameGraph
+{
+public:
+	typedef UINT ResourceHandle;
+	typedef UINT PassHandle;
+
+	// backend hooks for creating the physical resources behind transients
+	struct Allocator
+	{
+		std::function<std::unique_ptr<Resource>(const TransientDesc&)> create;
+		std::function<size_t(const TransientDesc&)> getSize;
+		// whether a resource created for the first desc can stand in for the second, defaults to identical descs
+		std::function<bool(const TransientDesc& physical, const TransientDesc& desc)> canAlias;
+		// prepares an aliased resource for a different desc, required as soon as canAlias accepts differing descs
+		std::function<void(Resource&, const TransientDesc&)> reinterpret;
+	};
+	struct Stats
+	{
+		UINT nPasses = 0u, nCulledPasses = 0u;
+		UINT nTransients = 0u, nCulledTransients = 0u, nPhysical = 0u;
+		size_t bytesAllocated = 0u; // after aliasing
+		size_t bytesUnaliased = 0u; // every live transient with its own allocation
+	};
+
+public:
+	// physical resources get accounted under the tag, leave it empty if the allocator's resources track themselves
+	FrameGraph(Allocator allocator, std::optional<MemoryTag> tag = std::nullopt) : allocator(std::move(allocator)), tag(tag)
+	{
+		if (!this->allocator.canAlias) this->allocator.canAlias = [](const TransientDesc& physical, const TransientDesc& desc) { return physical == desc; };
+	}
+	~FrameGraph() = default;
+	ROF_DELETE(FrameGraph);
+
+public:
+	ResourceHandle CreateTransient(std::string name, const TransientDesc& desc)
+	{
+		ResourceNode node;
+		node.name = std::move(name);
+		node.desc = desc;
+		node.bTransient = true;
+		resources.push_back(std::move(node));
+		bDirty = true;
+		return static_cast<ResourceHandle>(resources.size() - 1u);
+	}
+	// external resources are only tracked for ordering and culling, they may be nullptr if the passes know where they live
+	ResourceHandle Import(std::string name, Resource* pResource = nullptr)
+	{
+		ResourceNode node;
+		node.name = std::move(name);
+		node.pResource = pResource;
+		resources.push_back(std::move(node));
+		bDirty = true;
+		return static_cast<ResourceHandle>(resources.size() - 1u);
+	}
+	PassHandle AddPass(std::string name, std::vector<ResourceHandle> reads, std::vector<ResourceHandle> writes, std::function<void()> execute)
+	{
+		for (ResourceHandle handle : reads) if (handle >= resources.size()) throw std::runtime_error("Frame graph pass reads an unknown resource");
+		for (ResourceHandle handle : writes) if (handle >= resources.size()) throw std::runtime_error("Frame graph pass writes an unknown resource");
+		PassNode pass;
+		pass.name = std::move(name);
+		pass.reads = std::move(reads);
+		pass.writes = std::move(writes);
+		pass.execute = std::move(execute);
+		passes.push_back(std::move(pass));
+		bDirty = true;
+		return static_cast<PassHandle>(passes.size() - 1u);
+	}
+
+	// resizes a transient between frames, its physical resource is reassigned on the next compile
+	void SetDesc(ResourceHandle handle, const TransientDesc& desc)
+	{
+		if (!resources[handle].bTransient) throw std::runtime_error("Only transient resources can change their desc");
+		if (resources[handle].desc == desc) return;
+		resources[handle].desc = desc;
+		bDirty = true;
+	}
+	// outputs are consumed after the graph ran (presentation, capture, recording) and stay alive until the next execution
+	void SetOutput(ResourceHandle handle, bool bOutput)
+	{
+		if (resources[handle].bOutput == bOutput) return;
+		resources[handle].bOutput = bOutput;
+		bDirty = true;
+	}
+	inline bool IsOutput(ResourceHandle handle) const { return resources[handle].bOutput; }
+	// disabled passes never run and count as culled, for switching between alternative implementations of a stage
+	void SetPassEnabled(PassHandle handle, bool bEnabled)
+	{
+		if (passes[handle].bEnabled == bEnabled) return;
+		passes[handle].bEnabled = bEnabled;
+		bDirty = true;
+	}
+	inline bool IsEnabled(PassHandle handle) const { return passes[handle].bEnabled; }
+
+	// culls, computes lifetimes and assigns physical resources, only does work after the graph or its outputs changed
+	void Compile()
+	{
+		if (!bDirty) return;
+		PROFILE_SCOPE("FrameGraph::Compile");
+		Cull();
+		ComputeLifetimes();
+		AssignPhysical();
+		bDirty = false;
+	}
+	void Execute()
+	{
+		Compile();
+		for (auto& pass : passes) {
+			if (!pass.bAlive) continue;
+
+			// aliased resources take on the desc of their new owner right before its first use
+			for (ResourceHandle handle : pass.acquires) {
+				PhysicalResource& entry = physical[resources[handle].iPhysical];
+				if (entry.currentDesc == resources[handle].desc) continue;
+				allocator.reinterpret(*entry.pResource, resources[handle].desc);
+				entry.currentDesc = resources[handle].desc;
+			}
+			const auto start = std::chrono::steady_clock::now();
+			pass.execute();
+			pass.lastTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+	}
+
+	// nullptr for resources that were culled this frame
+	inline Resource* Get(ResourceHandle handle) const
+	{
+		const ResourceNode& node = resources[handle];
+		if (!node.bUsed) return nullptr;
+		return node.bTransient ? physical[node.iPhysical].pResource.get() : node.pResource;
+	}
+	inline bool IsUsed(ResourceHandle handle) const { return resources[handle].bUsed; }
+	inline bool IsAlive(PassHandle handle) const { return passes[handle].bAlive; }
+	inline UINT GetPassCount() const { return static_cast<UINT>(passes.size()); }
+	inline const std::string& GetPassName(PassHandle handle) const { return passes[handle].name; }
+	// milliseconds the pass took on the cpu when it last ran, gpu passes only count recording their commands
+	inline double GetPassTime(PassHandle handle) const { return passes[handle].lastTime; }
+	inline const TransientDesc& GetDesc(ResourceHandle handle) const { return resources[handle].desc; }
+
+	Stats GetStats() const
+	{
+		Stats stats;
+		stats.nPasses = static_cast<UINT>(passes.size());
+		for (const auto& pass : passes) if (!pass.bAlive) stats.nCulledPasses++;
+		for (const auto& node : resources) {
+			if (!node.bTransient) continue;
+			stats.nTransients++;
+			if (node.bUsed) stats.bytesUnaliased += allocator.getSize(node.desc);
+			else stats.nCulledTransients++;
+		}
+		stats.nPhysical = static_cast<UINT>(physical.size());
+		for (const auto& entry : physical) stats.bytesAllocated += entry.size;
+		return stats;
+	}
+	// passes in execution order with their state, followed by the lifetime and physical slot of each transient
+	void WriteReport(std::ostream& stream) const
+	{
+		for (const auto& pass : passes) stream << (pass.bAlive ? "  pass " : "  culled ") << pass.name << "\n";
+		for (const auto& node : resources) {
+			if (!node.bTransient) continue;
+			if (!node.bUsed) stream << "  " << node.name << ": culled\n";
+			else stream << "  " << node.name << ": passes " << node.firstPass << "-" << node.lastPass << ", physical " << node.iPhysical << "\n";
+		}
+		const Stats stats = GetStats();
+		stream << "  " << stats.bytesAllocated / (1024.0 * 1024.0) << " MiB allocated, " << stats.bytesUnaliased / (1024.0 * 1024.0) << " MiB without aliasing\n";
+	}
+
+private:
+	struct ResourceNode
+	{
+		std::string name;
+		TransientDesc desc;
+		Resource* pResource = nullptr; // imported only
+		bool bTransient = false;
+		bool bOutput = false;
+
+		// compiled
+		bool bUsed = false;
+		UINT firstPass = 0u, lastPass = 0u;
+		UINT iPhysical = 0u;
+	};
+	struct PassNode
+	{
+		std::string name;
+		std::vector<ResourceHandle> reads, writes;
+		std::function<void()> execute;
+		bool bEnabled = true;
+		bool bAlive = false;
+		std::vector<ResourceHandle> acquires; // transients whose lifetime starts here
+		double lastTime = 0.0;
+	};
+	struct PhysicalResource
+	{
+		std::unique_ptr<Resource> pResource;
+		TransientDesc desc, currentDesc; // desc it was created with, desc of its current owner
+		size_t size = 0u;
+		UINT availableFrom = 0u; // first pass after its current owner's lifetime
+		bool bAssigned = false;
+		std::unique_ptr<TrackedMemory> pMemory;
+	};
+
+	void Cull()
+	{
+		// walk backwards from the outputs, a pass survives if anything it writes is still needed
+		std::vector<bool> needed(resources.size(), false);
+		for (size_t i = 0u; i < resources.size(); i++) needed[i] = resources[i].bOutput;
+		for (size_t i = passes.size(); i-- > 0u;) {
+			PassNode& pass = passes[i];
+			pass.bAlive = false;
+			if (!pass.bEnabled) continue;
+			for (ResourceHandle handle : pass.writes) pass.bAlive |= needed[handle];
+			if (pass.bAlive) for (ResourceHandle handle : pass.reads) needed[handle] = true;
+		}
+		for (size_t i = 0u; i < resources.size(); i++) resources[i].bUsed = needed[i];
+	}
+	void ComputeLifetimes()
+	{
+		const UINT endOfFrame = static_cast<UINT>(passes.size());
+		for (auto& node : resources) {
+			node.firstPass = endOfFrame;
+			node.lastPass = 0u;
+		}
+		for (UINT i = 0u; i < passes.size(); i++) {
+			if (!passes[i].bAlive) continue;
+			auto touch = [&](ResourceHandle handle) {
+				ResourceNode& node = resources[handle];
+				node.firstPass = std::min(node.firstPass, i);
+				node.lastPass = std::max(node.lastPass, i);
+			};
+			for (ResourceHandle handle : passes[i].reads) touch(handle);
+			for (ResourceHandle handle : passes[i].writes) touch(handle);
+		}
+		for (auto& node : resources) if (node.bOutput) node.lastPass = endOfFrame;
+	}
+	void AssignPhysical()
+	{
+		// transients in order of first use, each takes the smallest free compatible resource or a new one
+		std::vector<ResourceHandle> order;
+		for (ResourceHandle i = 0u; i < resources.size(); i++) if (resources[i].bTransient && resources[i].bUsed) order.push_back(i);
+		std::stable_sort(order.begin(), order.end(), [this](ResourceHandle a, ResourceHandle b) { return resources[a].firstPass < resources[b].firstPass; });
+
+		for (auto& entry : physical) {
+			entry.availableFrom = 0u;
+			entry.bAssigned = false;
+		}
+		for (auto& pass : passes) pass.acquires.clear();
+		for (ResourceHandle handle : order) {
+			ResourceNode& node = resources[handle];
+			const size_t size = allocator.getSize(node.desc);
+			size_t iBest = physical.size();
+			for (size_t i = 0u; i < physical.size(); i++) {
+				const PhysicalResource& entry = physical[i];
+				if (entry.bAssigned && entry.availableFrom > node.firstPass) continue;
+				if (!allocator.canAlias(entry.desc, node.desc)) continue;
+				if (entry.size >= 2u * size) continue; // a small transient should not pin a much larger allocation
+				if (iBest == physical.size() || entry.size < physical[iBest].size) iBest = i;
+			}
+			if (iBest == physical.size()) {
+				PhysicalResource entry;
+				entry.pResource = allocator.create(node.desc);
+				entry.desc = entry.currentDesc = node.desc;
+				entry.size = size;
+				entry.pMemory = std::make_unique<TrackedMemory>();
+				if (tag) entry.pMemory->Track(tag.value(), entry.size);
+				physical.push_back(std::move(entry));
+			}
+
+			PhysicalResource& entry = physical[iBest];
+			entry.bAssigned = true;
+			entry.availableFrom = node.lastPass + 1u;
+			node.iPhysical = static_cast<UINT>(iBest);
+			passes[node.firstPass].acquires.push_back(handle);
+		}
+
+		// anything not needed by the current configuration is released, handles keep their indices
+		std::vector<UINT> remap(physical.size());
+		UINT nKept = 0u;
+		for (size_t i = 0u; i < physical.size(); i++) {
+			remap[i] = nKept;
+			if (physical[i].bAssigned) physical[nKept++] = std::move(physical[i]);
+		}
+		physical.resize(nKept);
+		for (ResourceHandle handle : order) resources[handle].iPhysical = remap[resources[handle].iPhysical];
+	}
+
+private:
+	Allocator allocator;
+	const std::optional<MemoryTag> tag;
+	std::vector<ResourceNode> resources;
+	std::vector<PassNode> passes;
+	std::vector<PhysicalResource> physical;
+	bool bDirty = true;
+};
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <fstream>
+
+// per frame durations of the pipeline stages during a benchmark run, one column per stage in order of first appearance
+// written as csv for comparing runs, summarized the same way as the zones of the profiler
+class FrameTimings
+{
+public:
+	FrameTimings() = default;
+	~FrameTimings() = default;
+	ROF_DELETE(FrameTimings);
+
+public:
+	inline void BeginFrame() { frames.emplace_back(stages.size(), std::numeric_limits<double>::quiet_NaN()); }
+	void Set(const std::string& stage, double milliseconds)
+	{
+		if (frames.empty()) throw std::runtime_error("Frame timings need a frame before its stages");
+		auto it = std::find(stages.begin(), stages.end(), stage);
+		if (it == stages.end()) {
+			it = stages.insert(stages.end(), stage);
+			for (auto& frame : frames) frame.push_back(std::numeric_limits<double>::quiet_NaN());
+		}
+		frames.back()[it - stages.begin()] = milliseconds;
+	}
+	// every pass that ran in the last execution of the graph, culled and disabled ones stay empty
+	template<typename Resource>
+	void SetPasses(const FrameGraph<Resource>& frameGraph)
+	{
+		for (UINT i = 0u; i < frameGraph.GetPassCount(); i++) {
+			if (frameGraph.IsAlive(i)) Set(frameGraph.GetPassName(i), frameGraph.GetPassTime(i));
+		}
+	}
+
+	void WriteCsv(const std::filesystem::path& path) const
+	{
+		std::ofstream file(path, std::ios::trunc);
+		if (!file) throw std::runtime_error("Could not open frame timings file");
+		file << "frame";
+		for (const auto& stage : stages) file << "," << stage;
+		file << "\n" << std::fixed << std::setprecision(3);
+		for (size_t i = 0u; i < frames.size(); i++) {
+			file << i;
+			for (double value : frames[i]) {
+				file << ",";
+				if (!std::isnan(value)) file << value;
+			}
+			file << "\n";
+		}
+		if (!file) throw std::runtime_error("Writing frame timings failed");
+	}
+	// min, mean, p99 and max of every stage over the frames it ran in
+	void WriteSummary(std::ostream& stream) const
+	{
+		stream << std::left << std::setw(32) << "stage" << std::right << std::setw(10) << "frames"
+			<< std::setw(12) << "min ms" << std::setw(12) << "mean ms" << std::setw(12) << "p99 ms" << std::setw(12) << "max ms" << "\n";
+		stream << std::fixed << std::setprecision(3);
+		for (size_t iStage = 0u; iStage < stages.size(); iStage++) {
+			std::vector<double> values;
+			for (const auto& frame : frames) if (!std::isnan(frame[iStage])) values.push_back(frame[iStage]);
+			if (values.empty()) continue;
+			std::sort(values.begin(), values.end());
+			double total = 0.0;
+			for (double value : values) total += value;
+			stream << std::left << std::setw(32) << stages[iStage] << std::right << std::setw(10) << values.size()
+				<< std::setw(12) << values.front() << std::setw(12) << total / values.size()
+				<< std::setw(12) << values[std::min(values.size() - 1u, static_cast<size_t>(values.size() * .99))] << std::setw(12) << values.back() << "\n";
+		}
+	}
+
+private:
+	std::vector<std::string> stages;
+	std::vector<std::vector<double>> frames;
+};
\ No newline at end of file
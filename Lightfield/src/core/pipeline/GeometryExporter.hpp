@@ -0,0 +1,210 @@
+#pragma once
+
+#include <mutex>
+#include <fstream>
+
+// turns deduced depth into 3d geometry in the center camera's view space (left handed, y up), written as binary ply
+// rows are encoded in chunks on the task scheduler and appended in order, so memory stays bounded by the chunks in flight
+class GeometryExporter
+{
+public:
+	struct Options
+	{
+		bool bMesh = false; // triangulate the pixel grid, triangles spanning a depth discontinuity are cut
+		float maxDiscontinuity = .05f; // relative depth difference within a triangle that is still connected
+		float minDepth = CameraGrid::nearPlane, maxDepth = CameraGrid::farPlane; // points outside are dropped
+		UINT nRowsPerChunk = 64u;
+		UINT nChunksInFlight = 8u;
+	};
+	struct Stats
+	{
+		size_t nVertices = 0u, nFaces = 0u;
+	};
+
+public:
+	static Stats Export(const Image& disparity, const Image* pColor, const std::filesystem::path& path)
+	{
+		return Export(disparity, pColor, path, Options());
+	}
+	// disparity is the output depth, color an optional bgra8 view of the same size giving the vertex colors
+	static Stats Export(const Image& disparity, const Image* pColor, const std::filesystem::path& path, const Options& options)
+	{
+		PROFILE_SCOPE("GeometryExporter::Export");
+		const UINT width = disparity.width, height = disparity.height;
+		if (pColor && (pColor->width != width || pColor->height != height || pColor->format != Image::Format::eBGRA8)) throw std::runtime_error("Vertex colors do not match the depth layout");
+		const Grid grid = { disparity, options, CameraGrid::GetFocalLength(height) };
+
+		// counting pass first, the ply header needs the totals and faces need the index of every vertex
+		std::vector<UINT> rowVertices(height), rowFaces(height, 0u);
+		ParallelFor(0u, height, [&](size_t y) {
+			ScopedArena arena;
+			ArenaVector<float> depth(width), nextDepth(width);
+			grid.GetRow(static_cast<UINT>(y), depth.data());
+			rowVertices[y] = static_cast<UINT>(std::count_if(depth.begin(), depth.end(), [](float z) { return z > 0.0f; }));
+			if (!options.bMesh || y + 1u >= height) return;
+			grid.GetRow(static_cast<UINT>(y) + 1u, nextDepth.data());
+			for (UINT x = 0u; x + 1u < width; x++) {
+				std::array<float, 4> quad = { depth[x], depth[x + 1u], nextDepth[x], nextDepth[x + 1u] };
+				rowFaces[y] += grid.IsConnected(quad[0], quad[2], quad[1]) + grid.IsConnected(quad[1], quad[2], quad[3]);
+			}
+		});
+		std::vector<size_t> rowOffsets(height + 1u, 0u);
+		for (UINT y = 0u; y < height; y++) rowOffsets[y + 1u] = rowOffsets[y] + rowVertices[y];
+		Stats stats;
+		stats.nVertices = rowOffsets[height];
+		for (UINT faces : rowFaces) stats.nFaces += faces;
+		if (stats.nVertices > UINT_MAX) throw std::runtime_error("Too many vertices for 32-bit ply indices");
+
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file) throw std::runtime_error("Could not open ply file");
+		file << "ply\nformat binary_little_endian 1.0\ncomment lightfield deduced depth\n";
+		file << "element vertex " << stats.nVertices << "\nproperty float x\nproperty float y\nproperty float z\n";
+		if (pColor) file << "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+		if (options.bMesh) file << "element face " << stats.nFaces << "\nproperty list uchar uint vertex_indices\n";
+		file << "end_header\n";
+
+		const UINT nChunks = (height + options.nRowsPerChunk - 1u) / options.nRowsPerChunk;
+		const size_t vertexSize = 3u * sizeof(float) + (pColor ? 3u : 0u);
+		StreamChunks(file, nChunks, options, [&](UINT iChunk, std::vector<char>& buffer) {
+			const UINT y0 = iChunk * options.nRowsPerChunk, y1 = std::min(y0 + options.nRowsPerChunk, height);
+			buffer.resize((rowOffsets[y1] - rowOffsets[y0]) * vertexSize);
+			char* pOut = buffer.data();
+			ArenaVector<float> depth(width);
+			for (UINT y = y0; y < y1; y++) {
+				grid.GetRow(y, depth.data());
+				for (UINT x = 0u; x < width; x++) {
+					if (depth[x] <= 0.0f) continue;
+					// back through the pinhole of the center camera, pixel centers at half offsets
+					const float position[3] = {
+						(static_cast<float>(x) + .5f - .5f * width) / grid.focalLength * depth[x],
+						(.5f * height - static_cast<float>(y) - .5f) / grid.focalLength * depth[x],
+						depth[x]
+					};
+					memcpy(pOut, position, sizeof(position));
+					pOut += sizeof(position);
+					if (!pColor) continue;
+					const BYTE* pTexel = &pColor->data[(static_cast<size_t>(y) * width + x) * 4u];
+					const BYTE rgb[3] = { pTexel[2], pTexel[1], pTexel[0] };
+					memcpy(pOut, rgb, sizeof(rgb));
+					pOut += sizeof(rgb);
+				}
+			}
+		});
+
+		if (options.bMesh) {
+			// two triangles per quad of neighbouring pixels, indices follow the order vertices were written in
+			StreamChunks(file, nChunks, options, [&](UINT iChunk, std::vector<char>& buffer) {
+				const UINT y0 = iChunk * options.nRowsPerChunk, y1 = std::min(y0 + options.nRowsPerChunk, height);
+				size_t nFaces = 0u;
+				for (UINT y = y0; y < y1; y++) nFaces += rowFaces[y];
+				buffer.resize(nFaces * faceSize);
+				char* pOut = buffer.data();
+
+				ArenaVector<float> depth(width), nextDepth(width);
+				ArenaVector<UINT> indices(width), nextIndices(width);
+				if (y0 + 1u < height) grid.GetRow(y0, nextDepth.data());
+				for (UINT y = y0; y < y1 && y + 1u < height; y++) {
+					depth.swap(nextDepth);
+					grid.GetRow(y + 1u, nextDepth.data());
+					GetIndices(depth, rowOffsets[y], indices);
+					GetIndices(nextDepth, rowOffsets[y + 1u], nextIndices);
+					for (UINT x = 0u; x + 1u < width; x++) {
+						if (grid.IsConnected(depth[x], nextDepth[x], depth[x + 1u])) WriteFace(pOut, indices[x], nextIndices[x], indices[x + 1u]);
+						if (grid.IsConnected(depth[x + 1u], nextDepth[x], nextDepth[x + 1u])) WriteFace(pOut, indices[x + 1u], nextIndices[x], nextIndices[x + 1u]);
+					}
+				}
+			});
+		}
+		if (!file) throw std::runtime_error("Writing ply file failed");
+		return stats;
+	}
+
+private:
+	// metric depth per pixel, zero where there is no usable point
+	struct Grid
+	{
+		const Image& disparity;
+		const Options& options;
+		const float focalLength;
+
+		void GetRow(UINT y, float* pDepth) const
+		{
+			for (UINT x = 0u; x < disparity.width; x++) {
+				const float value = disparity.GetValue(x, y);
+				const float depth = focalLength * CameraGrid::offset / value;
+				pDepth[x] = std::isfinite(depth) && depth >= options.minDepth && depth <= options.maxDepth ? depth : 0.0f;
+			}
+		}
+		inline bool IsConnected(float a, float b, float c) const
+		{
+			if (a <= 0.0f || b <= 0.0f || c <= 0.0f) return false;
+			return std::max({ a, b, c }) <= std::min({ a, b, c }) * (1.0f + options.maxDiscontinuity);
+		}
+	};
+
+	static void GetIndices(const ArenaVector<float>& depth, size_t offset, ArenaVector<UINT>& indices)
+	{
+		UINT index = static_cast<UINT>(offset);
+		for (size_t x = 0u; x < depth.size(); x++) {
+			indices[x] = index;
+			if (depth[x] > 0.0f) index++;
+		}
+	}
+	static inline void WriteFace(char*& pOut, UINT a, UINT b, UINT c)
+	{
+		*pOut++ = 3;
+		const UINT face[3] = { a, b, c };
+		memcpy(pOut, face, sizeof(face));
+		pOut += sizeof(face);
+	}
+
+	// encodes chunks as tasks of the shared scheduler and appends them to the file in chunk order
+	// row scratch of the encoders lives in the arena of the task, only the encoded chunks are heap allocated
+	// no more than nChunksInFlight chunks are encoded ahead of the writer, which caps the memory used
+	template<typename Encode>
+	static void StreamChunks(std::ofstream& file, UINT nChunks, const Options& options, Encode&& encode)
+	{
+		std::mutex mutex;
+		std::vector<std::vector<char>> chunks(nChunks);
+		std::vector<bool> bEncoded(nChunks, false);
+		TaskScheduler::TaskGroup group;
+		UINT iNextEncode = 0u, iNextWrite = 0u;
+
+		for (; iNextWrite < nChunks; iNextWrite++) {
+			for (; iNextEncode < nChunks && iNextEncode - iNextWrite < std::max(options.nChunksInFlight, 1u); iNextEncode++) {
+				group.Run([&, iChunk = iNextEncode]() {
+					std::vector<char> buffer;
+					encode(iChunk, buffer);
+					MemoryTracker::Get().Allocate(MemoryTag::eExport, buffer.size());
+					std::lock_guard<std::mutex> lock(mutex);
+					chunks[iChunk] = std::move(buffer);
+					bEncoded[iChunk] = true;
+				});
+			}
+
+			// the writer helps encoding while the next chunk is not done yet
+			TaskScheduler::Get().WaitUntil([&] {
+				std::lock_guard<std::mutex> lock(mutex);
+				return bEncoded[iNextWrite] || group.HasFailed();
+			});
+			std::vector<char> buffer;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (!bEncoded[iNextWrite]) break;
+				buffer = std::move(chunks[iNextWrite]);
+			}
+			file.write(buffer.data(), buffer.size());
+			MemoryTracker::Get().Free(MemoryTag::eExport, buffer.size());
+		}
+		try {
+			group.Wait();
+		}
+		catch (...) {
+			for (UINT i = iNextWrite; i < nChunks; i++) if (bEncoded[i]) MemoryTracker::Get().Free(MemoryTag::eExport, chunks[i].size());
+			throw;
+		}
+	}
+
+private:
+	static constexpr size_t faceSize = 1u + 3u * sizeof(UINT);
+};
\ No newline at end of file
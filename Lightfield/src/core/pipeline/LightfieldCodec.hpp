@@ -0,0 +1,439 @@
+#pragma once
+
+#include <fstream>
+
+// lossless archive of the views of one frame, the near identical views are stored as one view plus their differences
+// the center view is predicted spatially, every other view from the center view shifted by a disparity per 8x8 block
+// planes are cut into row stripes with their own rANS coded streams, so stripes encode and decode in parallel
+class LightfieldCodec
+{
+public:
+	// views in camera grid order, all bgra8, disparity the output depth the views are predicted with
+	static std::vector<BYTE> Encode(const std::vector<Image>& views, const Image& disparity, UINT nRowsPerChunk = 64u)
+	{
+		PROFILE_SCOPE("LightfieldCodec::Encode");
+		const UINT width = disparity.width, height = disparity.height;
+		if (views.size() != CameraGrid::nViews) throw std::runtime_error("Lightfield archives need every view of the camera grid");
+		if (disparity.format != Image::Format::eR32Float) throw std::runtime_error("Lightfield archives need single channel float depth");
+		for (const Image& view : views) {
+			if (view.width != width || view.height != height || view.format != Image::Format::eBGRA8) throw std::runtime_error("Views do not match the depth layout");
+		}
+		if (nRowsPerChunk == 0u || nRowsPerChunk % blockSize != 0u) throw std::runtime_error("Lightfield archive stripes need to cover whole disparity blocks");
+
+		// one disparity per block, the output depth is too noisy to be worth storing per texel
+		const Header header = { archiveMagic, archiveVersion, width, height, CameraGrid::nViews, nRowsPerChunk };
+		const UINT nBlocksX = header.GetBlockCount(width);
+		std::vector<int16_t> blocks(static_cast<size_t>(nBlocksX) * header.GetBlockCount(height));
+		ParallelFor(0u, header.GetBlockCount(height), [&](size_t by) {
+			for (UINT bx = 0u; bx < nBlocksX; bx++) blocks[by * nBlocksX + bx] = EstimateBlockDisparity(views, disparity, bx, static_cast<UINT>(by));
+		});
+
+		const UINT nChunks = header.GetChunkCount();
+		std::vector<std::vector<BYTE>> chunks(static_cast<size_t>(nChunks) * (CameraGrid::nViews + 1u));
+		ParallelFor(0u, chunks.size(), [&](size_t iTask) {
+			const UINT iPlane = static_cast<UINT>(iTask / nChunks), iChunk = static_cast<UINT>(iTask % nChunks);
+			const UINT y0 = iChunk * nRowsPerChunk, y1 = std::min(y0 + nRowsPerChunk, height);
+			const size_t nSymbols = static_cast<size_t>(y1 - y0) * width;
+			ScopedArena arena; // stripe scratch, only the encoded streams are kept
+			ArenaVector<BYTE> symbols(nSymbols);
+			if (iPlane == 0u) {
+				// block disparity as the difference to its left neighbour, low and high byte in separate streams
+				const UINT by0 = y0 / blockSize, by1 = header.GetBlockCount(y1);
+				symbols.resize(static_cast<size_t>(by1 - by0) * nBlocksX);
+				for (UINT iByte = 0u; iByte < 2u; iByte++) {
+					for (UINT by = by0; by < by1; by++) {
+						for (UINT bx = 0u; bx < nBlocksX; bx++) {
+							const uint16_t delta = ZigZag16(GetDisparityDelta(blocks.data(), nBlocksX, bx, by, by0));
+							symbols[static_cast<size_t>(by - by0) * nBlocksX + bx] = static_cast<BYTE>(delta >> (8u * iByte));
+						}
+					}
+					EncodeStream(symbols, chunks[iTask]);
+				}
+				return;
+			}
+			// every channel of the stripe picks the predictor that leaves the fewest bits, the center view can only predict itself
+			const UINT iView = iPlane - 1u;
+			const bool bCenter = iView == CameraGrid::iCenterView;
+			ArenaVector<BYTE> warped(nSymbols), candidate(nSymbols);
+			for (UINT c = 0u; c < 4u; c++) {
+				const BYTE* pPlane = views[iView].data.data() + c;
+				if (!bCenter) WarpStripe(views[CameraGrid::iCenterView], blocks.data(), iView, y0, y1, c, warped.data());
+				Predictor best = Predictor::eSpatial;
+				double bestBits = std::numeric_limits<double>::max();
+				for (UINT i = 0u; i < (bCenter ? 1u : static_cast<UINT>(Predictor::eCount)); i++) {
+					const Predictor predictor = static_cast<Predictor>(i);
+					for (UINT y = y0; y < y1; y++) {
+						for (UINT x = 0u; x < width; x++) {
+							const BYTE prediction = Predict(predictor, pPlane, warped.data(), width, x, y, y0);
+							candidate[static_cast<size_t>(y - y0) * width + x] = ZigZag8(static_cast<BYTE>(pPlane[(static_cast<size_t>(y) * width + x) * 4u] - prediction));
+						}
+					}
+					const double bits = EstimateBits(candidate);
+					if (bits >= bestBits) continue;
+					best = predictor;
+					bestBits = bits;
+					symbols.swap(candidate);
+				}
+				chunks[iTask].push_back(static_cast<BYTE>(best));
+				EncodeStream(symbols, chunks[iTask]);
+			}
+		});
+
+		// header, size of every chunk, then the chunks themselves
+		std::vector<BYTE> archive(sizeof(Header) + chunks.size() * sizeof(UINT));
+		memcpy(archive.data(), &header, sizeof(Header));
+		for (size_t i = 0u; i < chunks.size(); i++) {
+			const UINT size = static_cast<UINT>(chunks[i].size());
+			memcpy(&archive[sizeof(Header) + i * sizeof(UINT)], &size, sizeof(UINT));
+		}
+		for (const auto& chunk : chunks) archive.insert(archive.end(), chunk.begin(), chunk.end());
+		return archive;
+	}
+	// views come back bit exact
+	static void Decode(const std::vector<BYTE>& archive, std::vector<Image>& views)
+	{
+		PROFILE_SCOPE("LightfieldCodec::Decode");
+		Header header;
+		if (archive.size() < sizeof(Header)) throw std::runtime_error("Lightfield archive is truncated");
+		memcpy(&header, archive.data(), sizeof(Header));
+		if (header.magic != archiveMagic || header.version != archiveVersion) throw std::runtime_error("Not a lightfield archive of a supported version");
+		if (header.nViews != CameraGrid::nViews || header.nRowsPerChunk == 0u || header.nRowsPerChunk % blockSize != 0u) throw std::runtime_error("Lightfield archive does not match the camera grid");
+		const UINT width = header.width, height = header.height, nChunks = header.GetChunkCount();
+
+		// offsets of all chunks from the size table
+		const size_t nTasks = static_cast<size_t>(nChunks) * (CameraGrid::nViews + 1u);
+		std::vector<size_t> offsets(nTasks + 1u, sizeof(Header) + nTasks * sizeof(UINT));
+		if (archive.size() < offsets[0]) throw std::runtime_error("Lightfield archive is truncated");
+		for (size_t i = 0u; i < nTasks; i++) {
+			UINT size;
+			memcpy(&size, &archive[sizeof(Header) + i * sizeof(UINT)], sizeof(UINT));
+			offsets[i + 1u] = offsets[i] + size;
+		}
+		if (archive.size() < offsets[nTasks]) throw std::runtime_error("Lightfield archive is truncated");
+
+		views.assign(CameraGrid::nViews, { width, height, Image::Format::eBGRA8, std::vector<BYTE>(static_cast<size_t>(width) * height * 4u) });
+		const UINT nBlocksX = header.GetBlockCount(width);
+		std::vector<int16_t> blocks(static_cast<size_t>(nBlocksX) * header.GetBlockCount(height));
+		auto decodeChunk = [&](size_t iTask) {
+			const UINT iPlane = static_cast<UINT>(iTask / nChunks), iChunk = static_cast<UINT>(iTask % nChunks);
+			const UINT y0 = iChunk * header.nRowsPerChunk, y1 = std::min(y0 + header.nRowsPerChunk, height);
+			const BYTE* pStream = archive.data() + offsets[iTask];
+			const BYTE* pEnd = archive.data() + offsets[iTask + 1u];
+			ScopedArena arena;
+			ArenaVector<BYTE> symbols(static_cast<size_t>(y1 - y0) * width);
+			if (iPlane == 0u) {
+				const UINT by0 = y0 / blockSize, by1 = header.GetBlockCount(y1);
+				symbols.resize(static_cast<size_t>(by1 - by0) * nBlocksX);
+				ArenaVector<BYTE> highBytes(symbols.size());
+				DecodeStream(pStream, pEnd, symbols);
+				DecodeStream(pStream, pEnd, highBytes);
+				// rows resolve left to right, so every delta finds its reference already decoded
+				for (UINT by = by0; by < by1; by++) {
+					for (UINT bx = 0u; bx < nBlocksX; bx++) {
+						const size_t iSymbol = static_cast<size_t>(by - by0) * nBlocksX + bx;
+						const int16_t delta = UnZigZag16(static_cast<uint16_t>(symbols[iSymbol] | highBytes[iSymbol] << 8u));
+						const int16_t reference = GetDisparityReference(blocks.data(), nBlocksX, bx, by, by0);
+						blocks[static_cast<size_t>(by) * nBlocksX + bx] = static_cast<int16_t>(static_cast<uint16_t>(reference) + static_cast<uint16_t>(delta));
+					}
+				}
+				return;
+			}
+			const UINT iView = iPlane - 1u;
+			ArenaVector<BYTE> warped(symbols.size());
+			for (UINT c = 0u; c < 4u; c++) {
+				if (pStream >= pEnd) throw std::runtime_error("Lightfield archive stream is truncated");
+				const Predictor predictor = static_cast<Predictor>(*pStream++);
+				if (predictor >= Predictor::eCount || (predictor != Predictor::eSpatial && iView == CameraGrid::iCenterView)) throw std::runtime_error("Lightfield archive uses an unknown predictor");
+				if (predictor != Predictor::eSpatial) WarpStripe(views[CameraGrid::iCenterView], blocks.data(), iView, y0, y1, c, warped.data());
+				DecodeStream(pStream, pEnd, symbols);
+				BYTE* pPlane = views[iView].data.data() + c;
+				for (UINT y = y0; y < y1; y++) {
+					for (UINT x = 0u; x < width; x++) {
+						const BYTE prediction = Predict(predictor, pPlane, warped.data(), width, x, y, y0);
+						pPlane[(static_cast<size_t>(y) * width + x) * 4u] = static_cast<BYTE>(prediction + UnZigZag8(symbols[static_cast<size_t>(y - y0) * width + x]));
+					}
+				}
+			}
+		};
+
+		// disparity and center view first, all other views only depend on those two
+		ParallelFor(0u, 2u * nChunks, [&](size_t i) {
+			decodeChunk(i < nChunks ? i : (CameraGrid::iCenterView + 1u) * nChunks + i - nChunks);
+		});
+		ParallelFor(0u, (CameraGrid::nViews - 1u) * nChunks, [&](size_t i) {
+			UINT iView = static_cast<UINT>(i / nChunks);
+			if (iView >= CameraGrid::iCenterView) iView++;
+			decodeChunk((iView + 1u) * nChunks + i % nChunks);
+		});
+	}
+
+	static void Write(const std::filesystem::path& path, const std::vector<Image>& views, const Image& disparity)
+	{
+		const std::vector<BYTE> archive = Encode(views, disparity);
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file) throw std::runtime_error("Could not open lightfield archive");
+		file.write(reinterpret_cast<const char*>(archive.data()), archive.size());
+		if (!file) throw std::runtime_error("Writing lightfield archive failed");
+	}
+	static void Read(const std::filesystem::path& path, std::vector<Image>& views)
+	{
+		PROFILE_SCOPE("LightfieldCodec::Read");
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file) throw std::runtime_error("Could not open lightfield archive");
+		std::vector<BYTE> archive(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(archive.data()), archive.size());
+		if (!file) throw std::runtime_error("Reading lightfield archive failed");
+		Decode(archive, views);
+	}
+
+private:
+	enum class Predictor : BYTE { eSpatial, eCenter, eCenterGradient, eCount };
+	struct Header
+	{
+		UINT magic, version, width, height, nViews, nRowsPerChunk;
+
+		inline UINT GetChunkCount() const { return (height + nRowsPerChunk - 1u) / nRowsPerChunk; }
+		static inline UINT GetBlockCount(UINT size) { return (size + blockSize - 1u) / blockSize; }
+	};
+
+	// median of the output depth over the block, then refined to the fixed point step that predicts the views best
+	static int16_t EstimateBlockDisparity(const std::vector<Image>& views, const Image& disparity, UINT bx, UINT by)
+	{
+		const UINT x0 = bx * blockSize, y0 = by * blockSize;
+		const UINT x1 = std::min(x0 + blockSize, disparity.width), y1 = std::min(y0 + blockSize, disparity.height);
+		std::array<float, blockSize * blockSize> values;
+		UINT nValues = 0u;
+		for (UINT y = y0; y < y1; y++) {
+			for (UINT x = x0; x < x1; x++) {
+				const float d = disparity.GetValue(x, y);
+				if (std::isfinite(d)) values[nValues++] = d;
+			}
+		}
+		int initial = 0;
+		if (nValues > 0u) {
+			std::nth_element(values.begin(), values.begin() + nValues / 2u, values.begin() + nValues);
+			initial = static_cast<int>(std::lround(std::clamp(values[nValues / 2u] * disparityOne, -32767.0f, 32767.0f)));
+		}
+
+		// matched on the green channel only, the other channels move the same way
+		int best = initial;
+		UINT bestCost = std::numeric_limits<UINT>::max();
+		for (int q = std::max(initial - refineSteps, -32767); q <= std::min(initial + refineSteps, 32767); q++) {
+			UINT cost = 0u;
+			for (UINT iView = 0u; iView < CameraGrid::nViews; iView++) {
+				if (iView == CameraGrid::iCenterView) continue;
+				for (UINT y = y0; y < y1; y++) {
+					for (UINT x = x0; x < x1; x++) {
+						const int texel = views[iView].data[(static_cast<size_t>(y) * disparity.width + x) * 4u + 1u];
+						cost += std::abs(texel - SampleWarped(views[CameraGrid::iCenterView], q, iView, x, y, 1u));
+					}
+				}
+			}
+			if (cost >= bestCost) continue;
+			best = q;
+			bestCost = cost;
+		}
+		return static_cast<int16_t>(best);
+	}
+	static inline int16_t GetDisparityReference(const int16_t* pQuantized, UINT width, UINT x, UINT y, UINT y0)
+	{
+		if (x > 0u) return pQuantized[static_cast<size_t>(y) * width + x - 1u];
+		return y > y0 ? pQuantized[static_cast<size_t>(y - 1u) * width] : 0;
+	}
+	static inline int16_t GetDisparityDelta(const int16_t* pQuantized, UINT width, UINT x, UINT y, UINT y0)
+	{
+		const uint16_t value = static_cast<uint16_t>(pQuantized[static_cast<size_t>(y) * width + x]);
+		return static_cast<int16_t>(value - static_cast<uint16_t>(GetDisparityReference(pQuantized, width, x, y, y0)));
+	}
+
+	// prediction of texel (x, y) inside the stripe starting at y0, pPlane is one channel of the view with a stride of 4
+	// pWarped holds the center view warped onto the stripe, the gradient predictor also predicts the warp residual spatially
+	static inline BYTE Predict(Predictor predictor, const BYTE* pPlane, const BYTE* pWarped, UINT width, UINT x, UINT y, UINT y0)
+	{
+		switch (predictor)
+		{
+			case Predictor::eSpatial: return PredictMed([&](UINT tx, UINT ty) { return pPlane[(static_cast<size_t>(ty) * width + tx) * 4u]; }, x, y, y0);
+			case Predictor::eCenter: return pWarped[static_cast<size_t>(y - y0) * width + x];
+			case Predictor::eCenterGradient: return static_cast<BYTE>(pWarped[static_cast<size_t>(y - y0) * width + x] + PredictMed([&](UINT tx, UINT ty) {
+				return static_cast<BYTE>(pPlane[(static_cast<size_t>(ty) * width + tx) * 4u] - pWarped[static_cast<size_t>(ty - y0) * width + tx]);
+			}, x, y, y0));
+			default: return 0u;
+		}
+	}
+	// median edge detector of LOCO-I, neighbours above are only used inside the stripe
+	template<typename Texel>
+	static inline BYTE PredictMed(Texel texel, UINT x, UINT y, UINT y0)
+	{
+		if (y == y0) return x > 0u ? texel(x - 1u, y) : 0u;
+		if (x == 0u) return texel(x, y - 1u);
+		const int a = texel(x - 1u, y), b = texel(x, y - 1u), ab = texel(x - 1u, y - 1u);
+		if (ab >= std::max(a, b)) return static_cast<BYTE>(std::min(a, b));
+		if (ab <= std::min(a, b)) return static_cast<BYTE>(std::max(a, b));
+		return static_cast<BYTE>(a + b - ab);
+	}
+	// one channel of the center view sampled where each texel of the stripe sits according to its block's disparity
+	static void WarpStripe(const Image& center, const int16_t* pBlocks, UINT iView, UINT y0, UINT y1, UINT c, BYTE* pWarped)
+	{
+		const UINT nBlocksX = Header::GetBlockCount(center.width);
+		for (UINT y = y0; y < y1; y++) {
+			for (UINT x = 0u; x < center.width; x++) {
+				const int q = pBlocks[static_cast<size_t>(y / blockSize) * nBlocksX + x / blockSize];
+				pWarped[static_cast<size_t>(y - y0) * center.width + x] = static_cast<BYTE>(SampleWarped(center, q, iView, x, y, c));
+			}
+		}
+	}
+	// integer bilinear, so encoder and decoder agree bit for bit
+	static inline int SampleWarped(const Image& center, int q, UINT iView, UINT x, UINT y, UINT c)
+	{
+		const UINT width = center.width, height = center.height;
+		const int gridX = static_cast<int>(iView / CameraGrid::nViewsPerAxis) - CameraGrid::camLoopLim;
+		const int gridY = static_cast<int>(iView % CameraGrid::nViewsPerAxis) - CameraGrid::camLoopLim;
+		const int px = std::clamp(static_cast<int>(x << disparityBits) + gridX * q, 0, static_cast<int>((width - 1u) << disparityBits));
+		const int py = std::clamp(static_cast<int>(y << disparityBits) + gridY * q, 0, static_cast<int>((height - 1u) << disparityBits));
+		const UINT x0 = px >> disparityBits, y0 = py >> disparityBits, x1 = std::min(x0 + 1u, width - 1u), y1 = std::min(y0 + 1u, height - 1u);
+		const int fx = px & disparityMask, fy = py & disparityMask;
+		auto texel = [&](UINT tx, UINT ty) { return static_cast<int>(center.data[(static_cast<size_t>(ty) * width + tx) * 4u + c]); };
+		const int top = texel(x0, y0) * (disparityOne - fx) + texel(x1, y0) * fx;
+		const int bottom = texel(x0, y1) * (disparityOne - fx) + texel(x1, y1) * fx;
+		return (top * (disparityOne - fy) + bottom * fy + disparityOne * disparityOne / 2) >> (2u * disparityBits);
+	}
+	// order zero entropy of the symbols, what the stream will roughly cost
+	static double EstimateBits(const ArenaVector<BYTE>& symbols)
+	{
+		std::array<size_t, 256> counts = {};
+		for (BYTE symbol : symbols) counts[symbol]++;
+		double bits = 0.0;
+		for (size_t count : counts) {
+			if (count > 0u) bits -= count * std::log2(static_cast<double>(count) / symbols.size());
+		}
+		return bits;
+	}
+
+	static inline BYTE ZigZag8(BYTE value) { return static_cast<BYTE>((value << 1u) ^ (static_cast<int8_t>(value) >> 7)); }
+	static inline BYTE UnZigZag8(BYTE value) { return static_cast<BYTE>((value >> 1u) ^ -(value & 1)); }
+	static inline uint16_t ZigZag16(int16_t value) { return static_cast<uint16_t>((static_cast<uint16_t>(value) << 1u) ^ (value >> 15)); }
+	static inline int16_t UnZigZag16(uint16_t value) { return static_cast<int16_t>((value >> 1u) ^ -(value & 1)); }
+
+	// byte wise rANS with a 32-bit state and frequencies scaled to 2^12, one frequency table per stream
+	static void EncodeStream(const ArenaVector<BYTE>& symbols, std::vector<BYTE>& out)
+	{
+		std::array<uint32_t, 256> freqs = {}, starts;
+		for (BYTE symbol : symbols) freqs[symbol]++;
+		NormalizeFrequencies(freqs, symbols.size());
+		for (UINT s = 0u, start = 0u; s < 256u; start += freqs[s++]) starts[s] = start;
+
+		// table with zero runs collapsed, nonzero frequencies as 7-bit varints
+		for (UINT s = 0u; s < 256u; s++) {
+			if (freqs[s] == 0u) {
+				UINT run = 1u;
+				while (s + run < 256u && run < 255u && freqs[s + run] == 0u) run++;
+				out.push_back(0u);
+				out.push_back(static_cast<BYTE>(run));
+				s += run - 1u;
+				continue;
+			}
+			for (uint32_t f = freqs[s]; ; f >>= 7u) {
+				out.push_back(static_cast<BYTE>((f & 0x7Fu) | (f >= 0x80u ? 0x80u : 0u)));
+				if (f < 0x80u) break;
+			}
+		}
+
+		// rANS runs backwards, bytes get reversed once done so the decoder reads forwards
+		ArenaVector<BYTE> reversed;
+		reversed.reserve(symbols.size() / 2u + 8u);
+		uint32_t state = ransLow;
+		for (size_t i = symbols.size(); i-- > 0u;) {
+			const uint32_t freq = freqs[symbols[i]];
+			const uint32_t stateMax = ((ransLow >> scaleBits) << 8u) * freq;
+			while (state >= stateMax) {
+				reversed.push_back(static_cast<BYTE>(state));
+				state >>= 8u;
+			}
+			state = ((state / freq) << scaleBits) + state % freq + starts[symbols[i]];
+		}
+		for (UINT i = 0u; i < 4u; i++) reversed.push_back(static_cast<BYTE>(state >> (8u * i)));
+
+		const UINT size = static_cast<UINT>(reversed.size());
+		out.insert(out.end(), reinterpret_cast<const BYTE*>(&size), reinterpret_cast<const BYTE*>(&size) + sizeof(size));
+		out.insert(out.end(), reversed.rbegin(), reversed.rend());
+	}
+	// reads one stream and advances pStream past it
+	static void DecodeStream(const BYTE*& pStream, const BYTE* pEnd, ArenaVector<BYTE>& symbols)
+	{
+		auto readByte = [&]() {
+			if (pStream >= pEnd) throw std::runtime_error("Lightfield archive stream is truncated");
+			return *pStream++;
+		};
+		std::array<uint32_t, 256> freqs = {}, starts;
+		for (UINT s = 0u; s < 256u; s++) {
+			BYTE byte = readByte();
+			if (byte == 0u) {
+				s += readByte() - 1u;
+				continue;
+			}
+			for (UINT shift = 0u; ; shift += 7u) {
+				freqs[s] |= static_cast<uint32_t>(byte & 0x7Fu) << shift;
+				if (!(byte & 0x80u)) break;
+				byte = readByte();
+			}
+		}
+		std::array<BYTE, 1u << scaleBits> slots;
+		for (UINT s = 0u, start = 0u; s < 256u; start += freqs[s++]) {
+			if (start + freqs[s] > slots.size()) throw std::runtime_error("Lightfield archive stream has a broken frequency table");
+			starts[s] = start;
+			std::fill_n(slots.begin() + start, freqs[s], static_cast<BYTE>(s));
+		}
+
+		UINT size = 0u;
+		for (UINT i = 0u; i < 4u; i++) size |= static_cast<UINT>(readByte()) << (8u * i);
+		if (size < 4u || static_cast<size_t>(pEnd - pStream) < size) throw std::runtime_error("Lightfield archive stream is truncated");
+		const BYTE* pBytes = pStream;
+		const BYTE* pBytesEnd = pStream + size;
+		pStream = pBytesEnd;
+
+		uint32_t state = 0u;
+		for (UINT i = 0u; i < 4u; i++) state = state << 8u | *pBytes++;
+		constexpr uint32_t mask = (1u << scaleBits) - 1u;
+		for (BYTE& symbol : symbols) {
+			symbol = slots[state & mask];
+			state = freqs[symbol] * (state >> scaleBits) + (state & mask) - starts[symbol];
+			while (state < ransLow) {
+				if (pBytes >= pBytesEnd) throw std::runtime_error("Lightfield archive stream is truncated");
+				state = state << 8u | *pBytes++;
+			}
+		}
+	}
+	// every present symbol keeps at least one slot, the most frequent ones absorb the rounding
+	static void NormalizeFrequencies(std::array<uint32_t, 256>& freqs, size_t nSymbols)
+	{
+		if (nSymbols == 0u) {
+			freqs[0] = 1u << scaleBits;
+			return;
+		}
+		int64_t total = 0;
+		for (uint32_t& freq : freqs) {
+			if (freq == 0u) continue;
+			freq = std::max(static_cast<uint32_t>((static_cast<uint64_t>(freq) << scaleBits) / nSymbols), 1u);
+			total += freq;
+		}
+		int64_t diff = (1 << scaleBits) - total;
+		while (diff != 0) {
+			uint32_t& largest = *std::max_element(freqs.begin(), freqs.end());
+			const int64_t change = diff > 0 ? diff : -std::min<int64_t>(-diff, largest - 1u);
+			largest = static_cast<uint32_t>(largest + change);
+			diff -= change;
+			if (change == 0) break;
+		}
+	}
+
+private:
+	static constexpr UINT archiveMagic = 0x3043464Cu; // "LFC0"
+	static constexpr UINT archiveVersion = 1u;
+	static constexpr UINT blockSize = 8u;
+	static constexpr int refineSteps = 2; // disparity steps searched around the block median
+	static constexpr UINT disparityBits = 4u; // sub texel precision of the stored disparity
+	static constexpr int disparityOne = 1 << disparityBits, disparityMask = disparityOne - 1;
+	static constexpr uint32_t scaleBits = 12u;
+	static constexpr uint32_t ransLow = 1u << 23u;
+};
\ No newline at end of file
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <fstream>
+
+// published 4d lightfield benchmarks in the layout of the hci 4d light field benchmark:
+// a directory of N x N sub-aperture views input_Cam000.png.. numbered row by row from the top left, parameters.cfg
+// and optionally the ground truth disparity gt_disp_lowres.pfm of the center view
+// a 3 x 3 subset around the center (or a configured one) is picked and decoded in parallel, so real captures can go through the depth path
+class LightfieldDataset
+{
+public:
+	struct Options
+	{
+		int centerX = -1, centerY = -1; // camera the subset is centered on, the middle one by default
+		UINT step = 1u; // cameras between neighbouring views of the subset, disparities are scaled along
+		UINT cropX = 0u, cropY = 0u, cropWidth = 0u, cropHeight = 0u; // region of every view, zero sizes keep the full views
+	};
+	struct Parameters
+	{
+		UINT nCamsX = 0u, nCamsY = 0u;
+		float baseline = 0.0f; // mm between neighbouring cameras
+		float focalLength = 0.0f; // mm
+		float focusDistance = 0.0f; // m
+		float minDisparity = 0.0f, maxDisparity = 0.0f;
+	};
+	// the usual metrics of the benchmark, over texels where both disparities are finite
+	struct Accuracy
+	{
+		double mse = 0.0; // mean squared error times 100
+		double badPixels = 0.0; // fraction of texels off by more than .07
+		double meanAbsoluteError = 0.0;
+		size_t nTexels = 0u;
+	};
+
+public:
+	LightfieldDataset() = default;
+	~LightfieldDataset() = default;
+	ROF_DELETE(LightfieldDataset);
+
+public:
+	void Load(const std::filesystem::path& directory, const Options& options)
+	{
+		PROFILE_SCOPE("LightfieldDataset::Load");
+		ReadParameters(directory / "parameters.cfg");
+		if (parameters.nCamsX == 0u || parameters.nCamsY == 0u) {
+			// without parameters the views have to form a square
+			UINT nFiles = 0u;
+			while (std::filesystem::exists(directory / GetViewName(nFiles))) nFiles++;
+			parameters.nCamsX = parameters.nCamsY = static_cast<UINT>(std::lround(std::sqrt(nFiles)));
+			if (nFiles == 0u || parameters.nCamsX * parameters.nCamsY != nFiles) throw std::runtime_error("Dataset views do not form a square grid");
+		}
+
+		// grid coordinates of the views match CameraGrid::GetOffset: column major, x to the right, y downwards
+		const int step = static_cast<int>(std::max(options.step, 1u));
+		const int centerX = options.centerX >= 0 ? options.centerX : static_cast<int>(parameters.nCamsX / 2u);
+		const int centerY = options.centerY >= 0 ? options.centerY : static_cast<int>(parameters.nCamsY / 2u);
+		std::array<UINT, CameraGrid::nViews> cams;
+		for (UINT iView = 0u; iView < CameraGrid::nViews; iView++) {
+			const int camX = centerX + (static_cast<int>(iView / CameraGrid::nViewsPerAxis) - static_cast<int>(CameraGrid::camLoopLim)) * step;
+			const int camY = centerY + (static_cast<int>(iView % CameraGrid::nViewsPerAxis) - static_cast<int>(CameraGrid::camLoopLim)) * step;
+			if (camX < 0 || camY < 0 || camX >= static_cast<int>(parameters.nCamsX) || camY >= static_cast<int>(parameters.nCamsY)) throw std::runtime_error("Dataset subset reaches beyond the camera grid");
+			cams[iView] = static_cast<UINT>(camY) * parameters.nCamsX + static_cast<UINT>(camX);
+		}
+
+		std::vector<Image> decoded(CameraGrid::nViews);
+		ParallelFor(0u, CameraGrid::nViews, [&](size_t iView) {
+			decoded[iView] = ImageReader::ReadPNG(directory / GetViewName(cams[iView]));
+		});
+		for (const Image& view : decoded) {
+			if (view.width != decoded.front().width || view.height != decoded.front().height) throw std::runtime_error("Dataset views differ in size");
+		}
+
+		const UINT width = decoded.front().width, height = decoded.front().height;
+		cropX = options.cropX;
+		cropY = options.cropY;
+		cropWidth = options.cropWidth > 0u ? options.cropWidth : width - std::min(cropX, width);
+		cropHeight = options.cropHeight > 0u ? options.cropHeight : height - std::min(cropY, height);
+		if (cropWidth == 0u || cropHeight == 0u || cropX + cropWidth > width || cropY + cropHeight > height) throw std::runtime_error("Dataset crop lies outside the views");
+		views.resize(CameraGrid::nViews);
+		for (UINT i = 0u; i < CameraGrid::nViews; i++) views[i] = Crop(decoded[i]);
+
+		// ground truth is given between neighbouring cameras, the subset sees it multiplied by its step
+		groundTruth.reset();
+		const std::filesystem::path groundTruthPath = directory / "gt_disp_lowres.pfm";
+		if (!std::filesystem::exists(groundTruthPath)) return;
+		const Image fullGroundTruth = ImageReader::ReadPFM(groundTruthPath);
+		if (fullGroundTruth.width != width || fullGroundTruth.height != height) throw std::runtime_error("Dataset ground truth does not match the views");
+		groundTruth = Crop(fullGroundTruth);
+		float* pDisparity = reinterpret_cast<float*>(groundTruth->data.data());
+		for (size_t i = 0u; i < static_cast<size_t>(cropWidth) * cropHeight; i++) pDisparity[i] *= static_cast<float>(step);
+	}
+
+	inline const std::vector<Image>& GetViews() const { return views; }
+	inline const Image* GetGroundTruth() const { return groundTruth ? &groundTruth.value() : nullptr; }
+	inline const Parameters& GetParameters() const { return parameters; }
+	inline UINT GetWidth() const { return cropWidth; }
+	inline UINT GetHeight() const { return cropHeight; }
+
+	// compares output depth against ground truth of the same size, texels within border of the edges are left out like in the benchmark
+	static Accuracy Evaluate(const Image& disparity, const Image& groundTruth, UINT border = 15u)
+	{
+		if (disparity.width != groundTruth.width || disparity.height != groundTruth.height) throw std::runtime_error("Disparity does not match the ground truth");
+		Accuracy accuracy;
+		size_t nBad = 0u;
+		for (UINT y = border; y + border < disparity.height; y++) {
+			for (UINT x = border; x + border < disparity.width; x++) {
+				const double estimate = disparity.GetValue(x, y), truth = groundTruth.GetValue(x, y);
+				if (!std::isfinite(estimate) || !std::isfinite(truth)) continue;
+				const double error = std::abs(estimate - truth);
+				accuracy.mse += error * error;
+				accuracy.meanAbsoluteError += error;
+				nBad += error > .07;
+				accuracy.nTexels++;
+			}
+		}
+		if (accuracy.nTexels == 0u) return accuracy;
+		accuracy.mse *= 100.0 / accuracy.nTexels;
+		accuracy.meanAbsoluteError /= accuracy.nTexels;
+		accuracy.badPixels = static_cast<double>(nBad) / accuracy.nTexels;
+		return accuracy;
+	}
+
+private:
+	static inline std::string GetViewName(UINT iCam)
+	{
+		std::ostringstream oss;
+		oss << "input_Cam" << std::setw(3) << std::setfill('0') << iCam << ".png";
+		return oss.str();
+	}
+
+	// ini style key = value lines, sections and unknown keys are ignored
+	void ReadParameters(const std::filesystem::path& path)
+	{
+		parameters = Parameters();
+		std::ifstream file(path);
+		if (!file) return;
+		const std::unordered_map<std::string, float*> floats = {
+			{ "baseline_mm", &parameters.baseline }, { "focal_length_mm", &parameters.focalLength }, { "focus_distance_m", &parameters.focusDistance },
+			{ "disp_min", &parameters.minDisparity }, { "disp_max", &parameters.maxDisparity }
+		};
+		for (std::string line; std::getline(file, line); ) {
+			const size_t iEquals = line.find('=');
+			if (iEquals == std::string::npos) continue;
+			auto trim = [](std::string text) {
+				text.erase(0u, text.find_first_not_of(" \t\r"));
+				text.erase(text.find_last_not_of(" \t\r") + 1u);
+				return text;
+			};
+			const std::string key = trim(line.substr(0u, iEquals)), value = trim(line.substr(iEquals + 1u));
+			try {
+				if (key == "num_cams_x") parameters.nCamsX = static_cast<UINT>(std::stoul(value));
+				else if (key == "num_cams_y") parameters.nCamsY = static_cast<UINT>(std::stoul(value));
+				else if (auto it = floats.find(key); it != floats.end()) *it->second = std::stof(value);
+			}
+			catch (const std::exception&) {
+				throw std::runtime_error("Dataset parameter " + key + " is not a number");
+			}
+		}
+	}
+	Image Crop(const Image& image) const
+	{
+		const size_t texelSize = Image::GetTexelSize(image.format);
+		Image cropped = { cropWidth, cropHeight, image.format, std::vector<BYTE>(cropWidth * cropHeight * texelSize) };
+		for (size_t y = 0u; y < cropHeight; y++) {
+			memcpy(&cropped.data[y * cropWidth * texelSize], &image.data[((cropY + y) * image.width + cropX) * texelSize], cropWidth * texelSize);
+		}
+		return cropped;
+	}
+
+private:
+	Parameters parameters;
+	std::vector<Image> views;
+	std::optional<Image> groundTruth;
+	UINT cropX = 0u, cropY = 0u, cropWidth = 0u, cropHeight = 0u;
+};
\ No newline at end of file
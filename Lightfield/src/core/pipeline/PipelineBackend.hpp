@@ -0,0 +1,81 @@
+#pragma once
+
+#include "pipeline/CameraGrid.hpp"
+#include "pipeline/FrameGraph.hpp"
+#include "pipeline/FrameTimings.hpp"
+#include "pipeline/CameraPath.hpp"
+#include "pipeline/GeometryExporter.hpp"
+#include "pipeline/LightfieldCodec.hpp"
+#include "pipeline/LightfieldDataset.hpp"
+#include "pipeline/ViewSynthesizer.hpp"
+
+// the lightfield pipeline independent of the api doing the work:
+// simulate all views of the camera grid, deduce depth from their gradients and capture the results
+// backends schedule their stages through a FrameGraph, so intermediates nobody reads are never produced
+class PipelineBackend
+{
+public:
+	enum class CaptureTarget : UINT { eColor, eSimulatedDepth, eOutputDepth };
+	struct CaptureFormats
+	{
+		ImageWriter::FileFormat color = ImageWriter::FileFormat::eJPG;
+		ImageWriter::FileFormat simDepth = ImageWriter::FileFormat::ePNG;
+		ImageWriter::FileFormat outputDepth = ImageWriter::FileFormat::ePFM;
+		bool bArchiveViews = false; // all views go into one lightfield archive instead of an image each
+	};
+
+public:
+	PipelineBackend() = default;
+	virtual ~PipelineBackend() = default;
+	ROF_DELETE(PipelineBackend);
+
+public:
+	// renders every view of the camera grid with its simulated depth, then deduces depth from their gradients
+	virtual void RenderFrame() = 0;
+	virtual UINT GetViewCount() const = 0;
+	// cpu copy of a target of the last frame, the view index is ignored for the output depth
+	// intermediates are only kept for frames a capture was requested for
+	virtual Image Capture(CaptureTarget target, UINT iView = 0u) = 0;
+	inline void RequestCapture() { bCaptureRequested = true; }
+
+	// hands the output depth and every view with its simulated depth to the writer
+	// an archive of the views is encoded right away, its predictions need all views and the output depth at once
+	void WriteCapture(ImageWriter& imageWriter, const std::filesystem::path& directory, const CaptureFormats& formats)
+	{
+		if (formats.bArchiveViews) LightfieldCodec::Write(directory / L"lightfield.lfc", CaptureViews(), Capture(CaptureTarget::eOutputDepth));
+		imageWriter.Enqueue(Capture(CaptureTarget::eOutputDepth),
+			(directory / (std::wstring(L"outputDepth") + ImageWriter::GetExtension(formats.outputDepth))).wstring(), formats.outputDepth);
+		for (UINT i = 0u; i < GetViewCount(); i++) {
+			const std::wstring index = std::to_wstring(i);
+			imageWriter.Enqueue(Capture(CaptureTarget::eSimulatedDepth, i),
+				(directory / (L"simulated_depth_" + index + ImageWriter::GetExtension(formats.simDepth))).wstring(), formats.simDepth);
+			if (formats.bArchiveViews) continue;
+			imageWriter.Enqueue(Capture(CaptureTarget::eColor, i),
+				(directory / (L"simulated_color" + index + ImageWriter::GetExtension(formats.color))).wstring(), formats.color);
+		}
+	}
+	std::vector<Image> CaptureViews()
+	{
+		std::vector<Image> views;
+		for (UINT i = 0u; i < GetViewCount(); i++) views.push_back(Capture(CaptureTarget::eColor, i));
+		return views;
+	}
+
+	// point cloud or mesh of the output depth, colored by the center view
+	GeometryExporter::Stats ExportGeometry(const std::filesystem::path& path, const GeometryExporter::Options& options = {})
+	{
+		const Image color = Capture(CaptureTarget::eColor, CameraGrid::iCenterView);
+		return GeometryExporter::Export(Capture(CaptureTarget::eOutputDepth), &color, path, options);
+	}
+
+	// virtual view at (u, v) on the camera grid, warped from the last frame's views and output depth
+	Image SynthesizeView(ViewSynthesizer& synthesizer, float u, float v)
+	{
+		Image output;
+		synthesizer.Synthesize(CaptureViews(), Capture(CaptureTarget::eOutputDepth), u, v, output);
+		return output;
+	}
+
+protected:
+	bool bCaptureRequested = false;
+};
\ No newline at end of file
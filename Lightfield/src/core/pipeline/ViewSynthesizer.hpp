@@ -0,0 +1,183 @@
+#pragma once
+
+#include <atomic>
+
+// renders virtual views anywhere on the plane of the camera grid from the views of one frame and its output depth
+// the center view is forward warped with z-buffered splatting, disocclusions are filled from the neighbouring views
+// far cheaper than simulating another view, so previews and denser virtual grids can be built from a single frame
+class ViewSynthesizer
+{
+public:
+	struct Params
+	{
+		UINT maxHoleSearch = 64u; // texels searched along the warp direction for the background next to a hole
+	};
+
+public:
+	ViewSynthesizer() = default;
+	~ViewSynthesizer() = default;
+	ROF_DELETE(ViewSynthesizer);
+
+public:
+	// views are the bgra8 views of the camera grid, disparity the single channel float output depth
+	// (u, v) is the virtual camera in units of the grid offset, the real views sit on the integer positions of GetOffset
+	// output receives the bgra8 view, pDisparity the warped depth with holes left as nan
+	void Synthesize(const std::vector<Image>& views, const Image& disparity, float u, float v, Image& output, Image* pDisparity = nullptr)
+	{
+		PROFILE_SCOPE("ViewSynthesizer::Synthesize");
+		width = disparity.width;
+		height = disparity.height;
+		if (views.size() != CameraGrid::nViews) throw std::runtime_error("View synthesis needs every view of the camera grid");
+		if (disparity.format != Image::Format::eR32Float) throw std::runtime_error("View synthesis needs single channel float depth");
+		for (const Image& view : views) {
+			if (view.width != width || view.height != height || view.format != Image::Format::eBGRA8) throw std::runtime_error("Views do not match the depth layout");
+		}
+		Resize(static_cast<size_t>(width) * height);
+		output = { width, height, Image::Format::eBGRA8, std::vector<BYTE>(static_cast<size_t>(width) * height * 4u, 0u) };
+
+		const float* pSource = reinterpret_cast<const float*>(disparity.data.data());
+		const Image& center = views[CameraGrid::iCenterView];
+		const float shiftX = -u, shiftY = v; // texel shift per unit of disparity, scene content moves against the camera
+
+		// splat every center texel onto the texels its warped position overlaps, the closest surface wins
+		ParallelFor(0u, height, [&](size_t y) {
+			for (size_t i = y * width; i < (y + 1u) * width; i++) zBuffer[i].store(0u, std::memory_order_relaxed);
+		});
+		ParallelFor(0u, height, [&](size_t y) {
+			for (UINT x = 0u; x < width; x++) {
+				const size_t iSource = y * width + x;
+				if (!std::isfinite(pSource[iSource])) continue;
+				const float d = std::max(pSource[iSource], 0.0f); // slightly beyond infinity is noise of the deduction
+				const float tx = static_cast<float>(x) + shiftX * d, ty = static_cast<float>(y) + shiftY * d;
+				const float x0 = std::floor(tx), y0 = std::floor(ty);
+				for (float py = y0; py <= std::ceil(ty); py++) {
+					for (float px = x0; px <= std::ceil(tx); px++) {
+						if (px < 0.0f || py < 0.0f || px >= width || py >= height) continue;
+						const float dist2 = (px - tx) * (px - tx) + (py - ty) * (py - ty);
+						Splat(zBuffer[static_cast<size_t>(py) * width + static_cast<size_t>(px)], d, dist2, iSource);
+					}
+				}
+			}
+		});
+
+		// resolve the winners, the z-buffer keeps marking which texels were covered by the warp
+		ParallelFor(0u, height, [&](size_t y) {
+			for (size_t i = y * width; i < (y + 1u) * width; i++) {
+				const uint64_t key = zBuffer[i].load(std::memory_order_relaxed);
+				if (key == 0u) {
+					warpedDisparity[i] = std::numeric_limits<float>::quiet_NaN();
+					continue;
+				}
+				const size_t iSource = static_cast<size_t>(key & 0xFFFFFFFFu) - 1u;
+				warpedDisparity[i] = std::max(pSource[iSource], 0.0f);
+				memcpy(&output.data[i * 4u], &center.data[iSource * 4u], 4u);
+			}
+		});
+
+		// views closest to the virtual camera see the disocclusions most alike
+		std::array<UINT, CameraGrid::nViews - 1u> fillViews;
+		std::array<float, CameraGrid::nViews> gridX, gridY;
+		for (UINT i = 0u, n = 0u; i < CameraGrid::nViews; i++) {
+			CameraGrid::GetOffset(i, gridX[i], gridY[i]);
+			gridX[i] /= CameraGrid::offset;
+			gridY[i] /= CameraGrid::offset;
+			if (i != CameraGrid::iCenterView) fillViews[n++] = i;
+		}
+		std::sort(fillViews.begin(), fillViews.end(), [&](UINT a, UINT b) {
+			return std::hypot(gridX[a] - u, gridY[a] - v) < std::hypot(gridX[b] - u, gridY[b] - v);
+		});
+
+		// holes open up along the warp direction, the side that moved less is the background they reveal
+		const float shiftLength = std::hypot(shiftX, shiftY);
+		const float dirX = shiftLength > 0.0f ? shiftX / shiftLength : 1.0f, dirY = shiftLength > 0.0f ? shiftY / shiftLength : 0.0f;
+		ParallelFor(0u, height, [&](size_t y) {
+			for (UINT x = 0u; x < width; x++) {
+				const size_t i = y * width + x;
+				if (zBuffer[i].load(std::memory_order_relaxed) != 0u) continue;
+				size_t iBackground = 0u;
+				if (!FindBackground(x, static_cast<UINT>(y), dirX, dirY, iBackground)) continue;
+
+				// reproject the background into the other views, falling back to stretching the background texel
+				const float d = warpedDisparity[iBackground];
+				BYTE* pOut = &output.data[i * 4u];
+				memcpy(pOut, &output.data[iBackground * 4u], 4u);
+				for (UINT iView : fillViews) {
+					const float sx = static_cast<float>(x) - (gridX[iView] - u) * d, sy = static_cast<float>(y) + (gridY[iView] - v) * d;
+					if (SampleBilinear(views[iView], sx, sy, pOut)) break;
+				}
+				warpedDisparity[i] = d;
+			}
+		});
+
+		if (!pDisparity) return;
+		*pDisparity = { width, height, Image::Format::eR32Float, std::vector<BYTE>(warpedDisparity.size() * sizeof(float)) };
+		memcpy(pDisparity->data.data(), warpedDisparity.data(), pDisparity->data.size());
+	}
+	inline Params& GetParams() { return params; }
+
+private:
+	void Resize(size_t nPixels)
+	{
+		if (nPixels == nBufferPixels) return;
+		nBufferPixels = nPixels;
+		zBuffer = std::make_unique<std::atomic<uint64_t>[]>(nPixels);
+		warpedDisparity.assign(nPixels, 0.0f);
+		bufferMemory.Track(MemoryTag::eRenderTargets, nPixels * (sizeof(uint64_t) + sizeof(float)));
+	}
+
+	// keys order by disparity first, then by how close the texel is to the splat center, the source index breaks ties
+	// the low mantissa bits of the disparity make room for the closeness, so near equal surfaces are picked by position
+	static inline void Splat(std::atomic<uint64_t>& slot, float d, float dist2, size_t iSource)
+	{
+		uint32_t bits;
+		memcpy(&bits, &d, sizeof(bits)); // non-negative floats order like their bits
+		const uint32_t closeness = closenessMask - static_cast<uint32_t>(dist2 * .5f * closenessMask);
+		const uint64_t key = static_cast<uint64_t>((bits & ~closenessMask) | closeness) << 32u | static_cast<uint64_t>(iSource + 1u);
+		uint64_t current = slot.load(std::memory_order_relaxed);
+		while (current < key && !slot.compare_exchange_weak(current, key, std::memory_order_relaxed));
+	}
+
+	// nearest warped texels on both sides of a hole along the given direction, the farther of the two is the background
+	bool FindBackground(UINT x, UINT y, float dirX, float dirY, size_t& iBackground) const
+	{
+		bool bFound = false;
+		for (float side : { 1.0f, -1.0f }) {
+			for (UINT step = 1u; step <= params.maxHoleSearch; step++) {
+				const float px = std::round(x + side * dirX * step), py = std::round(y + side * dirY * step);
+				if (px < 0.0f || py < 0.0f || px >= width || py >= height) break;
+				const size_t i = static_cast<size_t>(py) * width + static_cast<size_t>(px);
+				if (zBuffer[i].load(std::memory_order_relaxed) == 0u) continue;
+				if (!bFound || warpedDisparity[i] < warpedDisparity[iBackground]) iBackground = i;
+				bFound = true;
+				break;
+			}
+		}
+		return bFound;
+	}
+
+	// bilinear bgra8 lookup at texel coordinates, fails outside the view
+	bool SampleBilinear(const Image& view, float x, float y, BYTE* pOut) const
+	{
+		if (width < 2u || height < 2u || x < 0.0f || y < 0.0f || x > width - 1u || y > height - 1u) return false;
+		const UINT x0 = std::min(static_cast<UINT>(x), width - 2u), y0 = std::min(static_cast<UINT>(y), height - 2u);
+		const float fx = x - x0, fy = y - y0;
+		const BYTE* pRow0 = &view.data[(static_cast<size_t>(y0) * width + x0) * 4u];
+		const BYTE* pRow1 = pRow0 + static_cast<size_t>(width) * 4u;
+		for (UINT c = 0u; c < 4u; c++) {
+			const float top = pRow0[c] + (pRow0[c + 4u] - pRow0[c]) * fx;
+			const float bottom = pRow1[c] + (pRow1[c + 4u] - pRow1[c]) * fx;
+			pOut[c] = static_cast<BYTE>(top + (bottom - top) * fy + .5f);
+		}
+		return true;
+	}
+
+private:
+	static constexpr uint32_t closenessMask = 0xFFFu;
+
+	Params params;
+	UINT width = 0u, height = 0u;
+	size_t nBufferPixels = 0u;
+	std::unique_ptr<std::atomic<uint64_t>[]> zBuffer;
+	std::vector<float> warpedDisparity;
+	TrackedMemory bufferMemory;
+};
\ No newline at end of file
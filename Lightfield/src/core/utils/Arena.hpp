@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+
+// linear allocator for transient memory, allocations are bumped off large blocks and only ever released all at once
+// every thread owns one, so scratch buffers of frames, tasks and loaders never touch the global heap or contend for it
+class Arena
+{
+public:
+	struct Marker
+	{
+		size_t iBlock, offset;
+	};
+
+public:
+	Arena(size_t blockSize = 1u << 20u) : blockSize(blockSize) {}
+	~Arena()
+	{
+		for (const Block& block : blocks) MemoryTracker::Get().Free(MemoryTag::eTransient, block.size);
+	}
+	ROF_DELETE(Arena);
+
+public:
+	static inline Arena& GetThreadArena()
+	{
+		static thread_local Arena arena;
+		return arena;
+	}
+
+	void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+	{
+		// current block first, then blocks left over from earlier scopes, a new block only once none of them fits
+		for (; iBlock < blocks.size(); iBlock++, offset = 0u) {
+			const size_t aligned = Align(iBlock, offset, alignment);
+			if (aligned + size > blocks[iBlock].size) continue;
+			offset = aligned + size;
+			return blocks[iBlock].pData.get() + aligned;
+		}
+		const size_t newSize = std::max(blockSize, size + alignment);
+		blocks.push_back({ std::make_unique<BYTE[]>(newSize), newSize });
+		MemoryTracker::Get().Allocate(MemoryTag::eTransient, newSize);
+		iBlock = blocks.size() - 1u;
+		const size_t aligned = Align(iBlock, 0u, alignment);
+		offset = aligned + size;
+		return blocks[iBlock].pData.get() + aligned;
+	}
+	template<typename T>
+	inline T* Allocate(size_t count) { return static_cast<T*>(Allocate(count * sizeof(T), alignof(T))); }
+
+	inline Marker GetMarker() const { return { iBlock, offset }; }
+	// everything allocated after the marker is gone, blocks stay around for the next allocations
+	void Rewind(const Marker& marker)
+	{
+		iBlock = marker.iBlock;
+		offset = marker.offset;
+		if (iBlock != 0u || offset != 0u || blocks.size() < 2u) return;
+
+		// fully rewound, merge all blocks into one so the next frame or job fits without chaining
+		size_t size = 0u;
+		for (const Block& block : blocks) size += block.size;
+		Release();
+		blocks.push_back({ std::make_unique<BYTE[]>(size), size });
+		MemoryTracker::Get().Allocate(MemoryTag::eTransient, size);
+	}
+	inline void Reset() { Rewind({ 0u, 0u }); }
+	void Release()
+	{
+		for (const Block& block : blocks) MemoryTracker::Get().Free(MemoryTag::eTransient, block.size);
+		blocks.clear();
+		iBlock = offset = 0u;
+	}
+
+private:
+	struct Block
+	{
+		std::unique_ptr<BYTE[]> pData;
+		size_t size;
+	};
+
+	inline size_t Align(size_t i, size_t position, size_t alignment) const
+	{
+		const uintptr_t address = reinterpret_cast<uintptr_t>(blocks[i].pData.get()) + position;
+		return position + ((alignment - address % alignment) % alignment);
+	}
+
+private:
+	const size_t blockSize;
+	std::vector<Block> blocks;
+	size_t iBlock = 0u, offset = 0u;
+};
+
+// rewinds the arena to where it stood on construction, scopes nest like the stack
+// whatever was allocated within must not outlive the scope
+class ScopedArena
+{
+public:
+	ScopedArena(Arena& arena = Arena::GetThreadArena()) : arena(arena), marker(arena.GetMarker()) {}
+	~ScopedArena() { arena.Rewind(marker); }
+	ROF_DELETE(ScopedArena);
+
+public:
+	inline Arena& Get() { return arena; }
+
+private:
+	Arena& arena;
+	const Arena::Marker marker;
+};
+
+// lets standard containers live in an arena, defaults to the arena of the constructing thread
+// freeing is a no-op, so containers should be sized up front and stay on the thread that created them
+template<typename T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+
+public:
+	ArenaAllocator() : pArena(&Arena::GetThreadArena()) {}
+	ArenaAllocator(Arena& arena) : pArena(&arena) {}
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : pArena(other.pArena) {}
+
+public:
+	inline T* allocate(size_t count) { return pArena->Allocate<T>(count); }
+	inline void deallocate(T*, size_t) {}
+	template<typename U>
+	inline bool operator==(const ArenaAllocator<U>& other) const { return pArena == other.pArena; }
+	template<typename U>
+	inline bool operator!=(const ArenaAllocator<U>& other) const { return pArena != other.pArena; }
+
+private:
+	template<typename U> friend class ArenaAllocator;
+	Arena* pArena;
+};
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
\ No newline at end of file
@@ -0,0 +1,355 @@
+#pragma once
+
+#include <fstream>
+
+// decodes the image files datasets ship with, without wic so it also runs headless
+// png: 8 and 16 bit grey, grey alpha, rgb, rgba and 8 bit palette, not interlaced, 16 bit samples keep their high byte
+// pfm: grey or color, only the first channel is kept
+// checksums of chunks and streams are not verified
+class ImageReader
+{
+public:
+	// always bgra8, opaque unless the file carries alpha
+	static Image ReadPNG(const std::filesystem::path& path)
+	{
+		PROFILE_SCOPE("ImageReader::ReadPNG");
+		const std::vector<BYTE> file = ReadFile(path);
+		static constexpr BYTE signature[8] = { 0x89u, 'P', 'N', 'G', '\r', '\n', 0x1Au, '\n' };
+		if (file.size() < sizeof(signature) || memcmp(file.data(), signature, sizeof(signature)) != 0) throw std::runtime_error("Not a png file");
+
+		// chunks: length, type, data, crc
+		UINT width = 0u, height = 0u;
+		BYTE bitDepth = 0u, colorType = 0u;
+		std::vector<BYTE> compressed, palette, paletteAlpha;
+		for (size_t pos = sizeof(signature); ; ) {
+			if (pos + 12u > file.size()) throw std::runtime_error("Png file is truncated");
+			const UINT length = ReadBigEndian(&file[pos]);
+			const char* type = reinterpret_cast<const char*>(&file[pos + 4u]);
+			const BYTE* pData = &file[pos + 8u];
+			if (length > file.size() - pos - 12u) throw std::runtime_error("Png file is truncated");
+			pos += 12u + length;
+
+			if (memcmp(type, "IHDR", 4u) == 0) {
+				if (length < 13u) throw std::runtime_error("Png header is truncated");
+				width = ReadBigEndian(pData);
+				height = ReadBigEndian(pData + 4u);
+				bitDepth = pData[8];
+				colorType = pData[9];
+				if (pData[10] != 0u || pData[11] != 0u) throw std::runtime_error("Unknown png compression or filter method");
+				if (pData[12] != 0u) throw std::runtime_error("Interlaced pngs are not supported");
+			}
+			else if (memcmp(type, "PLTE", 4u) == 0) palette.assign(pData, pData + length);
+			else if (memcmp(type, "tRNS", 4u) == 0) paletteAlpha.assign(pData, pData + length);
+			else if (memcmp(type, "IDAT", 4u) == 0) compressed.insert(compressed.end(), pData, pData + length);
+			else if (memcmp(type, "IEND", 4u) == 0) break;
+		}
+
+		UINT nChannels = 0u;
+		switch (colorType)
+		{
+			case 0u: nChannels = 1u; break; // grey
+			case 2u: nChannels = 3u; break; // rgb
+			case 3u: nChannels = 1u; break; // palette
+			case 4u: nChannels = 2u; break; // grey alpha
+			case 6u: nChannels = 4u; break; // rgba
+			default: throw std::runtime_error("Unknown png color type");
+		}
+		if (!(bitDepth == 8u || (bitDepth == 16u && colorType != 3u))) throw std::runtime_error("Only 8 and 16 bit pngs are supported");
+		if (width == 0u || height == 0u) throw std::runtime_error("Png has no pixels");
+
+		// every row starts with its filter type
+		const size_t texelSize = static_cast<size_t>(nChannels) * bitDepth / 8u;
+		const size_t rowSize = texelSize * width;
+		std::vector<BYTE> filtered(height * (rowSize + 1u));
+		Inflate(compressed, filtered);
+		Unfilter(filtered, height, rowSize, texelSize);
+
+		Image image = { width, height, Image::Format::eBGRA8, std::vector<BYTE>(static_cast<size_t>(width) * height * 4u) };
+		const size_t sampleSize = bitDepth / 8u; // high byte first, so the first byte of every sample is enough
+		for (size_t y = 0u; y < height; y++) {
+			const BYTE* pRow = &filtered[y * (rowSize + 1u) + 1u];
+			BYTE* pOut = &image.data[y * width * 4u];
+			for (size_t x = 0u; x < width; x++, pOut += 4u) {
+				const BYTE* pTexel = pRow + x * texelSize;
+				auto sample = [&](size_t c) { return pTexel[c * sampleSize]; };
+				BYTE r, g, b, a = 255u;
+				switch (colorType)
+				{
+					case 0u: r = g = b = sample(0u); break;
+					case 2u: r = sample(0u); g = sample(1u); b = sample(2u); break;
+					case 3u: {
+						const size_t i = pTexel[0];
+						if (i * 3u + 2u >= palette.size()) throw std::runtime_error("Png palette index out of range");
+						r = palette[i * 3u]; g = palette[i * 3u + 1u]; b = palette[i * 3u + 2u];
+						if (i < paletteAlpha.size()) a = paletteAlpha[i];
+						break;
+					}
+					case 4u: r = g = b = sample(0u); a = sample(1u); break;
+					default: r = sample(0u); g = sample(1u); b = sample(2u); a = sample(3u); break;
+				}
+				pOut[0] = b;
+				pOut[1] = g;
+				pOut[2] = r;
+				pOut[3] = a;
+			}
+		}
+		return image;
+	}
+
+	// single channel float, rows top to bottom like every other image
+	static Image ReadPFM(const std::filesystem::path& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file) throw std::runtime_error("Could not open pfm image file");
+		std::string type;
+		UINT width = 0u, height = 0u;
+		float scale = 0.0f;
+		file >> type >> width >> height >> scale;
+		file.get(); // single whitespace before the texels
+		if (!file || (type != "Pf" && type != "PF") || scale == 0.0f) throw std::runtime_error("Not a pfm file");
+		const size_t nChannels = type == "PF" ? 3u : 1u;
+
+		std::vector<float> texels(static_cast<size_t>(width) * height * nChannels);
+		file.read(reinterpret_cast<char*>(texels.data()), texels.size() * sizeof(float));
+		if (!file) throw std::runtime_error("Pfm file is truncated");
+		if (scale > 0.0f) {
+			// big endian
+			for (float& texel : texels) {
+				BYTE* pBytes = reinterpret_cast<BYTE*>(&texel);
+				std::swap(pBytes[0], pBytes[3]);
+				std::swap(pBytes[1], pBytes[2]);
+			}
+		}
+
+		Image image = { width, height, Image::Format::eR32Float, std::vector<BYTE>(static_cast<size_t>(width) * height * sizeof(float)) };
+		float* pOut = reinterpret_cast<float*>(image.data.data());
+		for (size_t y = 0u; y < height; y++) {
+			const float* pRow = &texels[(height - 1u - y) * width * nChannels];
+			for (size_t x = 0u; x < width; x++) pOut[y * width + x] = pRow[x * nChannels];
+		}
+		return image;
+	}
+
+private:
+	static std::vector<BYTE> ReadFile(const std::filesystem::path& path)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file) throw std::runtime_error("Could not open image file " + path.string());
+		std::vector<BYTE> data(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(data.data()), data.size());
+		if (!file) throw std::runtime_error("Reading image file failed");
+		return data;
+	}
+	static inline UINT ReadBigEndian(const BYTE* pData)
+	{
+		return static_cast<UINT>(pData[0]) << 24u | static_cast<UINT>(pData[1]) << 16u | static_cast<UINT>(pData[2]) << 8u | pData[3];
+	}
+
+	// reverses the per row prediction, bytes refer to the same byte of the texel to the left, above or both
+	static void Unfilter(std::vector<BYTE>& rows, size_t height, size_t rowSize, size_t texelSize)
+	{
+		for (size_t y = 0u; y < height; y++) {
+			BYTE* pRow = &rows[y * (rowSize + 1u)];
+			const BYTE filter = *pRow++;
+			const BYTE* pUp = y > 0u ? pRow - (rowSize + 1u) : nullptr;
+			for (size_t i = 0u; i < rowSize; i++) {
+				const int left = i >= texelSize ? pRow[i - texelSize] : 0;
+				const int up = pUp ? pUp[i] : 0;
+				const int upLeft = pUp && i >= texelSize ? pUp[i - texelSize] : 0;
+				switch (filter)
+				{
+					case 0u: break;
+					case 1u: pRow[i] = static_cast<BYTE>(pRow[i] + left); break;
+					case 2u: pRow[i] = static_cast<BYTE>(pRow[i] + up); break;
+					case 3u: pRow[i] = static_cast<BYTE>(pRow[i] + ((left + up) >> 1)); break;
+					case 4u: {
+						// paeth, whichever neighbour is closest to left + up - upLeft
+						const int p = left + up - upLeft;
+						const int pa = std::abs(p - left), pb = std::abs(p - up), pc = std::abs(p - upLeft);
+						pRow[i] = static_cast<BYTE>(pRow[i] + (pa <= pb && pa <= pc ? left : pb <= pc ? up : upLeft));
+						break;
+					}
+					default: throw std::runtime_error("Unknown png filter type");
+				}
+			}
+		}
+	}
+
+	// zlib stream (rfc 1950) around deflate (rfc 1951), the output has to be sized to the exact decoded size
+	static void Inflate(const std::vector<BYTE>& input, std::vector<BYTE>& output)
+	{
+		if (input.size() < 6u || (input[0] & 0x0Fu) != 8u || (input[0] << 8u | input[1]) % 31u != 0u || (input[1] & 0x20u)) throw std::runtime_error("Png data is not a plain zlib stream");
+		BitReader reader = { input.data() + 2u, input.data() + input.size() };
+		size_t nOut = 0u;
+		auto put = [&](BYTE byte) {
+			if (nOut >= output.size()) throw std::runtime_error("Png data is larger than its image");
+			output[nOut++] = byte;
+		};
+
+		Huffman literals, distances;
+		bool bFinal = false;
+		while (!bFinal) {
+			bFinal = reader.Read(1u) != 0u;
+			const UINT type = reader.Read(2u);
+			if (type == 0u) {
+				// stored, byte aligned with length and its complement
+				reader.AlignToByte();
+				const UINT length = reader.Read(16u), complement = reader.Read(16u);
+				if ((length ^ 0xFFFFu) != complement) throw std::runtime_error("Png data has a broken stored block");
+				for (UINT i = 0u; i < length; i++) put(static_cast<BYTE>(reader.Read(8u)));
+				continue;
+			}
+			if (type == 1u) BuildFixed(literals, distances);
+			else if (type == 2u) ReadDynamic(reader, literals, distances);
+			else throw std::runtime_error("Png data has an invalid block type");
+
+			while (true) {
+				const UINT symbol = literals.Decode(reader);
+				if (symbol < 256u) {
+					put(static_cast<BYTE>(symbol));
+					continue;
+				}
+				if (symbol == 256u) break;
+				if (symbol > 285u) throw std::runtime_error("Png data has an invalid length code");
+				const UINT iLength = symbol - 257u;
+				const UINT length = lengthBase[iLength] + reader.Read(lengthExtra[iLength]);
+				const UINT iDistance = distances.Decode(reader);
+				if (iDistance > 29u) throw std::runtime_error("Png data has an invalid distance code");
+				const size_t distance = distanceBase[iDistance] + reader.Read(distanceExtra[iDistance]);
+				if (distance > nOut) throw std::runtime_error("Png data refers to bytes before its start");
+				if (length > output.size() - nOut) throw std::runtime_error("Png data is larger than its image");
+				// copies may overlap themselves, so byte by byte
+				for (UINT i = 0u; i < length; i++, nOut++) output[nOut] = output[nOut - distance];
+			}
+		}
+		if (nOut != output.size()) throw std::runtime_error("Png data is smaller than its image");
+	}
+
+	struct BitReader
+	{
+		const BYTE* pData;
+		const BYTE* pEnd;
+		uint64_t buffer = 0u;
+		UINT nBits = 0u;
+
+		// past the end reads zeros, the block structure catches truncated streams
+		inline void Refill()
+		{
+			while (nBits <= 56u) {
+				buffer |= static_cast<uint64_t>(pData < pEnd ? *pData++ : 0u) << nBits;
+				nBits += 8u;
+			}
+		}
+		inline UINT Peek(UINT count)
+		{
+			if (nBits < count) Refill();
+			return static_cast<UINT>(buffer & ((1ull << count) - 1u));
+		}
+		inline void Consume(UINT count)
+		{
+			buffer >>= count;
+			nBits -= count;
+		}
+		inline UINT Read(UINT count)
+		{
+			if (count == 0u) return 0u;
+			const UINT value = Peek(count);
+			Consume(count);
+			return value;
+		}
+		inline void AlignToByte() { Consume(nBits % 8u); }
+	};
+
+	// canonical huffman code, decoded with one table lookup over the longest code length
+	struct Huffman
+	{
+		std::vector<uint16_t> table; // symbol << 4 | code length
+		UINT maxLength = 0u;
+
+		void Build(const BYTE* pLengths, UINT nSymbols)
+		{
+			std::array<UINT, 16> counts = {}, nextCode = {};
+			for (UINT i = 0u; i < nSymbols; i++) counts[pLengths[i]]++;
+			counts[0] = 0u;
+			maxLength = 0u;
+			for (UINT length = 1u, code = 0u; length < 16u; length++) {
+				code = (code + counts[length - 1u]) << 1u;
+				nextCode[length] = code;
+				if (counts[length] > 0u) maxLength = length;
+			}
+			if (maxLength == 0u) maxLength = 1u; // empty distance code of a block without matches
+			table.assign(static_cast<size_t>(1u) << maxLength, 0u);
+			for (UINT symbol = 0u; symbol < nSymbols; symbol++) {
+				const UINT length = pLengths[symbol];
+				if (length == 0u) continue;
+				const UINT code = nextCode[length]++;
+				if (code >= (1u << length)) throw std::runtime_error("Png data has an oversubscribed huffman code");
+				// codes are stored msb first but read lsb first, every suffix of the reversed code maps to the symbol
+				UINT reversed = 0u;
+				for (UINT i = 0u; i < length; i++) reversed |= ((code >> i) & 1u) << (length - 1u - i);
+				for (UINT i = reversed; i < table.size(); i += 1u << length) table[i] = static_cast<uint16_t>(symbol << 4u | length);
+			}
+		}
+		inline UINT Decode(BitReader& reader) const
+		{
+			const uint16_t entry = table[reader.Peek(maxLength)];
+			if (entry == 0u) throw std::runtime_error("Png data has an invalid huffman code");
+			reader.Consume(entry & 0xFu);
+			return entry >> 4u;
+		}
+	};
+
+	static void BuildFixed(Huffman& literals, Huffman& distances)
+	{
+		std::array<BYTE, 288> literalLengths;
+		std::fill(literalLengths.begin(), literalLengths.begin() + 144, 8u);
+		std::fill(literalLengths.begin() + 144, literalLengths.begin() + 256, 9u);
+		std::fill(literalLengths.begin() + 256, literalLengths.begin() + 280, 7u);
+		std::fill(literalLengths.begin() + 280, literalLengths.end(), 8u);
+		literals.Build(literalLengths.data(), 288u);
+		std::array<BYTE, 30> distanceLengths;
+		distanceLengths.fill(5u);
+		distances.Build(distanceLengths.data(), 30u);
+	}
+	static void ReadDynamic(BitReader& reader, Huffman& literals, Huffman& distances)
+	{
+		const UINT nLiterals = reader.Read(5u) + 257u, nDistances = reader.Read(5u) + 1u, nCodeLengths = reader.Read(4u) + 4u;
+		static constexpr BYTE codeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+		std::array<BYTE, 19> codeLengths = {};
+		for (UINT i = 0u; i < nCodeLengths; i++) codeLengths[codeLengthOrder[i]] = static_cast<BYTE>(reader.Read(3u));
+		Huffman codeLengthCode;
+		codeLengthCode.Build(codeLengths.data(), 19u);
+
+		// literal and distance lengths form one sequence, repeats may cross from one into the other
+		std::array<BYTE, 286 + 30> lengths = {};
+		for (UINT i = 0u; i < nLiterals + nDistances; ) {
+			const UINT symbol = codeLengthCode.Decode(reader);
+			UINT repeat = 1u;
+			BYTE value = static_cast<BYTE>(symbol);
+			if (symbol == 16u) {
+				if (i == 0u) throw std::runtime_error("Png data repeats a missing code length");
+				value = lengths[i - 1u];
+				repeat = 3u + reader.Read(2u);
+			}
+			else if (symbol == 17u) {
+				value = 0u;
+				repeat = 3u + reader.Read(3u);
+			}
+			else if (symbol == 18u) {
+				value = 0u;
+				repeat = 11u + reader.Read(7u);
+			}
+			if (i + repeat > nLiterals + nDistances) throw std::runtime_error("Png data has too many code lengths");
+			for (UINT n = 0u; n < repeat; n++) lengths[i++] = value;
+		}
+		literals.Build(lengths.data(), nLiterals);
+		distances.Build(lengths.data() + nLiterals, nDistances);
+	}
+
+private:
+	static constexpr uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	static constexpr BYTE lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	static constexpr uint16_t distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	static constexpr BYTE distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+};
\ No newline at end of file
@@ -0,0 +1,322 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+
+// cpu-side copy of a single texture subresource, rows are tightly packed
+struct Image
+{
+	enum class Format : UINT { eBGRA8, eR16Unorm, eR16Float, eR32Float, eR32G32B32A32Float };
+
+	UINT width = 0u, height = 0u;
+	Format format = Format::eBGRA8;
+	std::vector<BYTE> data;
+
+	static inline constexpr UINT GetTexelSize(Format format)
+	{
+		switch (format)
+		{
+			case Format::eBGRA8: return 4u;
+			case Format::eR16Unorm: return 2u;
+			case Format::eR16Float: return 2u;
+			case Format::eR32Float: return 4u;
+			case Format::eR32G32B32A32Float: return 16u;
+		}
+		return 0u;
+	}
+	inline UINT GetRowPitch() const { return width * GetTexelSize(format); }
+
+	// single channel value of a texel, color formats return their first channel
+	float GetValue(size_t x, size_t y) const
+	{
+		const BYTE* pTexel = &data[(y * width + x) * GetTexelSize(format)];
+		switch (format)
+		{
+			case Format::eBGRA8: return pTexel[0] / 255.0f;
+			case Format::eR16Unorm: return *reinterpret_cast<const uint16_t*>(pTexel) / 65535.0f;
+			case Format::eR16Float: return HalfToFloat(*reinterpret_cast<const uint16_t*>(pTexel));
+			case Format::eR32Float:
+			case Format::eR32G32B32A32Float: return *reinterpret_cast<const float*>(pTexel);
+		}
+		return 0.0f;
+	}
+	static float HalfToFloat(uint16_t half)
+	{
+		const uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16u;
+		uint32_t exponent = (half >> 10u) & 0x1Fu;
+		uint32_t mantissa = half & 0x3FFu;
+
+		uint32_t bits;
+		if (exponent == 0u) {
+			if (mantissa == 0u) bits = sign; // zero
+			else {
+				// denormal, renormalize
+				exponent = 127u - 15u + 1u;
+				while ((mantissa & 0x400u) == 0u) {
+					mantissa <<= 1u;
+					exponent--;
+				}
+				bits = sign | (exponent << 23u) | ((mantissa & 0x3FFu) << 13u);
+			}
+		}
+		else if (exponent == 0x1Fu) bits = sign | 0x7F800000u | (mantissa << 13u); // inf/nan
+		else bits = sign | ((exponent + 127u - 15u) << 23u) | (mantissa << 13u);
+
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+};
+// texels owned by someone else, rows may be padded
+// lets the cpu engine read caller buffers in place instead of copying them into an Image first
+struct ImageView
+{
+	const BYTE* pData = nullptr;
+	UINT width = 0u, height = 0u;
+	Image::Format format = Image::Format::eBGRA8;
+	size_t rowPitch = 0u;
+
+	ImageView() = default;
+	ImageView(const Image& image) : pData(image.data.data()), width(image.width), height(image.height), format(image.format), rowPitch(image.GetRowPitch()) {}
+	ImageView(const BYTE* pData, UINT width, UINT height, Image::Format format, size_t rowPitch) : pData(pData), width(width), height(height), format(format), rowPitch(rowPitch) {}
+
+	inline const BYTE* GetRow(size_t y) const { return pData + y * rowPitch; }
+};
+// writable counterpart, lets the cpu engine write its results straight into caller buffers
+struct MutableImageView
+{
+	BYTE* pData = nullptr;
+	UINT width = 0u, height = 0u;
+	Image::Format format = Image::Format::eR32Float;
+	size_t rowPitch = 0u;
+
+	MutableImageView() = default;
+	MutableImageView(Image& image) : pData(image.data.data()), width(image.width), height(image.height), format(image.format), rowPitch(image.GetRowPitch()) {}
+	MutableImageView(BYTE* pData, UINT width, UINT height, Image::Format format, size_t rowPitch) : pData(pData), width(width), height(height), format(format), rowPitch(rowPitch) {}
+
+	inline BYTE* GetRow(size_t y) const { return pData + y * rowPitch; }
+	inline operator ImageView() const { return { pData, width, height, format, rowPitch }; }
+};
+
+// encodes and writes images on background threads, fed by a bounded queue
+// enqueueing blocks while the queue is full, so capture memory stays capped even if the disk falls behind
+class ImageWriter
+{
+public:
+	enum class FileFormat : UINT {
+		eJPG, // 8-bit, lossy
+		ePNG, // 8-bit color or 16-bit grey, lossless
+		eRaw, // texels as they are in memory
+		ePFM // 32-bit float grey
+	};
+
+public:
+	ImageWriter(UINT nThreads = 2u, size_t capacity = 24u) : capacity(capacity)
+	{
+		workers.reserve(nThreads);
+		for (UINT i = 0u; i < nThreads; i++) workers.emplace_back(&ImageWriter::WorkerLoop, this);
+	}
+	~ImageWriter()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			bRunning = false;
+		}
+		queueCondition.notify_all();
+		for (auto& worker : workers) worker.join(); // remaining images still get written
+	}
+	ROF_DELETE(ImageWriter);
+
+public:
+	void Enqueue(Image&& image, std::wstring path, FileFormat fileFormat)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (pError) std::rethrow_exception(std::exchange(pError, nullptr));
+		spaceCondition.wait(lock, [this] { return queue.size() < capacity; });
+		MemoryTracker::Get().Allocate(MemoryTag::eImageQueue, image.data.size());
+		queue.push_back({ std::move(image), std::move(path), fileFormat });
+		lock.unlock();
+		queueCondition.notify_one();
+	}
+	// waits until everything enqueued so far is on disk, rethrows the first write error
+	void Flush()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		spaceCondition.wait(lock, [this] { return queue.empty() && nActive == 0u; });
+		if (pError) std::rethrow_exception(std::exchange(pError, nullptr));
+	}
+	inline size_t GetQueueSize()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return queue.size();
+	}
+
+	static inline const wchar_t* GetExtension(FileFormat fileFormat)
+	{
+		switch (fileFormat)
+		{
+			case FileFormat::eJPG: return L".jpg";
+			case FileFormat::ePNG: return L".png";
+			case FileFormat::eRaw: return L".raw";
+			case FileFormat::ePFM: return L".pfm";
+		}
+		return L"";
+	}
+	static void Write(const Image& image, const std::wstring& path, FileFormat fileFormat)
+	{
+		switch (fileFormat)
+		{
+			case FileFormat::eRaw: WriteRaw(image, path); break;
+			case FileFormat::ePFM: WritePFM(image, path); break;
+			case FileFormat::eJPG:
+			case FileFormat::ePNG: WriteWIC(image, path, fileFormat); break;
+		}
+	}
+
+private:
+	struct Task
+	{
+		Image image;
+		std::wstring path;
+		FileFormat fileFormat;
+	};
+
+	void WorkerLoop()
+	{
+#ifdef Win32
+		CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+		Profiler::Get().SetThreadName("ImageWriter worker");
+		while (true) {
+			Task task;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				queueCondition.wait(lock, [this] { return !queue.empty() || !bRunning; });
+				if (queue.empty()) break; // only stops once drained
+				task = std::move(queue.front());
+				queue.pop_front();
+				nActive++;
+			}
+			spaceCondition.notify_all();
+
+			try {
+				PROFILE_SCOPE("ImageWriter::Write");
+				Write(task.image, task.path, task.fileFormat);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(mutex);
+				if (!pError) pError = std::current_exception();
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				nActive--;
+			}
+			MemoryTracker::Get().Free(MemoryTag::eImageQueue, task.image.data.size());
+			spaceCondition.notify_all();
+		}
+#ifdef Win32
+		CoUninitialize();
+#endif
+	}
+
+	static void WriteRaw(const Image& image, const std::wstring& path)
+	{
+		std::ofstream file(std::filesystem::path(path), std::ios::binary | std::ios::trunc);
+		if (!file) throw std::runtime_error("Could not open raw image file");
+		file.write(reinterpret_cast<const char*>(image.data.data()), image.data.size());
+	}
+	static void WritePFM(const Image& image, const std::wstring& path)
+	{
+		std::ofstream file(std::filesystem::path(path), std::ios::binary | std::ios::trunc);
+		if (!file) throw std::runtime_error("Could not open pfm image file");
+
+		// greyscale pfm, negative scale marks little endian, rows go bottom to top
+		file << "Pf\n" << image.width << " " << image.height << "\n-1.0\n";
+		std::vector<float> row(image.width);
+		for (size_t y = image.height; y-- > 0u;) {
+			for (size_t x = 0u; x < image.width; x++) row[x] = image.GetValue(x, y);
+			file.write(reinterpret_cast<const char*>(row.data()), row.size() * sizeof(float));
+		}
+	}
+	static void WriteWIC([[maybe_unused]] const Image& image, [[maybe_unused]] const std::wstring& path, [[maybe_unused]] FileFormat fileFormat)
+	{
+#ifdef Win32
+		// convert into a pixel layout the chosen wic encoder accepts
+		const bool bColor = image.format == Image::Format::eBGRA8;
+		const bool bPNG = fileFormat == FileFormat::ePNG;
+		WICPixelFormatGUID pixelFormat;
+		UINT texelSize;
+		if (bColor) {
+			pixelFormat = bPNG ? GUID_WICPixelFormat32bppBGRA : GUID_WICPixelFormat24bppBGR;
+			texelSize = bPNG ? 4u : 3u;
+		}
+		else {
+			pixelFormat = bPNG ? GUID_WICPixelFormat16bppGray : GUID_WICPixelFormat8bppGray;
+			texelSize = bPNG ? 2u : 1u;
+		}
+
+		const UINT rowPitch = image.width * texelSize;
+		std::vector<BYTE> pixels(static_cast<size_t>(rowPitch) * image.height);
+		if (bColor && bPNG) pixels = image.data;
+		else {
+			for (size_t y = 0u; y < image.height; y++) {
+				for (size_t x = 0u; x < image.width; x++) {
+					BYTE* pDst = &pixels[y * rowPitch + x * texelSize];
+					if (bColor) memcpy(pDst, &image.data[(y * image.width + x) * 4u], 3u);
+					else {
+						const float value = std::clamp(image.GetValue(x, y), 0.0f, 1.0f);
+						if (bPNG) *reinterpret_cast<uint16_t*>(pDst) = static_cast<uint16_t>(value * 65535.0f + .5f);
+						else *pDst = static_cast<BYTE>(value * 255.0f + .5f);
+					}
+				}
+			}
+		}
+
+		Microsoft::WRL::ComPtr<IWICImagingFactory> pImgFactory;
+		HRESULT hr = CoCreateInstance(CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(pImgFactory.GetAddressOf()));
+		if (FAILED(hr)) throw std::runtime_error("IWICImagingFactory creation failed");
+
+		Microsoft::WRL::ComPtr<IWICStream> pStream;
+		hr = pImgFactory->CreateStream(pStream.GetAddressOf());
+		if (FAILED(hr)) throw std::runtime_error("IWICStream creation failed");
+		hr = pStream->InitializeFromFilename(path.c_str(), GENERIC_WRITE);
+		if (FAILED(hr)) throw std::runtime_error("Could not open image file for writing");
+
+		Microsoft::WRL::ComPtr<IWICBitmapEncoder> pEncoder;
+		hr = pImgFactory->CreateEncoder(bPNG ? GUID_ContainerFormatPng : GUID_ContainerFormatJpeg, nullptr, pEncoder.GetAddressOf());
+		if (FAILED(hr)) throw std::runtime_error("IWICBitmapEncoder creation failed");
+		hr = pEncoder->Initialize(pStream.Get(), WICBitmapEncoderNoCache);
+		if (FAILED(hr)) throw std::runtime_error("IWICBitmapEncoder initialization failed");
+
+		Microsoft::WRL::ComPtr<IWICBitmapFrameEncode> pFrame;
+		hr = pEncoder->CreateNewFrame(pFrame.GetAddressOf(), nullptr);
+		if (FAILED(hr)) throw std::runtime_error("IWICBitmapFrameEncode creation failed");
+		pFrame->Initialize(nullptr);
+		pFrame->SetSize(image.width, image.height);
+		WICPixelFormatGUID acceptedFormat = pixelFormat;
+		pFrame->SetPixelFormat(&acceptedFormat);
+		if (acceptedFormat != pixelFormat) throw std::runtime_error("Image encoder does not support pixel format");
+
+		hr = pFrame->WritePixels(image.height, rowPitch, static_cast<UINT>(pixels.size()), pixels.data());
+		if (FAILED(hr)) throw std::runtime_error("Writing image pixels failed");
+		pFrame->Commit();
+		pEncoder->Commit();
+#else
+		throw std::runtime_error("JPG/PNG output requires WIC, use raw or pfm instead");
+#endif
+	}
+
+private:
+	const size_t capacity;
+	std::vector<std::thread> workers;
+	std::deque<Task> queue;
+	std::mutex mutex;
+	std::condition_variable queueCondition, spaceCondition;
+	std::exception_ptr pError;
+	UINT nActive = 0u;
+	bool bRunning = true;
+};
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// dependency graph of jobs on top of the shared task scheduler, a job is handed to it once all of its dependencies have finished
+// jobs run at background priority, so loading never holds up the frames rendered meanwhile
+class JobSystem
+{
+public:
+	struct Job
+	{
+		std::function<void()> func;
+		std::atomic<UINT> nPending = 1u; // unfinished dependencies, plus one guard while scheduling
+		std::mutex mutex;
+		std::vector<std::shared_ptr<Job>> dependents;
+		bool bDone = false;
+	};
+	typedef std::shared_ptr<Job> JobHandle;
+
+public:
+	JobSystem(TaskScheduler::Priority priority = TaskScheduler::Priority::eBackground) : priority(priority) {}
+	~JobSystem()
+	{
+		// jobs still waiting to run are dropped, the ones already running are waited for
+		bRunning = false;
+		WaitIdle();
+	}
+	ROF_DELETE(JobSystem);
+
+public:
+	// job runs as soon as every dependency has finished, handles of finished jobs may be passed as well
+	JobHandle Schedule(std::function<void()> func, const std::vector<JobHandle>& dependencies = {})
+	{
+		JobHandle pJob = std::make_shared<Job>();
+		pJob->func = std::move(func);
+		{
+			std::lock_guard<std::mutex> lock(idleMutex);
+			nUnfinished++;
+		}
+
+		for (auto& pDependency : dependencies) {
+			std::lock_guard<std::mutex> lock(pDependency->mutex);
+			if (pDependency->bDone) continue;
+			pJob->nPending++;
+			pDependency->dependents.push_back(pJob);
+		}
+
+		// release scheduling guard
+		if (--pJob->nPending == 0u) Enqueue(pJob);
+		return pJob;
+	}
+	void WaitIdle()
+	{
+		std::unique_lock<std::mutex> lock(idleMutex);
+		idleCondition.wait(lock, [this] { return nUnfinished == 0u; });
+	}
+
+private:
+	void Enqueue(const JobHandle& pJob)
+	{
+		TaskScheduler::Get().Submit([this, pJob]() {
+			if (bRunning) pJob->func();
+			Finish(pJob);
+		}, priority);
+	}
+	void Finish(const JobHandle& pJob)
+	{
+		std::vector<JobHandle> dependents;
+		{
+			std::lock_guard<std::mutex> lock(pJob->mutex);
+			pJob->bDone = true;
+			dependents.swap(pJob->dependents);
+		}
+		for (auto& pDependent : dependents) {
+			if (--pDependent->nPending == 0u) Enqueue(pDependent);
+		}
+
+		// dependents are counted already, so this never reaches zero while there is work left
+		std::lock_guard<std::mutex> lock(idleMutex);
+		if (--nUnfinished == 0u) idleCondition.notify_all();
+	}
+
+private:
+	const TaskScheduler::Priority priority;
+	std::atomic<bool> bRunning = true;
+	std::mutex idleMutex;
+	std::condition_variable idleCondition;
+	size_t nUnfinished = 0u;
+};
\ No newline at end of file
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+
+// subsystems memory gets attributed to
+enum class MemoryTag : UINT { eSwapchain, eLightfield, eRenderTargets, eTextures, eGeometry, eConstantBuffers, eReadback, eImageQueue, eRecording, eExport, eTransient, eCount };
+
+// live byte counts and high-water marks per subsystem, covering gpu resources and large cpu allocations
+// counters are atomic so loaders and writer threads can register without locking
+class MemoryTracker
+{
+public:
+	struct Usage
+	{
+		int64_t current, peak;
+		uint64_t nAllocations; // currently alive
+	};
+
+private:
+	MemoryTracker() = default;
+	~MemoryTracker() = default;
+	ROF_DELETE(MemoryTracker);
+
+public:
+	static inline MemoryTracker& Get()
+	{
+		static MemoryTracker instance;
+		return instance;
+	}
+	static inline const char* GetTagName(MemoryTag tag)
+	{
+		switch (tag)
+		{
+			case MemoryTag::eSwapchain: return "Swapchain";
+			case MemoryTag::eLightfield: return "Lightfield";
+			case MemoryTag::eRenderTargets: return "RenderTargets";
+			case MemoryTag::eTextures: return "Textures";
+			case MemoryTag::eGeometry: return "Geometry";
+			case MemoryTag::eConstantBuffers: return "ConstantBuffers";
+			case MemoryTag::eReadback: return "Readback";
+			case MemoryTag::eImageQueue: return "ImageQueue";
+			case MemoryTag::eRecording: return "Recording";
+			case MemoryTag::eExport: return "Export";
+			case MemoryTag::eTransient: return "Transient";
+			default: return "Unknown";
+		}
+	}
+
+	inline void Allocate(MemoryTag tag, size_t size)
+	{
+		Counter& counter = counters[static_cast<UINT>(tag)];
+		UpdatePeak(counter.peak, counter.current.fetch_add(size) + static_cast<int64_t>(size));
+		UpdatePeak(totalPeak, total.fetch_add(size) + static_cast<int64_t>(size));
+		counter.nAllocations++;
+	}
+	inline void Free(MemoryTag tag, size_t size)
+	{
+		Counter& counter = counters[static_cast<UINT>(tag)];
+		counter.current -= size;
+		total -= size;
+		counter.nAllocations--;
+	}
+
+	inline Usage GetUsage(MemoryTag tag) const
+	{
+		const Counter& counter = counters[static_cast<UINT>(tag)];
+		return { counter.current.load(), counter.peak.load(), counter.nAllocations.load() };
+	}
+	inline Usage GetTotal() const
+	{
+		uint64_t nAllocations = 0u;
+		for (const auto& counter : counters) nAllocations += counter.nAllocations;
+		return { total.load(), totalPeak.load(), nAllocations };
+	}
+
+	void WriteReport(std::ostream& stream) const
+	{
+		constexpr double mebibyte = 1024.0 * 1024.0;
+		stream << std::left << std::setw(18) << "subsystem" << std::right << std::setw(8) << "allocs"
+			<< std::setw(14) << "current MiB" << std::setw(12) << "peak MiB" << "\n";
+		stream << std::fixed << std::setprecision(2);
+		for (UINT i = 0u; i < static_cast<UINT>(MemoryTag::eCount); i++) {
+			const Usage usage = GetUsage(static_cast<MemoryTag>(i));
+			stream << std::left << std::setw(18) << GetTagName(static_cast<MemoryTag>(i)) << std::right << std::setw(8) << usage.nAllocations
+				<< std::setw(14) << usage.current / mebibyte << std::setw(12) << usage.peak / mebibyte << "\n";
+		}
+		const Usage usage = GetTotal();
+		stream << std::left << std::setw(18) << "total" << std::right << std::setw(8) << usage.nAllocations
+			<< std::setw(14) << usage.current / mebibyte << std::setw(12) << usage.peak / mebibyte << "\n";
+	}
+
+private:
+	struct Counter
+	{
+		std::atomic<int64_t> current = 0, peak = 0;
+		std::atomic<uint64_t> nAllocations = 0u;
+	};
+
+	static inline void UpdatePeak(std::atomic<int64_t>& peak, int64_t value)
+	{
+		int64_t prev = peak.load();
+		while (prev < value && !peak.compare_exchange_weak(prev, value));
+	}
+
+private:
+	std::array<Counter, static_cast<size_t>(MemoryTag::eCount)> counters;
+	std::atomic<int64_t> total = 0, totalPeak = 0;
+};
+
+// registers one allocation for as long as it is alive, re-tracking replaces the previous size
+class TrackedMemory
+{
+public:
+	TrackedMemory() = default;
+	~TrackedMemory()
+	{
+		Release();
+	}
+	ROF_DELETE(TrackedMemory);
+
+public:
+	inline void Track(MemoryTag tag, size_t size)
+	{
+		Release();
+		MemoryTracker::Get().Allocate(tag, size);
+		this->tag = tag;
+		this->size = size;
+		bTracked = true;
+	}
+	inline void Release()
+	{
+		if (!bTracked) return;
+		MemoryTracker::Get().Free(tag, size);
+		bTracked = false;
+	}
+	inline size_t GetSize() const { return bTracked ? size : 0u; }
+
+private:
+	MemoryTag tag = MemoryTag::eCount;
+	size_t size = 0u;
+	bool bTracked = false;
+};
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+
+// splits the range [begin, end) into contiguous chunks and runs func(i) for every index on the shared task scheduler
+// a few chunks per thread let idle workers steal from uneven ranges, the calling thread works on the first chunk itself
+template<typename Func>
+static void ParallelFor(size_t begin, size_t end, Func&& func)
+{
+	if (end <= begin) return;
+	const size_t count = end - begin;
+	const size_t nChunks = std::min<size_t>(static_cast<size_t>(TaskScheduler::Get().GetThreadCount()) * 4u, count);
+	const size_t chunkSize = (count + nChunks - 1) / nChunks;
+
+	auto runChunk = [&](size_t iChunk) {
+		const size_t chunkBegin = begin + iChunk * chunkSize;
+		const size_t chunkEnd = std::min(chunkBegin + chunkSize, end);
+		for (size_t i = chunkBegin; i < chunkEnd; i++) func(i);
+	};
+	if (nChunks == 1u || TaskScheduler::Get().GetThreadCount() == 1u) {
+		for (size_t i = begin; i < end; i++) func(i); // the whole range, not just the first chunk
+		return;
+	}
+
+	TaskScheduler::TaskGroup group;
+	for (size_t iChunk = 1; iChunk * chunkSize < count; iChunk++) group.Run([&runChunk, iChunk]() { runChunk(iChunk); });
+	runChunk(0);
+	group.Wait();
+}
+
+// runs func(x0, y0, x1, y1) for every tile of an image, tiles on the right and bottom border are clipped
+template<typename Func>
+static void ParallelForTiles(UINT width, UINT height, UINT tileSize, Func&& func)
+{
+	const UINT nTilesX = (width + tileSize - 1u) / tileSize;
+	const UINT nTilesY = (height + tileSize - 1u) / tileSize;
+	ParallelFor(0u, static_cast<size_t>(nTilesX) * nTilesY, [&](size_t iTile) {
+		const UINT x0 = static_cast<UINT>(iTile % nTilesX) * tileSize, y0 = static_cast<UINT>(iTile / nTilesX) * tileSize;
+		func(x0, y0, std::min(x0 + tileSize, width), std::min(y0 + tileSize, height));
+	});
+}
\ No newline at end of file
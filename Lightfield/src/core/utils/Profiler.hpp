@@ -0,0 +1,204 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <map>
+
+// scoped cpu timers, compiled into every build and switched on at runtime
+// each thread appends to its own buffer, so zones on different threads never contend
+class Profiler
+{
+public:
+	struct Event
+	{
+		const char* name; // has to outlive the profiler, string literals only
+		int64_t start, end; // nanoseconds since profiler creation
+		UINT depth; // nesting level within the thread
+	};
+	struct ZoneStats
+	{
+		uint64_t count = 0u;
+		double min = 0.0, mean = 0.0, p99 = 0.0, total = 0.0; // milliseconds
+	};
+
+private:
+	struct ThreadBuffer
+	{
+		std::mutex mutex; // only ever contended while exporting
+		std::vector<Event> events;
+		std::string name;
+		UINT id = 0u;
+		UINT depth = 0u;
+	};
+
+	Profiler() : epoch(std::chrono::steady_clock::now()) {}
+	~Profiler() = default;
+	ROF_DELETE(Profiler);
+
+public:
+	static inline Profiler& Get()
+	{
+		static Profiler instance;
+		return instance;
+	}
+
+	inline bool IsEnabled() const { return bEnabled.load(std::memory_order_relaxed); }
+	inline void SetEnabled(bool bEnable) { bEnabled.store(bEnable, std::memory_order_relaxed); }
+	inline void SetThreadName(std::string name)
+	{
+		ThreadBuffer& buffer = GetThreadBuffer();
+		std::lock_guard<std::mutex> lock(buffer.mutex);
+		buffer.name = std::move(name);
+	}
+
+	inline int64_t Now() const
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+	}
+	inline UINT BeginZone()
+	{
+		return GetThreadBuffer().depth++;
+	}
+	inline void EndZone(const char* name, int64_t start, UINT depth)
+	{
+		const int64_t end = Now();
+		ThreadBuffer& buffer = GetThreadBuffer();
+		buffer.depth = depth;
+
+		std::lock_guard<std::mutex> lock(buffer.mutex);
+		if (buffer.events.size() < maxEventsPerThread) buffer.events.push_back({ name, start, end, depth });
+		else nDropped.fetch_add(1u, std::memory_order_relaxed);
+	}
+
+	// drops every recorded event, thread buffers stay registered
+	void Clear()
+	{
+		std::lock_guard<std::mutex> lock(buffersMutex);
+		for (auto& pBuffer : buffers) {
+			std::lock_guard<std::mutex> bufferLock(pBuffer->mutex);
+			pBuffer->events.clear();
+		}
+		nDropped = 0u;
+	}
+	inline uint64_t GetDroppedCount() const { return nDropped; }
+
+	// trace in the chrome tracing json format, opens in chrome://tracing or perfetto
+	void ExportChromeTrace(const std::filesystem::path& path)
+	{
+		std::ofstream file(path, std::ios::trunc);
+		if (!file) throw std::runtime_error("Could not open trace file");
+
+		file << "{\"traceEvents\":[\n";
+		bool bFirst = true;
+		std::lock_guard<std::mutex> lock(buffersMutex);
+		for (auto& pBuffer : buffers) {
+			std::lock_guard<std::mutex> bufferLock(pBuffer->mutex);
+			if (!pBuffer->name.empty()) {
+				file << (bFirst ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << pBuffer->id
+					<< ",\"args\":{\"name\":\"" << pBuffer->name << "\"}}";
+				bFirst = false;
+			}
+			for (const auto& event : pBuffer->events) {
+				file << (bFirst ? "" : ",\n") << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << pBuffer->id
+					<< std::fixed << std::setprecision(3) << ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+				bFirst = false;
+			}
+		}
+		file << "\n]}\n";
+	}
+
+	// per zone name over all threads
+	std::map<std::string, ZoneStats> GetSummary()
+	{
+		std::map<std::string, std::vector<double>> durations;
+		{
+			std::lock_guard<std::mutex> lock(buffersMutex);
+			for (auto& pBuffer : buffers) {
+				std::lock_guard<std::mutex> bufferLock(pBuffer->mutex);
+				for (const auto& event : pBuffer->events) durations[event.name].push_back((event.end - event.start) * 1e-6);
+			}
+		}
+
+		std::map<std::string, ZoneStats> summary;
+		for (auto& [name, values] : durations) {
+			std::sort(values.begin(), values.end());
+			ZoneStats& stats = summary[name];
+			stats.count = values.size();
+			stats.min = values.front();
+			for (double value : values) stats.total += value;
+			stats.mean = stats.total / values.size();
+			stats.p99 = values[std::min(values.size() - 1u, static_cast<size_t>(values.size() * .99))];
+		}
+		return summary;
+	}
+	void ExportSummary(const std::filesystem::path& path)
+	{
+		std::ofstream file(path, std::ios::trunc);
+		if (!file) throw std::runtime_error("Could not open profiler summary file");
+
+		file << std::left << std::setw(32) << "zone" << std::right << std::setw(10) << "count"
+			<< std::setw(12) << "min ms" << std::setw(12) << "mean ms" << std::setw(12) << "p99 ms" << std::setw(14) << "total ms" << "\n";
+		file << std::fixed << std::setprecision(3);
+		for (const auto& [name, stats] : GetSummary()) {
+			file << std::left << std::setw(32) << name << std::right << std::setw(10) << stats.count
+				<< std::setw(12) << stats.min << std::setw(12) << stats.mean << std::setw(12) << stats.p99 << std::setw(14) << stats.total << "\n";
+		}
+		if (nDropped > 0u) file << nDropped << " events dropped, per-thread buffers were full\n";
+	}
+
+private:
+	ThreadBuffer& GetThreadBuffer()
+	{
+		// shared ownership keeps the events of finished threads around for export
+		thread_local std::shared_ptr<ThreadBuffer> pBuffer;
+		if (!pBuffer) {
+			pBuffer = std::make_shared<ThreadBuffer>();
+			pBuffer->events.reserve(initialEventsPerThread);
+
+			std::lock_guard<std::mutex> lock(buffersMutex);
+			pBuffer->id = static_cast<UINT>(buffers.size());
+			buffers.push_back(pBuffer);
+		}
+		return *pBuffer;
+	}
+
+private:
+	static constexpr size_t initialEventsPerThread = 4096u;
+	static constexpr size_t maxEventsPerThread = 1u << 20u;
+
+	const std::chrono::steady_clock::time_point epoch;
+	std::atomic<bool> bEnabled = false;
+	std::atomic<uint64_t> nDropped = 0u;
+	std::mutex buffersMutex;
+	std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+};
+
+// times the enclosing scope, does nothing but a single flag check while the profiler is disabled
+class ProfileScope
+{
+public:
+	ProfileScope(const char* name) : name(name), bActive(Profiler::Get().IsEnabled())
+	{
+		if (!bActive) return;
+		depth = Profiler::Get().BeginZone();
+		start = Profiler::Get().Now();
+	}
+	~ProfileScope()
+	{
+		if (bActive) Profiler::Get().EndZone(name, start, depth);
+	}
+	ROF_DELETE(ProfileScope);
+
+private:
+	const char* const name;
+	const bool bActive;
+	UINT depth = 0u;
+	int64_t start = 0;
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
\ No newline at end of file
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <fstream>
+
+// records image sequences into a single stream file, frames go through a preallocated ring drained by a writer thread
+// memory use is fixed by the slot count, a full ring either blocks the producer or drops the frame
+class Recorder
+{
+public:
+	enum class OverflowPolicy : UINT {
+		eBlock, // producer waits for the writer, no frame is lost
+		eDrop // producer skips the frame, keeps the frame rate
+	};
+	struct Frame
+	{
+		uint64_t index; // running index, dropped frames leave gaps
+		double time; // seconds since recording start
+		std::vector<Image> images;
+	};
+	struct Stats
+	{
+		uint64_t nWritten = 0u, nDropped = 0u, bytesWritten = 0u;
+		size_t nQueued = 0u, nSlots = 0u;
+		double seconds = 0.0;
+
+		inline double GetThroughput() const { return seconds > 0.0 ? bytesWritten / (seconds * 1024.0 * 1024.0) : 0.0; } // MiB/s
+	};
+
+public:
+	Recorder(size_t nSlots = 4u, OverflowPolicy policy = OverflowPolicy::eBlock) : nSlots(nSlots), policy(policy) {}
+	~Recorder()
+	{
+		try {
+			Stop();
+		}
+		catch (...) {}
+	}
+	ROF_DELETE(Recorder);
+
+public:
+	// layout images define count, size and format of every image in a frame, their data is ignored
+	void Start(const std::filesystem::path& path, const std::vector<Image>& layout)
+	{
+		if (IsRecording()) throw std::runtime_error("Recorder is already recording");
+
+		file.open(path, std::ios::binary | std::ios::trunc);
+		if (!file) throw std::runtime_error("Could not open recording file");
+
+		// stream header: magic, version, image count, then width, height and format of each image
+		const UINT header[3] = { streamMagic, streamVersion, static_cast<UINT>(layout.size()) };
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		for (const auto& image : layout) {
+			const UINT imageHeader[3] = { image.width, image.height, static_cast<UINT>(image.format) };
+			file.write(reinterpret_cast<const char*>(imageHeader), sizeof(imageHeader));
+		}
+
+		// allocate all slots upfront, nothing is allocated while recording
+		slots.resize(nSlots);
+		for (auto& slot : slots) {
+			slot.images.resize(layout.size());
+			for (size_t i = 0u; i < layout.size(); i++) {
+				slot.images[i].width = layout[i].width;
+				slot.images[i].height = layout[i].height;
+				slot.images[i].format = layout[i].format;
+				slot.images[i].data.resize(static_cast<size_t>(layout[i].GetRowPitch()) * layout[i].height);
+			}
+		}
+
+		size_t frameSize = 0u;
+		for (const auto& image : slots.front().images) frameSize += image.data.size();
+		memory.Track(MemoryTag::eRecording, frameSize * nSlots);
+
+		iHead = iTail = 0u;
+		nUsed = nSubmitted = 0u;
+		nextIndex = 0u;
+		stats = Stats();
+		stats.nSlots = nSlots;
+		pError = nullptr;
+		startTime = std::chrono::steady_clock::now();
+		bRunning = true;
+		writer = std::thread(&Recorder::WriterLoop, this);
+	}
+	// waits until every submitted frame is on disk, then releases the ring
+	void Stop()
+	{
+		if (!IsRecording()) return;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			bRunning = false;
+		}
+		frameCondition.notify_all();
+		writer.join();
+
+		file.close();
+		slots.clear();
+		slots.shrink_to_fit();
+		memory.Release();
+		if (pError) std::rethrow_exception(std::exchange(pError, nullptr));
+	}
+	inline bool IsRecording() const { return writer.joinable(); }
+
+	// returns the next free slot to fill, or nullptr if the frame was dropped
+	Frame* Acquire()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (pError) std::rethrow_exception(std::exchange(pError, nullptr));
+
+		const uint64_t index = nextIndex++;
+		if (nUsed == nSlots) {
+			if (policy == OverflowPolicy::eDrop) {
+				stats.nDropped++;
+				return nullptr;
+			}
+			spaceCondition.wait(lock, [this] { return nUsed < nSlots; });
+		}
+		nUsed++;
+
+		Frame& frame = slots[iHead];
+		frame.index = index;
+		frame.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		return &frame;
+	}
+	// hands the most recently acquired frame to the writer
+	void Submit()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			iHead = (iHead + 1u) % nSlots;
+			nSubmitted++;
+		}
+		frameCondition.notify_one();
+	}
+
+	Stats GetStats()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Stats current = stats;
+		current.nQueued = nSubmitted;
+		if (IsRecording()) current.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		return current;
+	}
+	inline void SetOverflowPolicy(OverflowPolicy policy)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->policy = policy;
+	}
+
+private:
+	void WriterLoop()
+	{
+		Profiler::Get().SetThreadName("Recorder writer");
+		bool bFailed = false;
+		while (true) {
+			Frame* pFrame;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				frameCondition.wait(lock, [this] { return nSubmitted > 0u || !bRunning; });
+				if (nSubmitted == 0u) break; // only stops once drained
+				pFrame = &slots[iTail];
+			}
+
+			// slot belongs to the writer until released, so no lock is held during disk io
+			uint64_t nBytes = 0u;
+			if (!bFailed) {
+				try {
+					PROFILE_SCOPE("Recorder::WriteFrame");
+					nBytes = WriteFrame(*pFrame);
+				}
+				catch (...) {
+					// keep releasing slots so the producer never deadlocks, the error surfaces on the next acquire
+					std::lock_guard<std::mutex> lock(mutex);
+					pError = std::current_exception();
+					bFailed = true;
+				}
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				iTail = (iTail + 1u) % nSlots;
+				nSubmitted--;
+				nUsed--;
+				if (nBytes > 0u) {
+					stats.nWritten++;
+					stats.bytesWritten += nBytes;
+				}
+				stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+			}
+			spaceCondition.notify_one();
+		}
+	}
+	uint64_t WriteFrame(const Frame& frame)
+	{
+		// frame header: index and timestamp, followed by the tightly packed images in layout order
+		file.write(reinterpret_cast<const char*>(&frame.index), sizeof(frame.index));
+		file.write(reinterpret_cast<const char*>(&frame.time), sizeof(frame.time));
+		uint64_t nBytes = sizeof(frame.index) + sizeof(frame.time);
+		for (const auto& image : frame.images) {
+			file.write(reinterpret_cast<const char*>(image.data.data()), image.data.size());
+			nBytes += image.data.size();
+		}
+		if (!file) throw std::runtime_error("Writing recorded frame failed");
+		return nBytes;
+	}
+
+private:
+	static constexpr UINT streamMagic = 0x51534C46u; // "FLSQ"
+	static constexpr UINT streamVersion = 1u;
+
+	const size_t nSlots;
+	OverflowPolicy policy;
+	std::vector<Frame> slots;
+	size_t iHead = 0u, iTail = 0u; // next slot to acquire, next slot to write
+	size_t nUsed = 0u, nSubmitted = 0u; // slots acquired or queued, slots queued for writing
+	uint64_t nextIndex = 0u;
+
+	std::ofstream file;
+	std::thread writer;
+	std::mutex mutex;
+	std::condition_variable frameCondition, spaceCondition;
+	std::chrono::steady_clock::time_point startTime;
+	std::exception_ptr pError;
+	Stats stats;
+	TrackedMemory memory;
+	bool bRunning = false;
+};
\ No newline at end of file
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+
+// one pool of worker threads shared by every stage, so loading, depth kernels, filters and encoding never oversubscribe the cores
+// every worker owns a deque per priority, it runs its newest task first while idle threads steal the oldest ones of others
+// more urgent tasks are always picked first, tasks spawned from within a task inherit its priority
+class TaskScheduler
+{
+public:
+	enum class Priority : UINT { eInteractive, eNormal, eBackground, eCount };
+
+	// tasks spawned through a group can be waited on together, the first exception thrown by one of them is rethrown by Wait
+	class TaskGroup
+	{
+	public:
+		TaskGroup() = default;
+		~TaskGroup() { TaskScheduler::Get().WaitUntil([this] { return nPending.load() == 0u; }); }
+		ROF_DELETE(TaskGroup);
+
+	public:
+		void Run(std::function<void()> func)
+		{
+			nPending++;
+			TaskScheduler::Get().Submit([this, func = std::move(func)]() {
+				try {
+					func();
+				}
+				catch (...) {
+					std::lock_guard<std::mutex> lock(errorMutex);
+					if (!pError) pError = std::current_exception();
+					bFailed = true;
+				}
+				nPending--; // group may be gone right after this
+			});
+		}
+		// helps running queued tasks until every task of the group has finished
+		void Wait()
+		{
+			TaskScheduler::Get().WaitUntil([this] { return nPending.load() == 0u; });
+			if (!bFailed) return;
+			std::exception_ptr pRethrow;
+			{
+				std::lock_guard<std::mutex> lock(errorMutex);
+				pRethrow = std::exchange(pError, nullptr);
+				bFailed = false;
+			}
+			std::rethrow_exception(pRethrow);
+		}
+		inline bool HasFailed() const { return bFailed.load(); }
+
+	private:
+		std::atomic<size_t> nPending = 0u;
+		std::atomic<bool> bFailed = false;
+		std::mutex errorMutex;
+		std::exception_ptr pError;
+	};
+
+	// runs everything the current thread submits or waits on at the given priority until it goes out of scope
+	class ScopedPriority
+	{
+	public:
+		ScopedPriority(Priority priority) : previous(std::exchange(currentPriority, priority)) {}
+		~ScopedPriority() { currentPriority = previous; }
+		ROF_DELETE(ScopedPriority);
+
+	private:
+		Priority previous;
+	};
+
+private:
+	struct Task
+	{
+		std::function<void()> func;
+		Priority priority;
+	};
+	struct Queue
+	{
+		std::mutex mutex;
+		std::array<std::deque<Task>, static_cast<size_t>(Priority::eCount)> tasks;
+	};
+
+	TaskScheduler(UINT nWorkers = std::max(std::thread::hardware_concurrency(), 2u) - 1u)
+	{
+		// one queue per worker, the last one takes the tasks submitted from outside the pool
+		for (UINT i = 0u; i <= nWorkers; i++) queues.push_back(std::make_unique<Queue>());
+		workers.reserve(nWorkers);
+		for (UINT i = 0u; i < nWorkers; i++) workers.emplace_back(&TaskScheduler::WorkerLoop, this, i);
+	}
+	~TaskScheduler()
+	{
+		{
+			std::lock_guard<std::mutex> lock(wakeMutex);
+			bRunning = false;
+		}
+		wakeCondition.notify_all();
+		for (auto& worker : workers) worker.join();
+	}
+	ROF_DELETE(TaskScheduler);
+
+public:
+	static inline TaskScheduler& Get()
+	{
+		static TaskScheduler instance;
+		return instance;
+	}
+
+	// threads working on submitted tasks, including the one waiting for them
+	inline UINT GetThreadCount() const { return static_cast<UINT>(workers.size()) + 1u; }
+	static inline Priority GetPriority() { return currentPriority; }
+
+	void Submit(std::function<void()> func) { Submit(std::move(func), currentPriority); }
+	void Submit(std::function<void()> func, Priority priority)
+	{
+		Queue& queue = *queues[iWorker < workers.size() ? iWorker : workers.size()];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.tasks[static_cast<size_t>(priority)].push_back({ std::move(func), priority });
+		}
+		nQueued++;
+		{
+			std::lock_guard<std::mutex> lock(wakeMutex);
+		}
+		// waiting threads help as well, so they have to hear about new work too
+		if (nWaiting.load() > 0u) wakeCondition.notify_all();
+		else wakeCondition.notify_one();
+	}
+
+	// runs queued tasks at least as urgent as the current priority until the condition holds
+	// so a frame waiting on its kernels never ends up inside a long background job
+	void WaitUntil(const std::function<bool()>& condition)
+	{
+		while (!condition()) {
+			if (TryRunTask(currentPriority)) continue;
+			std::unique_lock<std::mutex> lock(wakeMutex);
+			nWaiting++;
+			wakeCondition.wait(lock, [&] { return condition() || HasQueued(currentPriority); });
+			nWaiting--;
+		}
+	}
+
+private:
+	void WorkerLoop(UINT i)
+	{
+#ifdef Win32
+		// texture decoding goes through WIC, which needs COM on every thread
+		CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+		iWorker = i;
+		Profiler::Get().SetThreadName("TaskScheduler worker " + std::to_string(i));
+		while (true) {
+			if (TryRunTask(Priority::eBackground)) continue;
+			std::unique_lock<std::mutex> lock(wakeMutex);
+			wakeCondition.wait(lock, [this] { return nQueued.load() > 0u || !bRunning; });
+			if (!bRunning) break;
+		}
+#ifdef Win32
+		CoUninitialize();
+#endif
+	}
+
+	// own queue from the back, then the external queue and the other workers from the front, most urgent priority first
+	bool TryRunTask(Priority lowestPriority)
+	{
+		if (nQueued.load() == 0u) return false;
+		const size_t nQueues = queues.size();
+		const size_t iOwn = iWorker < workers.size() ? iWorker : workers.size();
+		Task task;
+		bool bFound = false;
+		for (size_t p = 0u; p <= static_cast<size_t>(lowestPriority) && !bFound; p++) {
+			for (size_t n = 0u; n < nQueues && !bFound; n++) {
+				Queue& queue = *queues[(iOwn + n) % nQueues];
+				std::lock_guard<std::mutex> lock(queue.mutex);
+				std::deque<Task>& tasks = queue.tasks[p];
+				if (tasks.empty()) continue;
+				if (n == 0u) {
+					task = std::move(tasks.back());
+					tasks.pop_back();
+				}
+				else {
+					task = std::move(tasks.front());
+					tasks.pop_front();
+				}
+				bFound = true;
+			}
+		}
+		if (!bFound) return false;
+		nQueued--;
+
+		const Priority previous = std::exchange(currentPriority, task.priority);
+		{
+			ScopedArena arena; // scratch of a task is gone once it returns
+			task.func();
+		}
+		currentPriority = previous;
+
+		// waiters check their condition under the wake mutex, taking it here makes sure none of them misses the change
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		if (nWaiting.load() > 0u) wakeCondition.notify_all();
+		return true;
+	}
+	bool HasQueued(Priority lowestPriority)
+	{
+		if (nQueued.load() == 0u) return false;
+		for (auto& pQueue : queues) {
+			std::lock_guard<std::mutex> lock(pQueue->mutex);
+			for (size_t p = 0u; p <= static_cast<size_t>(lowestPriority); p++) if (!pQueue->tasks[p].empty()) return true;
+		}
+		return false;
+	}
+
+private:
+	static inline thread_local size_t iWorker = SIZE_MAX;
+	static inline thread_local Priority currentPriority = Priority::eNormal;
+
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> workers;
+	std::atomic<size_t> nQueued = 0u;
+	std::atomic<UINT> nWaiting = 0u;
+	std::mutex wakeMutex;
+	std::condition_variable wakeCondition;
+	bool bRunning = true;
+};
\ No newline at end of file
@@ -6,7 +6,7 @@ class Time
 {
 
 private:
-	Time() : appStart(std::chrono::high_resolution_clock::now()), lastFrame(appStart) {}
+	Time() : appStart(std::chrono::steady_clock::now()), lastFrame(appStart) {}
 	~Time() = default;
 	ROF_DELETE(Time);
 
@@ -30,6 +30,6 @@ public:
 	float totalTime;
 
 private:
-	const std::chrono::high_resolution_clock::time_point appStart;
-	std::chrono::high_resolution_clock::time_point lastFrame;
+	const std::chrono::steady_clock::time_point appStart;
+	std::chrono::steady_clock::time_point lastFrame;
 };
\ No newline at end of file
@@ -88,69 +88,59 @@ public:
 private:
 	void Start()
 	{
-		auto* pDevice = pRenderer->GetDevice();
-		auto& renderObjects = pRenderer->GetRenderObjects();
+		Profiler::Get().SetThreadName("Main");
 
 		// move cam a bit further back to see the entire scene
 		pRenderer->GetCamera().GetTransform().Translate(0.0f, 0.0f, -10.0f);
 
-		// create some objects to view
-		{
-			renderObjects.emplace_back(std::make_unique<RenderObject>(pDevice, Primitive::Sphere));
-			auto& transform = renderObjects.back()->GetTransform();
+		// create some objects to view, they appear in the scene as soon as each of them finished loading
+		pSceneLoader = std::make_unique<SceneLoader>(pRenderer->GetDevice());
+		pSceneLoader->Load(Primitive::Sphere, [](Transform& transform) {
 			transform.Translate(0.0f, 0.0f, 2.0f);
 			transform.SetScale(1.0f, 1.0f, 1.0f);
-		}
-		//{
-		//	renderObjects.emplace_back(std::make_unique<RenderObject>(pDevice, Primitive::Cube));
-		//	auto& transform = renderObjects.back()->GetTransform();
+		});
+		//pSceneLoader->Load(Primitive::Cube, [](Transform& transform) {
 		//	transform.Translate(0.0f, 0.0f, 0.0f);
 		//	transform.SetScale(0.3f, 0.3f, 0.3f);
-		//}
-		{
-			renderObjects.emplace_back(std::make_unique<RenderObject>(pDevice, Primitive::Quad));
-			auto& transform = renderObjects.back()->GetTransform();
+		//});
+		pSceneLoader->Load(Primitive::Quad, [](Transform& transform) {
 			transform.Translate(-0.01f, -3.5f, 0.0f);
 			transform.RotateEuler(static_cast<float>(M_PI_2), 0.0f, 0.0f);
 			transform.SetScale(10.0f, 10.0f, 1.0f);
-		}
-		{
-			renderObjects.emplace_back(std::make_unique<RenderObject>(pDevice, "Bevel_Floor"));
-			auto& transform = renderObjects.back()->GetTransform();
+		});
+		pSceneLoader->Load("Bevel_Floor", [](Transform& transform) {
 			transform.Translate(0.0f, -3.49f, 0.0f);
 			transform.SetScale(5.0f, 1.0f, 5.0f);
-		}
-		{
-			renderObjects.emplace_back(std::make_unique<RenderObject>(pDevice, "PLANTS_ON_TABLE_10k"));
-			auto& transform = renderObjects.back()->GetTransform();
+		});
+		pSceneLoader->Load("PLANTS_ON_TABLE_10k", [](Transform& transform) {
 			transform.Translate(3.8f, -3.5f, -1.5f);
 			transform.RotateEuler(0.0f, static_cast<float>(M_PI_2) - 0.25f, 0.0f);
 			transform.SetScale(1.0f, 1.0f, 1.0f);
-		}
-		{
-			renderObjects.emplace_back(std::make_unique<RenderObject>(pDevice, "Medieval_boxes"));
-			auto& transform = renderObjects.back()->GetTransform();
+		});
+		pSceneLoader->Load("Medieval_boxes", [](Transform& transform) {
 			transform.Translate(-4.0f, -3.49f, -4.0f);
 			transform.RotateEuler(0.0f, static_cast<float>(M_PI_2) * 0.5f, 0.0f);
 			transform.SetScale(2.0f, 2.0f, 2.0f);
-		}
-		//{
-		//	renderObjects.emplace_back(std::make_unique<RenderObject>(pDevice, "Patio_Set"));
-		//	auto& transform = renderObjects.back()->GetTransform();
+		});
+		//pSceneLoader->Load("Patio_Set", [](Transform& transform) {
 		//	transform.Translate(3.0f, -3.49f, -3.5f);
 		//	transform.RotateEuler(0.0f, static_cast<float>(M_PI_2) + 0.1f, 0.0f);
 		//	transform.SetScale(0.01f, 0.01f, 0.01f);
-		//}
+		//});
 	}
 	void Update()
 	{
 		Time::Get().Mark();
+		PROFILE_SCOPE("Frame");
 		
+		if (pSceneLoader->IsLoading()) pSceneLoader->Collect(pRenderer->GetRenderObjects());
 		HandleInput();
 
-		pRenderer->SimulateScene();
-		pRenderer->DeduceDepth();
+		pRenderer->RenderFrame();
+		pRenderer->Record();
 		pRenderer->Present();
+
+		UpdateTitle();
 	}
 	void HandleInput()
 	{
@@ -158,13 +148,80 @@ private:
 		else if (input.IsKeyPressed(VK_F2)) pRenderer->SetPresentationMode(Renderer::PresentationMode::eSimulatedDepth);
 		else if (input.IsKeyPressed(VK_F3)) pRenderer->SetPresentationMode(Renderer::PresentationMode::eOutputDepth);
 		else if (input.IsKeyPressed(VK_F4)) pRenderer->CyclePreviewCam();
+		if (input.IsKeyPressed(VK_F5)) pRenderer->ToggleFusedDepth();
+		if (input.IsKeyPressed(VK_F6)) pRenderer->ToggleDepthRefinement();
+		if (input.IsKeyPressed(VK_F7)) ReportMemory();
+		if (input.IsKeyPressed(VK_F8)) pRenderer->ExportMesh();
 		if (input.IsKeyPressed(VK_F9)) pRenderer->Screenshot();
+		if (input.IsKeyPressed(VK_F10)) pRenderer->ToggleRecording();
+		if (input.IsKeyPressed(VK_F11)) ToggleProfiling();
+		if (input.IsKeyPressed('P')) ToggleCameraPath();
+		if (input.IsKeyPressed('T')) pRenderer->ToggleEpiDepth();
+		if (input.IsKeyPressed('R')) pRenderer->CycleDepthScale();
+		if (input.IsKeyPressed('L')) pRenderer->ToggleViewArchive();
 		HandleCameraMovement();
 
 		// flush one-frame inputs "pressed" and "released"
 		input.kbd.FlushOldInputs();
 		input.mouse.FlushOldInputs();
 	}
+	void ReportMemory()
+	{
+		// per subsystem breakdown to the debugger output and the console
+		std::stringstream ss;
+		MemoryTracker::Get().WriteReport(ss);
+		ss << "frame graph:\n";
+		pRenderer->GetFrameGraph().WriteReport(ss);
+		OutputDebugStringA(ss.str().c_str());
+		std::cout << ss.str();
+	}
+	void ToggleProfiling()
+	{
+		Profiler& profiler = Profiler::Get();
+		if (!profiler.IsEnabled()) {
+			profiler.Clear();
+			profiler.SetEnabled(true);
+			return;
+		}
+
+		// capture ends here, write trace and per-zone summary side by side
+		profiler.SetEnabled(false);
+		std::filesystem::create_directory(std::filesystem::current_path() / L"profiles");
+		std::wstringstream wss;
+		wss << L"profiles/capture_" << std::time(nullptr);
+		profiler.ExportChromeTrace(wss.str() + L".json");
+		profiler.ExportSummary(wss.str() + L".txt");
+	}
+	// recorded camera paths are replayed by the headless build (--replay) to get comparable timings across builds and machines
+	void ToggleCameraPath()
+	{
+		bRecordingCameraPath = !bRecordingCameraPath;
+		if (bRecordingCameraPath) {
+			cameraPath.Clear();
+			return;
+		}
+		std::filesystem::create_directory(std::filesystem::current_path() / L"recordings");
+		cameraPath.Write(L"recordings/camera_" + std::to_wstring(std::time(nullptr)) + L".lfcam");
+	}
+	void UpdateTitle()
+	{
+		// recording stats, refreshed twice a second
+		if (Time::Get().totalTime < nextTitleUpdate) return;
+		nextTitleUpdate = Time::Get().totalTime + .5f;
+
+		std::wstringstream wss;
+		wss << wndTitle;
+		if (Profiler::Get().IsEnabled()) wss << L" | profiling";
+		if (pRenderer->IsArchivingViews()) wss << L" | archiving views";
+		if (bRecordingCameraPath) wss << L" | camera path: " << cameraPath.GetSamples().size() << L" samples";
+		const Recorder::Stats stats = pRenderer->GetRecordingStats();
+		if (pRenderer->IsRecording() || stats.nWritten > 0u) {
+			wss << (pRenderer->IsRecording() ? L" | recording: " : L" | recorded: ") << std::fixed << std::setprecision(1)
+				<< stats.nWritten << L" frames, " << stats.GetThroughput() << L" MiB/s, "
+				<< stats.nDropped << L" dropped, " << stats.nQueued << L"/" << stats.nSlots << L" queued";
+		}
+		SetWindowTextW(hWnd, wss.str().c_str());
+	}
 	void HandleCameraMovement()
 	{
 		const float deltaTime = Time::Get().deltaTime;
@@ -173,7 +230,8 @@ private:
 
 		// camera rotation
 		constexpr float rotationSpeed = .0025f;
-		camTransform.SetRotationEuler(input.GetMousePosY() * rotationSpeed, input.GetMousePosX() * rotationSpeed, .0f);
+		const float pitch = input.GetMousePosY() * rotationSpeed, yaw = input.GetMousePosX() * rotationSpeed;
+		camTransform.SetRotationEuler(pitch, yaw, .0f);
 
 		// movement
 		{
@@ -213,6 +271,17 @@ private:
 			}
 		}
 		cam.UpdatePos(pRenderer->GetDeviceContext());
+
+		if (!bRecordingCameraPath) return;
+		UINT keys = 0u;
+		const std::pair<unsigned char, CameraPath::Key> keyMap[] = {
+			{ 'W', CameraPath::eForward }, { 'S', CameraPath::eBack }, { 'A', CameraPath::eLeft }, { 'D', CameraPath::eRight },
+			{ 'Q', CameraPath::eDown }, { 'E', CameraPath::eUp }, { VK_SHIFT, CameraPath::eFast }, { VK_CONTROL, CameraPath::eSlow }
+		};
+		for (const auto& [key, flag] : keyMap) if (input.IsKeyDown(key)) keys |= flag;
+		const DirectX::XMFLOAT3A position = camTransform.GetPosition();
+		cameraPath.Add({ deltaTime, { { position.x, position.y, position.z }, { pitch, yaw, 0.0f } },
+			static_cast<float>(input.GetMousePosX()), static_cast<float>(input.GetMousePosY()), keys });
 	}
 
 	std::pair<bool, int> ReadMessages()
@@ -367,7 +436,11 @@ private:
 	static constexpr int height = 720, width = 1280;
 	const HINSTANCE hInstance;
 	HWND hWnd;
+	float nextTitleUpdate = 0.0f;
+	CameraPath cameraPath;
+	bool bRecordingCameraPath = false;
 
 	std::unique_ptr<Renderer> pRenderer;
+	std::unique_ptr<SceneLoader> pSceneLoader;
 	Input input;
 };
\ No newline at end of file
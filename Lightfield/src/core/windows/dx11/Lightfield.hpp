@@ -10,23 +10,24 @@ public:
 	void Init(ID3D11Device* const pDevice, UINT width, UINT height)
 	{
 		InitTextures(pDevice, width, height);
-		InitDepthStencils(pDevice, width, height);
+		depthStencil.Init(pDevice, width, height, MemoryTag::eLightfield);
 		InitOffsets(pDevice);
 	}
 	void Clear(ID3D11DeviceContext* const pDeviceContext)
 	{
 		static constexpr float clearColor[] = { 0.0f, 0.0f, 0.0f, 0.0f };
-		for (UINT i = 0u; i < nCams; i++) {
-			pDeviceContext->ClearRenderTargetView(rtvArr[i].Get(), clearColor);
-			pDeviceContext->ClearRenderTargetView(simDepthArr[i].GetRTV(), clearColor);
-			depthStencilArr[i].ClearDepthStencil(pDeviceContext);
-		}
+		for (UINT i = 0u; i < nCams; i++) pDeviceContext->ClearRenderTargetView(rtvArr[i].Get(), clearColor);
 	}
-	void Simulate(ID3D11DeviceContext* const pDeviceContext, std::vector<std::unique_ptr<RenderObject>>& renderObjects)
+	// simulated depths are owned by the frame graph, a null target skips that view's depth output
+	void Simulate(ID3D11DeviceContext* const pDeviceContext, std::vector<std::unique_ptr<RenderObject>>& renderObjects, const std::array<ID3D11RenderTargetView*, CameraGrid::nViews>& simDepthRTVs)
 	{
+		static constexpr float clearColor[] = { 0.0f, 0.0f, 0.0f, 0.0f };
 		for (UINT i = 0u; i < nCams; i++) {
-			ID3D11RenderTargetView* rtvs[2] = { rtvArr[i].Get(), simDepthArr[i].GetRTV() };
-			pDeviceContext->OMSetRenderTargets(2u, rtvs, depthStencilArr[i].GetView());
+			// views render one after another, so they can all share a single depth stencil
+			depthStencil.ClearDepthStencil(pDeviceContext);
+			if (simDepthRTVs[i]) pDeviceContext->ClearRenderTargetView(simDepthRTVs[i], clearColor);
+			ID3D11RenderTargetView* rtvs[2] = { rtvArr[i].Get(), simDepthRTVs[i] };
+			pDeviceContext->OMSetRenderTargets(2u, rtvs, depthStencil.GetView());
 
 			// Bind offset
 			pDeviceContext->VSSetConstantBuffers(3u, 1u, offsetBufferArr[i].GetBufferAddress());
@@ -39,40 +40,16 @@ public:
 		}
 	}
 
-	// save gpu textures to disk in .jpg format
-	void Screenshot(ID3D11DeviceContext* const pDeviceContext)
+	// textures (and array slices) captured per recorded frame, one per view
+	void GetRecordedTextures(std::vector<std::pair<ID3D11Texture2D*, UINT>>& textures)
 	{
-		for (UINT i = 0u; i < nCams; i++) {
-
-			std::wstringstream wss;
-			wss << L"screenshots/simulated_depth_" << i << L".jpg";
-			simDepthArr[i].SaveTextureToFile(pDeviceContext, wss.str());
-		}
-
-		pDeviceContext->PSSetShaderResources(0u, 1u, pSrvArr.GetAddressOf());
-		pDeviceContext->PSSetConstantBuffers(0u, 1u, previewCamBuffer.GetBufferAddress());
-		pDeviceContext->OMSetRenderTargets(1u, screenshotBuffer.GetRTVAddress(), nullptr);
-		UINT iOrig = previewCamBuffer.GetData(); // save original index
-		for (UINT i = 0u; i < nCams; i++) {
-
-			// update index (using the already existing preview cam buffer for that purpose)
-			previewCamBuffer.Update(pDeviceContext, i);
-
-			// render current texture into screenshot buffer
-			static constexpr UINT zero = 0u;
-			pDeviceContext->IASetVertexBuffers(zero, zero, nullptr, &zero, &zero);
-			pDeviceContext->Draw(3u, zero);
-			
-			// then save screenshot buffer as .jpg
-			std::wstringstream wss;
-			wss << L"screenshots/simulated_color" << i << L".jpg";
-			screenshotBuffer.SaveTextureToFile(pDeviceContext, wss.str());
-		}
-
-		// reset back to original state
-		previewCamBuffer.Update(pDeviceContext, iOrig);
+		for (UINT i = 0u; i < nCams; i++) textures.emplace_back(pTexArr.Get(), i);
 	}
 
+	inline UINT GetViewCount() const { return nCams; }
+	inline ID3D11ShaderResourceView* GetColorSRV() { return pSrvArr.Get(); }
+	inline UINT GetPreviewCamera() { return previewCamBuffer.GetData(); }
+
 	void CyclePreviewCamera(ID3D11DeviceContext* const pDeviceContext)
 	{
 		UINT iCur = previewCamBuffer.GetData();
@@ -89,9 +66,9 @@ public:
 		pDeviceContext->PSSetShaderResources(0u, 1u, pSRVs);
 	}
 
-	void BindPreviewTextures(ID3D11DeviceContext* const pDeviceContext)
+	void BindPreviewTextures(ID3D11DeviceContext* const pDeviceContext, ID3D11ShaderResourceView* const pSimDepthSRV)
 	{
-		ID3D11ShaderResourceView* srvs[] = { pSrvArr.Get(), simDepthArr[previewCamBuffer.GetData()].GetSRV() };
+		ID3D11ShaderResourceView* srvs[] = { pSrvArr.Get(), pSimDepthSRV };
 		pDeviceContext->PSSetShaderResources(0u, 2u, srvs);
 		pDeviceContext->PSSetConstantBuffers(1u, 1u, previewCamBuffer.GetBufferAddress());
 	}
@@ -117,7 +94,9 @@ private:
 		texDesc.CPUAccessFlags = 0u;
 		texDesc.SampleDesc.Count = 1u;
 		texDesc.SampleDesc.Quality = 0u;
-		pDevice->CreateTexture2D(&texDesc, nullptr, pTexArr.GetAddressOf());
+		HRESULT hr = pDevice->CreateTexture2D(&texDesc, nullptr, pTexArr.GetAddressOf());
+		if (FAILED(hr)) throw std::runtime_error("Lightfield texture array creation failed");
+		texArrMemory.Track(MemoryTag::eLightfield, TexFormatConverter::GetTextureSize(texDesc));
 
 		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 		srvDesc.Format = texDesc.Format;
@@ -138,46 +117,14 @@ private:
 			rtvDesc.Texture2DArray.FirstArraySlice = D3D11CalcSubresource(0u, i, 1u);
 			pDevice->CreateRenderTargetView(pTexArr.Get(), &rtvDesc, rtvArr[i].GetAddressOf());
 		}
-
-		// simulated depths
-		texDesc.Format = DXGI_FORMAT_R16_UNORM;
-		texDesc.ArraySize = 1u;
-		srvDesc.Format = texDesc.Format;
-		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-		srvDesc.Texture2D.MipLevels = 1u;
-		srvDesc.Texture2D.MostDetailedMip = 0u;
-		rtvDesc.Format = texDesc.Format;
-		rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-		rtvDesc.Texture2D.MipSlice = 0u;
-		for (UINT i = 0u; i < nCams; i++) {
-			simDepthArr[i].CreateTexture(pDevice, texDesc);
-			simDepthArr[i].CreateRTV(pDevice, rtvDesc);
-			simDepthArr[i].CreateSRV(pDevice, srvDesc);
-		}
-
-		// screenshot buffer
-		texDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
-		srvDesc.Format = texDesc.Format;
-		rtvDesc.Format = texDesc.Format;
-		screenshotBuffer.CreateTexture(pDevice, texDesc);
-		screenshotBuffer.CreateRTV(pDevice, rtvDesc);
-		screenshotBuffer.CreateSRV(pDevice, srvDesc);
-
-	}
-	void InitDepthStencils(ID3D11Device* const pDevice, UINT width, UINT height)
-	{
-		for (UINT i = 0u; i < nCams; i++) {
-			depthStencilArr[i].Init(pDevice, width, height);
-		}
 	}
 	void InitOffsets(ID3D11Device* const pDevice)
 	{
-		UINT bufferIndex = iInitialCam;
-		for (int x = -camLoopLim; x <= camLoopLim; x++) {
-			for (int y = -camLoopLim; y <= camLoopLim; y++) {
-				offsetBufferArr[bufferIndex].GetData() = DirectX::XMFLOAT3A(offset * static_cast<float>(x), offset *- static_cast<float>(y), 0.0f); // invert y to match texture coord grid
-				offsetBufferArr[bufferIndex++].Init(pDevice);
-			}
+		for (UINT i = 0u; i < nCams; i++) {
+			float x, y;
+			CameraGrid::GetOffset(i, x, y);
+			offsetBufferArr[i].GetData() = DirectX::XMFLOAT3A(x, y, 0.0f);
+			offsetBufferArr[i].Init(pDevice);
 		}
 
 		previewCamBuffer.GetData() = 0u;
@@ -185,23 +132,13 @@ private:
 	}
 
 private:
-	static constexpr float offset = .01f; // distance to center camera
-	static constexpr int camLoopLim = 1;
-	static constexpr UINT nCams = 9u;
-	static constexpr UINT iInitialCam = 0u;
+	static constexpr UINT nCams = CameraGrid::nViews;
 	ConstantBuffer<UINT> previewCamBuffer;
 
 	Microsoft::WRL::ComPtr<ID3D11Texture2D> pTexArr;
+	TrackedMemory texArrMemory;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> pSrvArr;
 	std::array<Microsoft::WRL::ComPtr<ID3D11RenderTargetView>, nCams> rtvArr;
 	std::array<ConstantBuffer<DirectX::XMFLOAT3A>, nCams> offsetBufferArr;
-	std::array<DepthStencil, nCams> depthStencilArr; // only really need one in reality?
-
-	// for screenshots
-	std::array<Texture2D, nCams> simDepthArr;
-	Texture2D screenshotBuffer;
-
-	std::array<Microsoft::WRL::ComPtr<ID3D11RenderTargetView>, nCams> depthRtvArr;
-	std::array<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>, nCams> depthSrvArr;
-	std::array<Microsoft::WRL::ComPtr<ID3D11Texture2D>, nCams> depthTexArr;
+	DepthStencil depthStencil;
 };
\ No newline at end of file
@@ -4,16 +4,21 @@
 #include "wrappers/DepthStencil.hpp"
 #include "wrappers/Shader.hpp"
 #include "wrappers/Texture.hpp"
+#include "wrappers/TextureCache.hpp"
+#include "wrappers/StagingTexture.hpp"
 #include "objects/Camera.hpp"
 #include "objects/RenderObject.hpp"
+#include "objects/SceneLoader.hpp"
+#include "pipeline/PipelineBackend.hpp"
 #include "Lightfield.hpp"
 
-class Renderer
+// direct3d 11 backend, also owns the window's swapchain and presents the results
+class Renderer : public PipelineBackend
 {
 public:
 	enum class PresentationMode : UINT; // forward declare
 public:
-	Renderer(HWND hWnd, UINT width, UINT height)
+	Renderer(HWND hWnd, UINT width, UINT height) : frameGraph(CreateFrameGraphAllocator())
 	{
 		this->width = static_cast<UINT>(width);
 		this->height = static_cast<UINT>(height);
@@ -25,61 +30,40 @@ public:
 		CreateRasterizer();
 		CreateDepthStencilStates();
 		CreateSamplerState();
-		CreateTextureBuffers();
 		CreateConstantBuffer();
 		
 		LoadShaders();
 
 		// create lightfield with different camera offsets and textures
 		lightfield.Init(pDevice.Get(), width, height);
+		fusedDepthCS.SetSRVs({ lightfield.GetColorSRV() });
+		epiDepthCS.SetSRVs({ lightfield.GetColorSRV() });
 
 		// create camera and move it back a bit to see all the objects
 		pCamera = std::make_unique<Camera>(pDevice.Get());
+
+		BuildFrameGraph();
 	}
 	ROF_DELETE(Renderer);
 
-	void SimulateScene()
+	// runs the frame graph, passes whose results nobody looks at this frame are skipped
+	void RenderFrame() override
 	{
-		Clear();
-
-		forwardVS.Bind(pDeviceContext.Get());
-		forwardPS.Bind(pDeviceContext.Get());
-
-		// Bind constant buffers (camera)
-		ID3D11Buffer* camVsBuffers[] = {
-			pCamera->GetTransform().GetInverseBuffer(pDeviceContext.Get()).GetBuffer(), // Camera's ViewMatrix
-			pCamera->GetProjectionBuffer().GetBuffer() // Camera's ProjectionMatrix
-		};
-		pDeviceContext->VSSetConstantBuffers(1u, 2u, camVsBuffers);
-		pDeviceContext->PSSetConstantBuffers(1u, 1u, pCamera->GetPosBuffer().GetBufferAddress());
-
-		// Set render target and depth stencil view for rendering
-		pDeviceContext->OMSetDepthStencilState(pDefaultDSS.Get(), 1u);
-
-		lightfield.Simulate(pDeviceContext.Get(), renderObjects);
-	}
-	void DeduceDepth()
-	{
-		oversizedTriangleVS.Bind(pDeviceContext.Get());
-		gradientsPS.Bind(pDeviceContext.Get());
-
-		// attach the non-depth DSS and set gradients as render target
-		pDeviceContext->OMSetDepthStencilState(pNoDepthDSS.Get(), 1u);
-		pDeviceContext->OMSetRenderTargets(1u, gradients.GetRTVAddress(), nullptr);
-
-		// read color buffers as input
-		lightfield.BindColorTextures(pDeviceContext.Get());
-		DrawOversizedTriangle();
-		lightfield.UnbindColorTextures(pDeviceContext.Get());
-
-		// finally, deduce depth from gradients
-		depthDeductionPS.Bind(pDeviceContext.Get());
-		pDeviceContext->OMSetRenderTargets(1u, outputDepth.GetRTVAddress(), nullptr);
-		pDeviceContext->PSSetShaderResources(0u, 1u, gradients.GetSRVAddress());
-		DrawOversizedTriangle();
+		PROFILE_SCOPE("Renderer::RenderFrame");
+		TaskScheduler::ScopedPriority priority(TaskScheduler::Priority::eInteractive); // cpu work of the preview goes ahead of loading
+		ScopedArena arena; // scratch of the frame is released all at once
+		const bool bCapture = std::exchange(bCaptureRequested, false);
+		UpdateFrameGraphOutputs(bCapture);
+		frameGraph.Execute();
+
+		// screenshots are read back nCaptureFramesInFlight - 1 frames after their copies were issued, like recorded frames
+		// a pending one is written right away if the next capture is about to overwrite its copies
+		if (nCaptureFramesPending > 0u && (--nCaptureFramesPending == 0u || bCapture)) WriteCapturedFrame();
+		if (bCapture) CopyCapture();
 	}
 	void Present()
 	{
+		PROFILE_SCOPE("Renderer::Present");
 		oversizedTriangleVS.Bind(pDeviceContext.Get());
 		presentationPS.Bind(pDeviceContext.Get());
 
@@ -90,9 +74,12 @@ public:
 		// presentation mode via cbuffer
 		pDeviceContext->PSSetConstantBuffers(0u, 1u, presentationModeBuffer.GetBufferAddress());
 
-		// set shader resources
-		lightfield.BindPreviewTextures(pDeviceContext.Get()); // preview simulated color and depth textures
-		pDeviceContext->PSSetShaderResources(2u, 1u, outputDepth.GetSRVAddress()); // output depth texture
+		// set shader resources, targets culled this frame stay unbound
+		Texture2D* pSimDepth = frameGraph.Get(simDepthArr[lightfield.GetPreviewCamera()]);
+		Texture2D* pOutputDepth = frameGraph.Get(outputDepth);
+		lightfield.BindPreviewTextures(pDeviceContext.Get(), pSimDepth ? pSimDepth->GetSRV() : nullptr); // preview simulated color and depth textures
+		ID3D11ShaderResourceView* const pOutputDepthSRV = pOutputDepth ? pOutputDepth->GetSRV() : nullptr;
+		pDeviceContext->PSSetShaderResources(2u, 1u, &pOutputDepthSRV); // output depth texture
 
 		DrawOversizedTriangle();
 
@@ -107,35 +94,140 @@ public:
 		pDeviceContext->PSSetShaderResources(0u, 3u, pSRVsNull);
 	}
 
-	// save gpu textures to disk in .jpg format
+	UINT GetViewCount() const override { return lightfield.GetViewCount(); }
+	// reads the copies of the last captured frame, views first, then their simulated depths and the output depth
+	Image Capture(CaptureTarget target, UINT iView = 0u) override
+	{
+		if (captureStaging.empty()) throw std::runtime_error("No frame was captured yet, request the capture before rendering");
+		const UINT nViews = lightfield.GetViewCount();
+		const size_t iStaging = target == CaptureTarget::eColor ? iView : target == CaptureTarget::eSimulatedDepth ? nViews + iView : 2u * nViews;
+		Image image;
+		captureStaging[iStaging].Read(pDeviceContext.Get(), image);
+		return image;
+	}
+
+	// capture of the next frame, copied on the gpu and handed to the background image writer a few frames later
 	void Screenshot()
 	{
 		// create directory if it doesnt already exist
-		std::wstringstream wss;
-		wss << std::filesystem::current_path().c_str() << L"/screenshots";
-		std::filesystem::path path = wss.str();
-		if (!std::filesystem::exists(path)) std::filesystem::create_directory(path);
-
-		outputDepth.SaveTextureToFile(pDeviceContext.Get(), L"screenshots/outputDepth.jpg");
+		std::filesystem::create_directory(std::filesystem::current_path() / L"screenshots");
+		RequestCapture();
+	}
+	// mesh of the next frame's output depth, exported alongside its screenshot
+	void ExportMesh()
+	{
+		bGeometryRequested = true;
+		Screenshot();
+	}
+	// continuous capture of all views, their simulated depths and the output depth into a sequence file
+	void ToggleRecording()
+	{
+		if (recorder.IsRecording()) {
+			FlushRecording();
+			recorder.Stop();
+			return;
+		}
+
+		std::filesystem::create_directory(std::filesystem::current_path() / L"recordings");
+		recordedTextures.clear();
+		lightfield.GetRecordedTextures(recordedTextures);
+
+		// sim and output depths only exist while the graph runs, their layout comes from the graph
+		std::vector<Image> layout;
+		for (auto& texture : recordedTextures) layout.push_back(StagingTexture::GetLayout(texture.first));
+		std::vector<FrameGraph<Texture2D>::ResourceHandle> graphTextures(simDepthArr.begin(), simDepthArr.end());
+		graphTextures.push_back(outputDepth);
+		for (auto handle : graphTextures) {
+			const TransientDesc& desc = frameGraph.GetDesc(handle);
+			Image image;
+			image.width = desc.width;
+			image.height = desc.height;
+			image.format = StagingTexture::GetImageFormat(static_cast<DXGI_FORMAT>(desc.format));
+			layout.push_back(image);
+		}
+		for (auto& staging : recordStaging) {
+			if (staging.size() != layout.size()) staging = std::vector<StagingTexture>(layout.size());
+		}
 
-		// render textures into a screenshot buffer for processing
-		oversizedTriangleVS.Bind(pDeviceContext.Get());
-		simpleWritePS.Bind(pDeviceContext.Get());
-		lightfield.Screenshot(pDeviceContext.Get());
+		std::wstringstream wss;
+		wss << L"recordings/sequence_" << std::time(nullptr) << L".lfseq";
+		recorder.Start(wss.str(), layout);
+		iRecordFrame = 0u;
+	}
+	void Record()
+	{
+		if (!recorder.IsRecording()) return;
+		PROFILE_SCOPE("Renderer::Record");
+
+		// read back the copies issued a few frames ago instead of stalling on this frame's
+		if (iRecordFrame + 1u >= nRecordFramesInFlight) ReadRecordedFrame((iRecordFrame + 1u) % nRecordFramesInFlight);
+
+		// transients may move between frames, so they are looked up anew each time
+		recordedTextures.resize(lightfield.GetViewCount());
+		for (auto handle : simDepthArr) recordedTextures.emplace_back(frameGraph.Get(handle)->GetTex(), 0u);
+		recordedTextures.emplace_back(frameGraph.Get(outputDepth)->GetTex(), 0u);
+
+		auto& staging = recordStaging[iRecordFrame % nRecordFramesInFlight];
+		for (size_t i = 0u; i < recordedTextures.size(); i++) {
+			staging[i].Copy(pDeviceContext.Get(), recordedTextures[i].first, recordedTextures[i].second);
+		}
+		iRecordFrame++;
 	}
+	inline bool IsRecording() const { return recorder.IsRecording(); }
+	inline bool IsArchivingViews() const { return captureFormats.bArchiveViews; }
+	inline Recorder::Stats GetRecordingStats() { return recorder.GetStats(); }
+
 	void CyclePreviewCam()
 	{
 		lightfield.CyclePreviewCamera(pDeviceContext.Get());
 	}
 
+	// fused depth never writes the gradients to memory, the separate passes are kept around for comparison
+	void ToggleFusedDepth()
+	{
+		bFusedDepth = !bFusedDepth;
+		UpdateDepthPasses();
+	}
+	// structure tensors of epipolar plane images instead of the 4d gradients
+	void ToggleEpiDepth()
+	{
+		bEpiDepth = !bEpiDepth;
+		UpdateDepthPasses();
+	}
+	// cycles through full, half and quarter resolution depth, reduced depth is upsampled guided by the center view
+	// the separate gradient passes always run at full resolution
+	void CycleDepthScale()
+	{
+		SetDepthScale(depthScale == 4u ? 1u : depthScale * 2u);
+	}
+	void SetDepthScale(UINT factor)
+	{
+		if (factor != 1u && factor != 2u && factor != 4u) throw std::runtime_error("Depth scale has to be 1, 2 or 4");
+		depthScale = factor;
+		depthScaleBuffer.Update(pDeviceContext.Get(), depthScale);
+		ResizeReduced();
+		UpdateDepthPasses();
+	}
+	// screenshots put all views into one lightfield archive instead of an image each, loaded again by lightfield_headless --load-archive
+	void ToggleViewArchive()
+	{
+		captureFormats.bArchiveViews = !captureFormats.bArchiveViews;
+	}
+	// guided filter on the deduced depth, the center view is the guide and the confidence the weight
+	void ToggleDepthRefinement()
+	{
+		frameGraph.SetPassEnabled(refinementPass, !frameGraph.IsEnabled(refinementPass));
+	}
 	void SetPresentationMode(PresentationMode presentationMode)
 	{
+		this->presentationMode = presentationMode;
 		presentationModeBuffer.Update(pDeviceContext.Get(), presentationMode);
 	}
 	Camera& GetCamera() { return *pCamera; }
 	std::vector<std::unique_ptr<RenderObject>>& GetRenderObjects() { return renderObjects; }
 	ID3D11Device* GetDevice() { return pDevice.Get(); }
 	ID3D11DeviceContext* GetDeviceContext() { return pDeviceContext.Get(); }
+	FrameGraph<Texture2D>& GetFrameGraph() { return frameGraph; }
 
 private:
 	// Pipeline macros
@@ -144,9 +236,367 @@ private:
 		// clear textures from previous render/simulation
 		static constexpr float clearColor[] = { 0.0f, 0.0f, 0.0f, 0.0f };
 		pDeviceContext->ClearRenderTargetView(backBuffer.GetRTV(), clearColor);
-		pDeviceContext->ClearRenderTargetView(outputDepth.GetRTV(), clearColor); // TODO: only really need to write one channel?
 		lightfield.Clear(pDeviceContext.Get());
 	}
+
+	// Frame graph
+	void BuildFrameGraph()
+	{
+		TransientDesc desc;
+		desc.width = width;
+		desc.height = height;
+
+		// the view array stays with the lightfield, presentation always reads it
+		views = frameGraph.Import("views");
+		frameGraph.SetOutput(views, true);
+		std::vector<FrameGraph<Texture2D>::ResourceHandle> simulated = { views };
+		desc.format = DXGI_FORMAT_R16_UNORM;
+		for (UINT i = 0u; i < simDepthArr.size(); i++) {
+			simDepthArr[i] = frameGraph.CreateTransient("simDepth" + std::to_string(i), desc);
+			simulated.push_back(simDepthArr[i]);
+		}
+		// each channel should contain a lightfield derivative, 4 in total per pixel
+		desc.format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		gradients = frameGraph.CreateTransient("gradients", desc);
+		// output depth texture should just be single channel 16bit float
+		desc.format = DXGI_FORMAT_R16_FLOAT;
+		outputDepth = frameGraph.CreateTransient("outputDepth", desc);
+		confidence = frameGraph.CreateTransient("confidence", desc); // only allocated while the refinement runs
+		// reduced resolution depth, sized by ResizeReduced
+		reducedViews = frameGraph.CreateTransient("reducedViews", desc);
+		reducedDepth = frameGraph.CreateTransient("reducedDepth", desc);
+		reducedConfidence = frameGraph.CreateTransient("reducedConfidence", desc);
+		ResizeReduced();
+		// guided filter moments and their box sums, 14 channels over 4 slices
+		desc.format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+		desc.arraySize = nGuidedSlices;
+		guidedSums = frameGraph.CreateTransient("guidedSums", desc);
+		guidedScratch = frameGraph.CreateTransient("guidedScratch", desc);
+
+		frameGraph.AddPass("Simulate", {}, simulated, [this] { Simulate(); });
+		downsamplePass = frameGraph.AddPass("DownsampleViews", { views }, { reducedViews }, [this] { DownsampleViews(); });
+		gradientsPass = frameGraph.AddPass("Gradients", { views }, { gradients }, [this] { ComputeGradients(); });
+		depthDeductionPass = frameGraph.AddPass("DepthDeduction", { gradients }, { outputDepth, confidence }, [this] { DeduceDepth(); });
+		// full resolution variant of each compute engine, and one on the reduced views for the upsampling
+		for (UINT i = 0u; i < 2u; i++) {
+			const bool bReduced = i == 1u;
+			const std::vector<FrameGraph<Texture2D>::ResourceHandle> reads = { bReduced ? reducedViews : views };
+			const std::vector<FrameGraph<Texture2D>::ResourceHandle> writes = { bReduced ? reducedDepth : outputDepth, bReduced ? reducedConfidence : confidence };
+			const std::string suffix = bReduced ? "Reduced" : "";
+			fusedDepthPasses[i] = frameGraph.AddPass("FusedDepth" + suffix, reads, writes, [this, bReduced] { DeduceDepthFused(bReduced); });
+			epiDepthPasses[i] = frameGraph.AddPass("EpiDepth" + suffix, reads, writes, [this, bReduced] { DeduceDepthEpi(bReduced); });
+		}
+		upsamplePass = frameGraph.AddPass("UpsampleDepth", { views, reducedViews, reducedDepth, reducedConfidence }, { outputDepth, confidence }, [this] { UpsampleDepth(); });
+		// the guided filter textures are scratch of this pass alone, so they show up on both sides
+		refinementPass = frameGraph.AddPass("DepthRefinement", { views, outputDepth, confidence, guidedSums, guidedScratch }, { outputDepth, guidedSums, guidedScratch }, [this] { RefineDepth(); });
+		UpdateDepthPasses();
+	}
+	void ResizeReduced()
+	{
+		TransientDesc desc;
+		desc.width = (width + depthScale - 1u) / depthScale;
+		desc.height = (height + depthScale - 1u) / depthScale;
+		desc.format = DXGI_FORMAT_R16_FLOAT;
+		frameGraph.SetDesc(reducedDepth, desc);
+		frameGraph.SetDesc(reducedConfidence, desc);
+		// the views are written through a uav, which bgra formats do not support everywhere
+		desc.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		desc.arraySize = lightfield.GetViewCount();
+		frameGraph.SetDesc(reducedViews, desc);
+	}
+	void UpdateDepthPasses()
+	{
+		const bool bReduced = depthScale > 1u && (bEpiDepth || bFusedDepth);
+		for (UINT i = 0u; i < 2u; i++) {
+			const bool bResolution = (i == 1u) == bReduced;
+			frameGraph.SetPassEnabled(epiDepthPasses[i], bResolution && bEpiDepth);
+			frameGraph.SetPassEnabled(fusedDepthPasses[i], bResolution && !bEpiDepth && bFusedDepth);
+		}
+		frameGraph.SetPassEnabled(gradientsPass, !bEpiDepth && !bFusedDepth);
+		frameGraph.SetPassEnabled(depthDeductionPass, !bEpiDepth && !bFusedDepth);
+		frameGraph.SetPassEnabled(downsamplePass, bReduced);
+		frameGraph.SetPassEnabled(upsamplePass, bReduced);
+	}
+	// outputs are whatever presentation, recording and capture read after the graph ran
+	void UpdateFrameGraphOutputs(bool bCapture)
+	{
+		const bool bAll = bCapture || recorder.IsRecording();
+		const UINT iPreview = lightfield.GetPreviewCamera();
+		for (UINT i = 0u; i < simDepthArr.size(); i++) {
+			frameGraph.SetOutput(simDepthArr[i], bAll || (presentationMode == PresentationMode::eSimulatedDepth && i == iPreview));
+		}
+		frameGraph.SetOutput(outputDepth, bAll || presentationMode == PresentationMode::eOutputDepth);
+	}
+	FrameGraph<Texture2D>::Allocator CreateFrameGraphAllocator()
+	{
+		// d3d11 has no placed resources, so transients only share textures with identical descs (the default)
+		FrameGraph<Texture2D>::Allocator allocator;
+		allocator.getSize = [](const TransientDesc& desc) { return TexFormatConverter::GetTextureSize(GetTextureDesc(desc)); };
+		allocator.create = [this](const TransientDesc& desc) {
+			const D3D11_TEXTURE2D_DESC texDesc = GetTextureDesc(desc);
+
+			// arrays get array views over all of their slices
+			const bool bArray = desc.arraySize > 1u;
+			D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = {};
+			rtvDesc.Format = texDesc.Format;
+			rtvDesc.ViewDimension = bArray ? D3D11_RTV_DIMENSION_TEXTURE2DARRAY : D3D11_RTV_DIMENSION_TEXTURE2D;
+			if (bArray) rtvDesc.Texture2DArray.ArraySize = desc.arraySize;
+
+			D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+			srvDesc.Format = texDesc.Format;
+			srvDesc.ViewDimension = bArray ? D3D11_SRV_DIMENSION_TEXTURE2DARRAY : D3D11_SRV_DIMENSION_TEXTURE2D;
+			if (bArray) {
+				srvDesc.Texture2DArray.MipLevels = 1u;
+				srvDesc.Texture2DArray.ArraySize = desc.arraySize;
+			}
+			else srvDesc.Texture2D.MipLevels = 1u;
+
+			D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+			uavDesc.Format = texDesc.Format;
+			uavDesc.ViewDimension = bArray ? D3D11_UAV_DIMENSION_TEXTURE2DARRAY : D3D11_UAV_DIMENSION_TEXTURE2D;
+			if (bArray) uavDesc.Texture2DArray.ArraySize = desc.arraySize;
+
+			auto pTexture = std::make_unique<Texture2D>();
+			pTexture->CreateTexture(pDevice.Get(), texDesc, nullptr, MemoryTag::eRenderTargets);
+			pTexture->CreateRTV(pDevice.Get(), rtvDesc);
+			pTexture->CreateSRV(pDevice.Get(), srvDesc);
+			pTexture->CreateUAV(pDevice.Get(), uavDesc);
+			return pTexture;
+		};
+		return allocator;
+	}
+	static D3D11_TEXTURE2D_DESC GetTextureDesc(const TransientDesc& desc)
+	{
+		D3D11_TEXTURE2D_DESC texDesc = {};
+		texDesc.Format = static_cast<DXGI_FORMAT>(desc.format);
+		texDesc.Width = desc.width;
+		texDesc.Height = desc.height;
+		texDesc.MipLevels = 1u;
+		texDesc.ArraySize = desc.arraySize;
+		texDesc.Usage = D3D11_USAGE_DEFAULT;
+		texDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS; // compute passes write through uavs
+		texDesc.CPUAccessFlags = 0u;
+		texDesc.SampleDesc.Count = 1u;
+		texDesc.SampleDesc.Quality = 0u;
+		return texDesc;
+	}
+
+	// Frame graph passes
+	void Simulate()
+	{
+		PROFILE_SCOPE("Renderer::Simulate");
+		TransformSystem::Get().Update(); // all transforms moved this frame, in one pass
+		Clear();
+
+		forwardVS.Bind(pDeviceContext.Get());
+		forwardPS.Bind(pDeviceContext.Get());
+
+		// Bind constant buffers (camera)
+		ID3D11Buffer* camVsBuffers[] = {
+			pCamera->GetViewBuffer(pDeviceContext.Get()).GetBuffer(), // Camera's ViewMatrix
+			pCamera->GetProjectionBuffer().GetBuffer() // Camera's ProjectionMatrix
+		};
+		pDeviceContext->VSSetConstantBuffers(1u, 2u, camVsBuffers);
+		pDeviceContext->PSSetConstantBuffers(1u, 1u, pCamera->GetPosBuffer().GetBufferAddress());
+
+		// Set render target and depth stencil view for rendering
+		pDeviceContext->OMSetDepthStencilState(pDefaultDSS.Get(), 1u);
+
+		// sim depths nobody reads this frame are not rendered
+		std::array<ID3D11RenderTargetView*, CameraGrid::nViews> simDepthRTVs;
+		for (UINT i = 0u; i < simDepthArr.size(); i++) {
+			Texture2D* pSimDepth = frameGraph.Get(simDepthArr[i]);
+			simDepthRTVs[i] = pSimDepth ? pSimDepth->GetRTV() : nullptr;
+		}
+		lightfield.Simulate(pDeviceContext.Get(), renderObjects, simDepthRTVs);
+	}
+	void ComputeGradients()
+	{
+		PROFILE_SCOPE("Renderer::ComputeGradients");
+		oversizedTriangleVS.Bind(pDeviceContext.Get());
+		gradientsPS.Bind(pDeviceContext.Get());
+
+		// attach the non-depth DSS and set gradients as render target
+		pDeviceContext->OMSetDepthStencilState(pNoDepthDSS.Get(), 1u);
+		pDeviceContext->OMSetRenderTargets(1u, frameGraph.Get(gradients)->GetRTVAddress(), nullptr);
+
+		// read color buffers as input
+		lightfield.BindColorTextures(pDeviceContext.Get());
+		DrawOversizedTriangle();
+		lightfield.UnbindColorTextures(pDeviceContext.Get());
+	}
+	void DeduceDepth()
+	{
+		PROFILE_SCOPE("Renderer::DeduceDepth");
+		// finally, deduce depth from gradients
+		oversizedTriangleVS.Bind(pDeviceContext.Get());
+		depthDeductionPS.Bind(pDeviceContext.Get());
+		pDeviceContext->OMSetDepthStencilState(pNoDepthDSS.Get(), 1u);
+		Texture2D* pConfidence = frameGraph.Get(confidence);
+		ID3D11RenderTargetView* const rtvs[] = { frameGraph.Get(outputDepth)->GetRTV(), pConfidence ? pConfidence->GetRTV() : nullptr };
+		pDeviceContext->OMSetRenderTargets(2u, rtvs, nullptr);
+		pDeviceContext->PSSetShaderResources(0u, 1u, frameGraph.Get(gradients)->GetSRVAddress());
+		DrawOversizedTriangle();
+
+		// gradients may be aliased by a later pass
+		ID3D11ShaderResourceView* const pNullSRV = nullptr;
+		pDeviceContext->PSSetShaderResources(0u, 1u, &pNullSRV);
+	}
+	void DeduceDepthFused(bool bReduced)
+	{
+		PROFILE_SCOPE("Renderer::DeduceDepthFused");
+		DispatchDepth(fusedDepthCS, bReduced);
+	}
+	void DeduceDepthEpi(bool bReduced)
+	{
+		PROFILE_SCOPE("Renderer::DeduceDepthEpi");
+		DispatchDepth(epiDepthCS, bReduced);
+	}
+	// both depth compute shaders read the view array and write depth and confidence in 16x16 tiles
+	// reduced passes swap in the reduced views and targets, the shaders take their size from the views
+	void DispatchDepth(const Shader<ID3D11ComputeShader>& shader, bool bReduced)
+	{
+		// the views may still be bound as render targets from the simulation
+		pDeviceContext->OMSetRenderTargets(0u, nullptr, nullptr);
+		shader.Bind(pDeviceContext.Get());
+		if (bReduced) pDeviceContext->CSSetShaderResources(0u, 1u, frameGraph.Get(reducedViews)->GetSRVAddress());
+		const FrameGraph<Texture2D>::ResourceHandle depth = bReduced ? reducedDepth : outputDepth;
+		Texture2D* pConfidence = frameGraph.Get(bReduced ? reducedConfidence : confidence);
+		ID3D11UnorderedAccessView* const uavs[] = { frameGraph.Get(depth)->GetUAV(), pConfidence ? pConfidence->GetUAV() : nullptr };
+		pDeviceContext->CSSetUnorderedAccessViews(0u, 2u, uavs, nullptr);
+
+		// one group per 16x16 tile, has to match the shaders' TILE
+		static constexpr UINT tileSize = 16u;
+		const TransientDesc& desc = frameGraph.GetDesc(depth);
+		pDeviceContext->Dispatch((desc.width + tileSize - 1u) / tileSize, (desc.height + tileSize - 1u) / tileSize, 1u);
+
+		// output depth is read as an srv afterwards
+		ID3D11UnorderedAccessView* const pNullUAVs[] = { nullptr, nullptr };
+		pDeviceContext->CSSetUnorderedAccessViews(0u, 2u, pNullUAVs, nullptr);
+		shader.Unbind(pDeviceContext.Get());
+	}
+	void DownsampleViews()
+	{
+		PROFILE_SCOPE("Renderer::DownsampleViews");
+		pDeviceContext->OMSetRenderTargets(0u, nullptr, nullptr);
+		pDeviceContext->CSSetConstantBuffers(0u, 1u, depthScaleBuffer.GetBufferAddress());
+		const TransientDesc& desc = frameGraph.GetDesc(reducedViews);
+		ID3D11ShaderResourceView* const srvs[] = { lightfield.GetColorSRV() };
+		DispatchCompute(downsampleViewsCS, srvs, frameGraph.Get(reducedViews)->GetUAV(), (desc.width + 7u) / 8u, (desc.height + 7u) / 8u);
+	}
+	// joint bilateral upsampling, same as the cpu DepthUpsampler
+	void UpsampleDepth()
+	{
+		PROFILE_SCOPE("Renderer::UpsampleDepth");
+		jointBilateralUpsampleCS.Bind(pDeviceContext.Get());
+		pDeviceContext->CSSetConstantBuffers(0u, 1u, depthScaleBuffer.GetBufferAddress());
+		ID3D11ShaderResourceView* const srvs[] = {
+			lightfield.GetColorSRV(), frameGraph.Get(reducedViews)->GetSRV(), frameGraph.Get(reducedDepth)->GetSRV(), frameGraph.Get(reducedConfidence)->GetSRV()
+		};
+		pDeviceContext->CSSetShaderResources(0u, 4u, srvs);
+		Texture2D* pConfidence = frameGraph.Get(confidence);
+		ID3D11UnorderedAccessView* const uavs[] = { frameGraph.Get(outputDepth)->GetUAV(), pConfidence ? pConfidence->GetUAV() : nullptr };
+		pDeviceContext->CSSetUnorderedAccessViews(0u, 2u, uavs, nullptr);
+		pDeviceContext->Dispatch((width + 15u) / 16u, (height + 15u) / 16u, 1u);
+
+		ID3D11ShaderResourceView* const pNullSRVs[4] = {};
+		ID3D11UnorderedAccessView* const pNullUAVs[2] = {};
+		pDeviceContext->CSSetShaderResources(0u, 4u, pNullSRVs);
+		pDeviceContext->CSSetUnorderedAccessViews(0u, 2u, pNullUAVs, nullptr);
+		jointBilateralUpsampleCS.Unbind(pDeviceContext.Get());
+	}
+	// weighted guided filter, same as the cpu GuidedFilter
+	// moments go into guidedSums, their box sums become the coefficients in guidedScratch, whose box sums are applied to the guide
+	void RefineDepth()
+	{
+		PROFILE_SCOPE("Renderer::RefineDepth");
+		Texture2D& sums = *frameGraph.Get(guidedSums);
+		Texture2D& scratch = *frameGraph.Get(guidedScratch);
+		Texture2D& depth = *frameGraph.Get(outputDepth);
+		pDeviceContext->OMSetRenderTargets(0u, nullptr, nullptr);
+		pDeviceContext->CSSetConstantBuffers(0u, 1u, guidedFilterBuffer.GetBufferAddress());
+		const UINT nGroupsX = (width + 15u) / 16u, nGroupsY = (height + 15u) / 16u;
+
+		UpdateGuidedFilterBuffer(false, nGuidedSlices);
+		ID3D11ShaderResourceView* const momentSRVs[] = { lightfield.GetColorSRV(), depth.GetSRV(), frameGraph.Get(confidence)->GetSRV() };
+		DispatchCompute(guidedMomentsCS, momentSRVs, sums.GetUAV(), nGroupsX, nGroupsY);
+		BoxFilter(sums, scratch, nGuidedSlices);
+
+		ID3D11ShaderResourceView* const coefficientSRVs[] = { sums.GetSRV() };
+		DispatchCompute(guidedCoefficientsCS, coefficientSRVs, scratch.GetUAV(), nGroupsX, nGroupsY);
+		BoxFilter(scratch, sums, 1u);
+
+		ID3D11ShaderResourceView* const applySRVs[] = { lightfield.GetColorSRV(), scratch.GetSRV() };
+		DispatchCompute(guidedApplyCS, applySRVs, depth.GetUAV(), nGroupsX, nGroupsY);
+	}
+	// box sums over the first slices of a texture array, horizontal into the scratch and vertical back
+	void BoxFilter(Texture2D& texture, Texture2D& scratch, UINT nSlices)
+	{
+		static constexpr UINT nLinesPerGroup = 64u; // has to match the shader's thread group
+		UpdateGuidedFilterBuffer(false, nSlices);
+		ID3D11ShaderResourceView* const horizontalSRVs[] = { texture.GetSRV() };
+		DispatchCompute(guidedBoxCS, horizontalSRVs, scratch.GetUAV(), (height + nLinesPerGroup - 1u) / nLinesPerGroup, nSlices);
+
+		UpdateGuidedFilterBuffer(true, nSlices);
+		ID3D11ShaderResourceView* const verticalSRVs[] = { scratch.GetSRV() };
+		DispatchCompute(guidedBoxCS, verticalSRVs, texture.GetUAV(), (width + nLinesPerGroup - 1u) / nLinesPerGroup, nSlices);
+	}
+	void UpdateGuidedFilterBuffer(bool bVertical, UINT nSlices)
+	{
+		GuidedFilterParams& params = guidedFilterBuffer.GetData();
+		params.bVertical = bVertical ? 1u : 0u;
+		params.nSlices = nSlices;
+		guidedFilterBuffer.Update(pDeviceContext.Get());
+	}
+	// the same texture is an srv in one dispatch and a uav in the next, so everything is unbound again right away
+	template<size_t nSRVs>
+	void DispatchCompute(const Shader<ID3D11ComputeShader>& shader, ID3D11ShaderResourceView* const (&srvs)[nSRVs], ID3D11UnorderedAccessView* pUAV, UINT nGroupsX, UINT nGroupsY)
+	{
+		shader.Bind(pDeviceContext.Get());
+		pDeviceContext->CSSetShaderResources(0u, static_cast<UINT>(nSRVs), srvs);
+		pDeviceContext->CSSetUnorderedAccessViews(0u, 1u, &pUAV, nullptr);
+		pDeviceContext->Dispatch(nGroupsX, nGroupsY, 1u);
+
+		ID3D11ShaderResourceView* const pNullSRVs[nSRVs] = {};
+		ID3D11UnorderedAccessView* const pNullUAV = nullptr;
+		pDeviceContext->CSSetShaderResources(0u, static_cast<UINT>(nSRVs), pNullSRVs);
+		pDeviceContext->CSSetUnorderedAccessViews(0u, 1u, &pNullUAV, nullptr);
+	}
+	void ReadRecordedFrame(UINT iStaging)
+	{
+		Recorder::Frame* pFrame = recorder.Acquire();
+		if (!pFrame) return; // dropped, the staging copies simply get overwritten
+
+		auto& staging = recordStaging[iStaging];
+		for (size_t i = 0u; i < staging.size(); i++) staging[i].Read(pDeviceContext.Get(), pFrame->images[i]);
+		recorder.Submit();
+	}
+	// copies everything a screenshot writes, nothing is mapped until the gpu had a few frames to finish them
+	void CopyCapture()
+	{
+		std::vector<std::pair<ID3D11Texture2D*, UINT>> textures;
+		lightfield.GetRecordedTextures(textures);
+		for (auto handle : simDepthArr) textures.emplace_back(frameGraph.Get(handle)->GetTex(), 0u);
+		textures.emplace_back(frameGraph.Get(outputDepth)->GetTex(), 0u);
+
+		if (captureStaging.size() != textures.size()) captureStaging = std::vector<StagingTexture>(textures.size());
+		for (size_t i = 0u; i < textures.size(); i++) captureStaging[i].Copy(pDeviceContext.Get(), textures[i].first, textures[i].second);
+		bGeometryCaptured = std::exchange(bGeometryRequested, false);
+		nCaptureFramesPending = nCaptureFramesInFlight - 1u;
+	}
+	void WriteCapturedFrame()
+	{
+		PROFILE_SCOPE("Renderer::WriteCapturedFrame");
+		nCaptureFramesPending = 0u;
+		WriteCapture(imageWriter, L"screenshots", captureFormats);
+		if (std::exchange(bGeometryCaptured, false)) ExportGeometry(std::filesystem::path(L"screenshots") / L"geometry.ply", geometryOptions);
+	}
+	void FlushRecording()
+	{
+		// frames still in flight, oldest first
+		const UINT nPending = std::min(iRecordFrame, nRecordFramesInFlight - 1u);
+		for (UINT i = nPending; i > 0u; i--) ReadRecordedFrame((iRecordFrame - i) % nRecordFramesInFlight);
+	}
 	void DrawOversizedTriangle()
 	{
 		// set empty vertex buffer
@@ -237,6 +687,13 @@ private:
 
 		backBuffer.WrapTexture(pBackBuffer);
 		backBuffer.CreateRTV(pDevice.Get(), rtvDesc);
+
+		// swapchain buffers are owned by dxgi, account for all of them here
+		D3D11_TEXTURE2D_DESC desc;
+		pBackBuffer->GetDesc(&desc);
+		DXGI_SWAP_CHAIN_DESC swapchainDesc;
+		pSwapChain->GetDesc(&swapchainDesc);
+		swapchainMemory.Track(MemoryTag::eSwapchain, TexFormatConverter::GetTextureSize(desc) * swapchainDesc.BufferCount);
 	}
 	void CreateViewport()
 	{
@@ -296,51 +753,13 @@ private:
 		HRESULT hr = pDevice->CreateSamplerState(&desc, pSamplerState.GetAddressOf());
 		pDeviceContext->PSSetSamplers(0u, 1u, pSamplerState.GetAddressOf());
 	}
-	void CreateTextureBuffers()
-	{
-		D3D11_TEXTURE2D_DESC texDesc = {};
-		texDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
-		texDesc.Width = width;
-		texDesc.Height = height;
-		texDesc.MipLevels = 1u;
-		texDesc.ArraySize = 1u;
-		texDesc.Usage = D3D11_USAGE_DEFAULT;
-		texDesc.BindFlags = D3D11_BIND_RENDER_TARGET;
-		texDesc.CPUAccessFlags = 0u;
-		texDesc.SampleDesc.Count = 1u;
-		texDesc.SampleDesc.Quality = 0u;
-
-		D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = {};
-		rtvDesc.Format = texDesc.Format;
-		rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-
-		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-		srvDesc.Format = texDesc.Format;
-		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-		srvDesc.Texture2D.MipLevels = 1u;
-		srvDesc.Texture2D.MostDetailedMip = 0u;
-
-		// each channel should contain a lightfield derivative, 4 in total per pixel
-		texDesc.BindFlags |= D3D11_BIND_SHADER_RESOURCE;
-		texDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-		rtvDesc.Format = texDesc.Format;
-		srvDesc.Format = texDesc.Format;
-		gradients.CreateTexture(pDevice.Get(), texDesc);
-		gradients.CreateRTV(pDevice.Get(), rtvDesc);
-		gradients.CreateSRV(pDevice.Get(), srvDesc);
-
-		// output depth texture should just be single channel 16bit float
-		
-		texDesc.Format = DXGI_FORMAT_R16_FLOAT;
-		rtvDesc.Format = texDesc.Format;
-		srvDesc.Format = texDesc.Format;
-		outputDepth.CreateTexture(pDevice.Get(), texDesc);
-		outputDepth.CreateRTV(pDevice.Get(), rtvDesc);
-		outputDepth.CreateSRV(pDevice.Get(), srvDesc);
-	}
 	void CreateConstantBuffer()
 	{
 		presentationModeBuffer.Init(pDevice.Get());
+		guidedFilterBuffer.GetData() = { 4u, 0u, nGuidedSlices, 1e-3f }; // radius, direction, slices, epsilon
+		guidedFilterBuffer.Init(pDevice.Get());
+		depthScaleBuffer.GetData() = depthScale;
+		depthScaleBuffer.Init(pDevice.Get());
 	}
 	void LoadShaders()
 	{
@@ -351,13 +770,30 @@ private:
 		gradientsPS.LoadShader(pDevice.Get(), L"data/shaders/GradientsPS.cso");
 		depthDeductionPS.LoadShader(pDevice.Get(), L"data/shaders/DepthDeductionPS.cso");
 		presentationPS.LoadShader(pDevice.Get(), L"data/shaders/PresentationPS.cso");
-		simpleWritePS.LoadShader(pDevice.Get(), L"data/shaders/SimpleWritePS.cso");
+
+		fusedDepthCS.LoadShader(pDevice.Get(), L"data/shaders/FusedDepthCS.cso");
+		epiDepthCS.LoadShader(pDevice.Get(), L"data/shaders/EpiDepthCS.cso");
+		guidedMomentsCS.LoadShader(pDevice.Get(), L"data/shaders/GuidedMomentsCS.cso");
+		guidedBoxCS.LoadShader(pDevice.Get(), L"data/shaders/GuidedBoxCS.cso");
+		guidedCoefficientsCS.LoadShader(pDevice.Get(), L"data/shaders/GuidedCoefficientsCS.cso");
+		guidedApplyCS.LoadShader(pDevice.Get(), L"data/shaders/GuidedApplyCS.cso");
+		downsampleViewsCS.LoadShader(pDevice.Get(), L"data/shaders/DownsampleViewsCS.cso");
+		jointBilateralUpsampleCS.LoadShader(pDevice.Get(), L"data/shaders/JointBilateralUpsampleCS.cso");
 	}
 
 public:
 		enum class PresentationMode : UINT { eColor, eSimulatedDepth, eOutputDepth };
 		ConstantBuffer<PresentationMode> presentationModeBuffer;
 private:
+	struct GuidedFilterParams
+	{
+		UINT radius, bVertical, nSlices;
+		float epsilon;
+	};
+	static constexpr UINT nGuidedSlices = 4u;
+	ConstantBuffer<GuidedFilterParams> guidedFilterBuffer;
+	ConstantBuffer<UINT> depthScaleBuffer;
+
 	bool bVSync = true;
 	UINT width, height;
 
@@ -374,12 +810,43 @@ private:
 	// Texture Buffers
 	Lightfield lightfield;
 	Texture2D backBuffer; // swapchain backbuffer
-	Texture2D gradients; // intermediary output for
-	Texture2D outputDepth; // this is what its all for
+	TrackedMemory swapchainMemory;
+
+	// Frame graph, intermediates only exist while something consumes them
+	FrameGraph<Texture2D> frameGraph;
+	FrameGraph<Texture2D>::ResourceHandle views;
+	std::array<FrameGraph<Texture2D>::ResourceHandle, CameraGrid::nViews> simDepthArr;
+	FrameGraph<Texture2D>::ResourceHandle gradients; // intermediary output for
+	FrameGraph<Texture2D>::ResourceHandle outputDepth; // this is what its all for
+	FrameGraph<Texture2D>::ResourceHandle confidence, guidedSums, guidedScratch;
+	FrameGraph<Texture2D>::ResourceHandle reducedViews, reducedDepth, reducedConfidence;
+	FrameGraph<Texture2D>::PassHandle downsamplePass, gradientsPass, depthDeductionPass, upsamplePass, refinementPass;
+	std::array<FrameGraph<Texture2D>::PassHandle, 2> fusedDepthPasses, epiDepthPasses; // full and reduced resolution
+	PresentationMode presentationMode = PresentationMode::eColor;
+	bool bFusedDepth = true, bEpiDepth = false;
+	UINT depthScale = 1u;
+	bool bGeometryRequested = false, bGeometryCaptured = false;
+	GeometryExporter::Options geometryOptions = { true };
 
 	// Shaders
 	Shader<ID3D11VertexShader> forwardVS, oversizedTriangleVS;
-	Shader<ID3D11PixelShader> forwardPS, gradientsPS, depthDeductionPS, presentationPS, simpleWritePS;
+	Shader<ID3D11PixelShader> forwardPS, gradientsPS, depthDeductionPS, presentationPS;
+	Shader<ID3D11ComputeShader> fusedDepthCS, epiDepthCS, guidedMomentsCS, guidedBoxCS, guidedCoefficientsCS, guidedApplyCS;
+	Shader<ID3D11ComputeShader> downsampleViewsCS, jointBilateralUpsampleCS;
+
+	// Screenshots, depth targets default to lossless formats
+	static constexpr UINT nCaptureFramesInFlight = 3u;
+	ImageWriter imageWriter;
+	std::vector<StagingTexture> captureStaging;
+	UINT nCaptureFramesPending = 0u;
+	CaptureFormats captureFormats;
+
+	// Recording, staging copies are read back nRecordFramesInFlight - 1 frames after they were issued
+	static constexpr UINT nRecordFramesInFlight = 3u;
+	Recorder recorder;
+	std::vector<std::pair<ID3D11Texture2D*, UINT>> recordedTextures;
+	std::array<std::vector<StagingTexture>, nRecordFramesInFlight> recordStaging;
+	UINT iRecordFrame = 0u;
 
 	// Render objects
 	std::unique_ptr<Camera> pCamera;
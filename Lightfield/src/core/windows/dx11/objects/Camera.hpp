@@ -1,13 +1,14 @@
 #pragma once
 
 #include "Transform.hpp"
+#include "pipeline/CameraGrid.hpp"
 
 class Camera
 {
 public:
-	Camera(ID3D11Device* const pDevice) : transform(pDevice), posCbuffer(pDevice),
+	Camera(ID3D11Device* const pDevice) : transform(pDevice), viewVersion(transform.GetVersion()), viewCbuffer(pDevice), posCbuffer(pDevice),
 		cbuffer(
-			pDevice, DirectX::XMMatrixTranspose(DirectX::XMMatrixPerspectiveFovLH(1.25f, 1.777777f, 0.1f, 100.0f)),
+			pDevice, DirectX::XMMatrixTranspose(DirectX::XMMatrixPerspectiveFovLH(CameraGrid::fovY, 1.777777f, CameraGrid::nearPlane, CameraGrid::farPlane)),
 			D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE)
 	{
 	}
@@ -21,11 +22,23 @@ public:
 		posCbuffer.Update(pDeviceContext);
 	}
 	inline Transform& GetTransform() { return transform; }
+	// view matrix is the inverse camera transform, only uploaded when the transform moved
+	inline ConstantBufferMat& GetViewBuffer(ID3D11DeviceContext* const pDeviceContext)
+	{
+		const uint32_t version = transform.GetVersion();
+		if (version != viewVersion) {
+			viewCbuffer.Update(pDeviceContext, DirectX::XMMatrixTranspose(transform.GetInverseWorld()));
+			viewVersion = version;
+		}
+		return viewCbuffer;
+	}
 	inline ConstantBufferMat& GetProjectionBuffer() { return cbuffer; }
 	inline ConstantBuffer<DirectX::XMFLOAT3A>& GetPosBuffer() { return posCbuffer; }
 
 private:
 	Transform transform;
+	uint32_t viewVersion;
+	ConstantBufferMat viewCbuffer;
 	ConstantBuffer<DirectX::XMFLOAT3A> posCbuffer;
 	ConstantBufferMat cbuffer;
 };
\ No newline at end of file
@@ -12,25 +12,16 @@ class Mesh
 public:
 	Mesh(ID3D11Device* const pDevice, Primitive primitive) 
 	{
-		submeshPtrs.emplace_back(std::make_unique<Submesh>());
-
-		switch (primitive)
-		{
-			case Primitive::Cube: submeshPtrs.front()->SetAsCube(pDevice); break;
-			case Primitive::Sphere: submeshPtrs.front()->SetAsSphere(pDevice); break;
-			case Primitive::Quad: submeshPtrs.front()->SetAsQuad(pDevice); break;
-		}
-
-		submeshPtrs.front()->CreateBuffer(pDevice);
+		SetPrimitive(primitive);
+		CreateBuffers(pDevice);
 	}
 	Mesh(ID3D11Device* const pDevice, std::string fileName) {
 
-		LoadObj(pDevice, fileName);
-
-		for (auto cur = submeshPtrs.begin(), end = submeshPtrs.end(); cur < end; cur++) {
-			(*cur)->CreateBuffer(pDevice);
-		}
+		ParseObj(fileName);
+		LoadTextures(pDevice);
+		CreateBuffers(pDevice);
 	}
+	Mesh() = default; // need to manually parse, load textures and create buffers
 	~Mesh() = default;
 	ROF_DELETE(Mesh);
 
@@ -41,8 +32,42 @@ public:
 			(*cur)->Draw(pDeviceContext);
 		}
 	}
-private:
-	void LoadObj(ID3D11Device* const pDevice, std::string fileName) 
+
+	// loading stages, split up so they can run as separate jobs
+	void SetPrimitive(Primitive primitive)
+	{
+		submeshPtrs.emplace_back(std::make_unique<Submesh>());
+
+		switch (primitive)
+		{
+			case Primitive::Cube: submeshPtrs.front()->SetAsCube(); break;
+			case Primitive::Sphere: submeshPtrs.front()->SetAsSphere(); break;
+			case Primitive::Quad: submeshPtrs.front()->SetAsQuad(); break;
+		}
+	}
+	std::vector<std::wstring> GetTexturePaths() const
+	{
+		std::vector<std::wstring> paths;
+		for (auto cur = submeshPtrs.begin(), end = submeshPtrs.end(); cur < end; cur++) {
+			const std::wstring& path = (*cur)->diffuseTexPath;
+			if (!path.empty() && std::find(paths.begin(), paths.end(), path) == paths.end()) paths.push_back(path);
+		}
+		return paths;
+	}
+	void LoadTextures(ID3D11Device* const pDevice)
+	{
+		for (auto cur = submeshPtrs.begin(), end = submeshPtrs.end(); cur < end; cur++) {
+			if ((*cur)->diffuseTexPath.empty()) continue;
+			(*cur)->texturePack.diffuse_tex = TextureCache::Get().Load(pDevice, (*cur)->diffuseTexPath);
+		}
+	}
+	void CreateBuffers(ID3D11Device* const pDevice)
+	{
+		for (auto cur = submeshPtrs.begin(), end = submeshPtrs.end(); cur < end; cur++) {
+			(*cur)->CreateBuffer(pDevice);
+		}
+	}
+	void ParseObj(std::string fileName) 
 	{
 		std::ostringstream oss;
 		oss << "data/objs/" << fileName << "/";
@@ -63,8 +88,6 @@ private:
 		auto& shapes = reader.GetShapes();
 		auto& materials = reader.GetMaterials();
 
-		// TODO: reserve space for vertices, indices
-
 		submeshPtrs.reserve(shapes.size());
 
 		// Loop over shapes
@@ -72,11 +95,14 @@ private:
 
 			submeshPtrs.emplace_back(std::make_unique<Submesh>());
 
+			// every face vertex becomes its own vertex, so both arrays are sized by the indices of the shape
+			submeshPtrs.back()->vertices.reserve(shapes[s].mesh.indices.size());
+			submeshPtrs.back()->indices.reserve(shapes[s].mesh.indices.size());
+
 			// this assumes that each submesh/shape has a unique material assigned to it
 			auto matID = shapes[s].mesh.material_ids[0];
 			if (!materials[matID].diffuse_texname.empty()) {
-				submeshPtrs.back()->texturePack.diffuse_tex = std::make_unique<Texture2D>();
-				submeshPtrs.back()->texturePack.diffuse_tex->CreateTextureFromJPG(pDevice, s2ws(filePath + materials[matID].diffuse_texname));
+				submeshPtrs.back()->diffuseTexPath = s2ws(filePath + materials[matID].diffuse_texname);
 			}
 
 			// Loop over faces(polygon)
@@ -6,16 +6,17 @@
 class RenderObject
 {
 public:
-	RenderObject(ID3D11Device* const pDevice, Primitive primitive) : transform(pDevice), mesh(pDevice, primitive) {}
-	RenderObject(ID3D11Device* const pDevice, std::string fileName) : transform(pDevice), mesh(pDevice, fileName) {}
+	RenderObject(ID3D11Device* const pDevice, Primitive primitive) : transform(pDevice), pMesh(std::make_shared<Mesh>(pDevice, primitive)) {}
+	RenderObject(ID3D11Device* const pDevice, std::string fileName) : transform(pDevice), pMesh(std::make_shared<Mesh>(pDevice, fileName)) {}
+	RenderObject(ID3D11Device* const pDevice, std::shared_ptr<Mesh> pMesh) : transform(pDevice), pMesh(std::move(pMesh)) {} // shares an already loaded mesh
 	~RenderObject() = default;
 	ROF_DELETE(RenderObject);
 
 public:
 	inline Transform& GetTransform() { return transform; }
-	inline void Draw(ID3D11DeviceContext* const pDeviceContext) { mesh.Draw(pDeviceContext); }
+	inline void Draw(ID3D11DeviceContext* const pDeviceContext) { pMesh->Draw(pDeviceContext); }
 
 private:
 	Transform transform;
-	Mesh mesh;
+	std::shared_ptr<Mesh> pMesh;
 };
\ No newline at end of file
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "RenderObject.hpp"
+
+// loads render objects in the background, each as a chain of jobs: parse mesh -> decode textures -> upload buffers
+// finished objects get handed to the renderer one by one, so the scene fills up while the rest is still loading
+class SceneLoader
+{
+public:
+	typedef std::function<void(Transform&)> TransformSetup;
+
+public:
+	SceneLoader(ID3D11Device* const pDevice) : pDevice(pDevice) {}
+	~SceneLoader() = default;
+	ROF_DELETE(SceneLoader);
+
+public:
+	void Load(std::string fileName, TransformSetup setup)
+	{
+		auto pMesh = std::make_shared<Mesh>();
+		nPending++;
+
+		// parsing has to finish first, only then the referenced textures are known
+		jobSystem.Schedule([this, pMesh, fileName, setup]() {
+			PROFILE_SCOPE("SceneLoader::ParseObj");
+			if (!Try([&]() { pMesh->ParseObj(fileName); })) {
+				nPending--;
+				return;
+			}
+
+			// one job per texture, upload waits for all of them
+			std::vector<JobSystem::JobHandle> textureJobs;
+			for (const auto& path : pMesh->GetTexturePaths()) {
+				textureJobs.push_back(jobSystem.Schedule([this, path]() {
+					PROFILE_SCOPE("SceneLoader::LoadTexture");
+					Try([&]() { TextureCache::Get().Load(pDevice, path); });
+				}));
+			}
+			jobSystem.Schedule([this, pMesh, setup]() {
+				PROFILE_SCOPE("SceneLoader::Upload");
+				if (Try([&]() { pMesh->LoadTextures(pDevice); pMesh->CreateBuffers(pDevice); })) Finish(pMesh, setup);
+				else nPending--;
+			}, textureJobs);
+		});
+	}
+	void Load(Primitive primitive, TransformSetup setup)
+	{
+		auto pMesh = std::make_shared<Mesh>();
+		nPending++;
+
+		jobSystem.Schedule([this, pMesh, primitive, setup]() {
+			PROFILE_SCOPE("SceneLoader::Primitive");
+			if (Try([&]() { pMesh->SetPrimitive(primitive); pMesh->CreateBuffers(pDevice); })) Finish(pMesh, setup);
+			else nPending--;
+		});
+	}
+
+	// moves finished objects into the render list, rethrows the first loading error on the calling thread
+	void Collect(std::vector<std::unique_ptr<RenderObject>>& renderObjects)
+	{
+		PROFILE_SCOPE("SceneLoader::Collect");
+		std::vector<Loaded> objects;
+		std::exception_ptr pException;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			objects.swap(loaded);
+			std::swap(pException, pError);
+		}
+		if (pException) std::rethrow_exception(pException);
+
+		// transforms create their buffers here, on the thread that also updates them
+		for (auto& object : objects) {
+			renderObjects.emplace_back(std::make_unique<RenderObject>(pDevice, std::move(object.pMesh)));
+			object.setup(renderObjects.back()->GetTransform());
+			nPending--;
+		}
+	}
+	inline bool IsLoading() const { return nPending > 0u; }
+
+private:
+	struct Loaded
+	{
+		std::shared_ptr<Mesh> pMesh;
+		TransformSetup setup;
+	};
+
+	// runs a loading stage, on failure the error is kept for Collect()
+	template<typename Func>
+	bool Try(Func&& func)
+	{
+		try {
+			func();
+			return true;
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!pError) pError = std::current_exception();
+		}
+		return false;
+	}
+	void Finish(std::shared_ptr<Mesh> pMesh, TransformSetup setup)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		loaded.push_back({ std::move(pMesh), std::move(setup) });
+	}
+
+private:
+	ID3D11Device* const pDevice;
+	std::mutex mutex;
+	std::vector<Loaded> loaded;
+	std::exception_ptr pError;
+	std::atomic<UINT> nPending = 0u;
+	JobSystem jobSystem; // declared last so running jobs finish before the state they use goes away
+};
\ No newline at end of file
@@ -4,15 +4,15 @@
 
 // container to hold all potential textures for objects
 struct TexturePack {
-	std::unique_ptr<Texture2D> alpha_tex;
-	std::unique_ptr<Texture2D> ambient_tex;
-	std::unique_ptr<Texture2D> bump_tex;
-	std::unique_ptr<Texture2D> diffuse_tex;
-	std::unique_ptr<Texture2D> displacement_tex;
-	std::unique_ptr<Texture2D> emissive_tex;
-	std::unique_ptr<Texture2D> metallic_tex;
-	std::unique_ptr<Texture2D> normal_tex;
-	std::unique_ptr<Texture2D> reflection_tex;
+	std::shared_ptr<Texture2D> alpha_tex;
+	std::shared_ptr<Texture2D> ambient_tex;
+	std::shared_ptr<Texture2D> bump_tex;
+	std::shared_ptr<Texture2D> diffuse_tex;
+	std::shared_ptr<Texture2D> displacement_tex;
+	std::shared_ptr<Texture2D> emissive_tex;
+	std::shared_ptr<Texture2D> metallic_tex;
+	std::shared_ptr<Texture2D> normal_tex;
+	std::shared_ptr<Texture2D> reflection_tex;
 };
 // Vertex type used for standard meshes
 struct Vertex 
@@ -54,7 +54,7 @@ struct Submesh
 		pDeviceContext->DrawIndexed(indexCount, 0u, 0u);
 	}
 
-	void SetAsCube(ID3D11Device* const pDevice)
+	void SetAsCube()
 	{
 		DirectX::XMFLOAT4 col = { 1.0f, 1.0f, 1.0f, 1.0f };
 		static constexpr float p = .5f, z = 0.0f, n = -.5f;
@@ -113,7 +113,7 @@ struct Submesh
 			indices.insert(indices.end(), { 0 + i, 1 + i, 2 + i, 1 + i, 3 + i, 2 + i });
 		}
 	}
-	void SetAsSphere(ID3D11Device* const pDevice)
+	void SetAsSphere()
 	{
 		DirectX::XMFLOAT4 col = { 1.0f, 1.0f, 1.0f, 1.0f };
 
@@ -157,7 +157,7 @@ struct Submesh
 			}
 		}
 	}
-	void SetAsQuad(ID3D11Device* const pDevice)
+	void SetAsQuad()
 	{
 		DirectX::XMFLOAT4 norm = { 0.0f, 0.0f, -1.0f, 0.0f };
 		DirectX::XMFLOAT4 col = { 1.0f, 1.0f, 1.0f, 1.0f };
@@ -202,6 +202,7 @@ struct Submesh
 			bufferData.SysMemSlicePitch = 0u;
 
 			pDevice->CreateBuffer(&bufferDesc, &bufferData, &pVertexBuffer);
+			vertexMemory.Track(MemoryTag::eGeometry, bufferDesc.ByteWidth);
 		}
 
 		// Fill index buffer
@@ -222,12 +223,15 @@ struct Submesh
 
 			// Create the buffer with the device.
 			pDevice->CreateBuffer(&bufferDesc, &bufferData, &pIndexBuffer);
+			indexMemory.Track(MemoryTag::eGeometry, bufferDesc.ByteWidth);
 		}
 	}
 
 	Microsoft::WRL::ComPtr<ID3D11Buffer> pVertexBuffer, pIndexBuffer;
+	TrackedMemory vertexMemory, indexMemory;
 	std::vector<Vertex> vertices;
 	std::vector<Index> indices;
 	UINT vertexCount, indexCount;
 	TexturePack texturePack;
+	std::wstring diffuseTexPath; // resolved into texturePack during loading
 };
\ No newline at end of file
@@ -1,15 +1,21 @@
 #pragma once
 
+#include "TransformSystem.hpp"
+
+// handle into the TransformSystem plus the model matrix buffer the shaders read
+// setters only touch the system's arrays, matrices are rebuilt for all transforms at once in TransformSystem::Update()
 class Transform
 {
 public:
 	Transform(ID3D11Device* const pDevice) : Transform(pDevice, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }) {}
 	Transform(ID3D11Device* const pDevice, DirectX::XMFLOAT3A pos, DirectX::XMFLOAT3A rot, DirectX::XMFLOAT3A scale_param) :
-		rotation(DirectX::XMQuaternionRotationRollPitchYaw(rot.x, rot.y, rot.z)),
-		position(DirectX::XMLoadFloat3A(&pos)), scale(DirectX::XMLoadFloat3A(&scale_param)),
-		bDirty(false), cbuffer(pDevice, CalcMatrix(true), D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE),
-		inverseCbuffer(pDevice, CalcMatrix(false), D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE)
+		handle(CreateHandle(pos, rot, scale_param)), uploadedVersion(TransformSystem::Get().GetVersion(handle)),
+		cbuffer(pDevice, DirectX::XMMatrixIdentity(), D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE)
+	{
+	}
+	~Transform()
 	{
+		TransformSystem::Get().Destroy(handle);
 	}
 	ROF_DELETE(Transform);
 
@@ -17,68 +23,51 @@ public:
 	// Local transform Getters
 	DirectX::XMFLOAT3A GetPosition() const
 	{
-		DirectX::XMFLOAT3A vec;
-		DirectX::XMStoreFloat3A(&vec, position);
-		return vec;
+		return TransformSystem::Get().GetPosition(handle);
 	}
 	DirectX::XMFLOAT4A GetRotation() const
 	{
-		DirectX::XMFLOAT4A vec;
-		DirectX::XMStoreFloat4A(&vec, rotation);
-		return vec;
+		return TransformSystem::Get().GetRotation(handle);
 	}
 	DirectX::XMFLOAT3A GetScale() const
 	{
-		DirectX::XMFLOAT3A vec;
-		DirectX::XMStoreFloat3A(&vec, scale);
-		return vec;
+		return TransformSystem::Get().GetScale(handle);
 	}
 
 	// Local transform Setters
 	void SetPosition(const float x, const float y, const float z)
 	{
-		bDirty = true;
-		DirectX::XMFLOAT3A positionBase = { x, y, z };
-		position = DirectX::XMLoadFloat3A(&positionBase);
+		TransformSystem::Get().SetPosition(handle, x, y, z);
 	}
 	void SetRotation(const float x, const float y, const float z, const float w)
 	{
-		bDirty = true;
-		DirectX::XMFLOAT4A rotationBase = { x, y, z, w };
-		rotation = DirectX::XMLoadFloat4A(&rotationBase);
+		TransformSystem::Get().SetRotation(handle, x, y, z, w);
 	}
 	void SetRotationEuler(const float x, const float y, const float z)
 	{
-		bDirty = true;
-		rotation = DirectX::XMQuaternionRotationRollPitchYaw(x, y, z);
-	}
-	void SetRotationEulerImmediate(ID3D11DeviceContext* const pDeviceContext, const float x, const float y, const float z)
-	{
-		bDirty = true;
-		DirectX::XMFLOAT3A rotationEulerBase = { x, y, z };
-		rotation = DirectX::XMQuaternionRotationRollPitchYaw(rotationEulerBase.x, rotationEulerBase.y, rotationEulerBase.z);
-
-		if (bDirty) UpdateTransformMatrix(pDeviceContext);
+		StoreRotation(DirectX::XMQuaternionRotationRollPitchYaw(x, y, z));
 	}
 	void SetScale(const float x, const float y, const float z)
 	{
-		bDirty = true;
-		DirectX::XMFLOAT3A scaleBase = { x, y, z };
-		scale = DirectX::XMLoadFloat3A(&scaleBase);
+		TransformSystem::Get().SetScale(handle, x, y, z);
 	}
 
 	// Adding offset to current transform vectors
 	void Translate(const float x, const float y, const float z)
 	{
-		bDirty = true;
-		DirectX::XMFLOAT3A translationBase = { x, y, z };
-		position = DirectX::XMVectorAdd(DirectX::XMLoadFloat3A(&translationBase), position);
+		const DirectX::XMFLOAT3A position = GetPosition();
+		SetPosition(position.x + x, position.y + y, position.z + z);
 	}
 	void RotateEuler(const float x, const float y, const float z)
 	{
-		bDirty = true;
-		rotation = DirectX::XMQuaternionMultiply(rotation,
-			DirectX::XMQuaternionRotationRollPitchYaw(x, y, z));
+		StoreRotation(DirectX::XMQuaternionMultiply(LoadRotation(),
+			DirectX::XMQuaternionRotationRollPitchYaw(x, y, z)));
+	}
+
+	// Hierarchy, local values become relative to the parent
+	void SetParent(Transform* pParent)
+	{
+		TransformSystem::Get().SetParent(handle, pParent ? pParent->handle : TransformSystem::invalidHandle);
 	}
 
 	// Local directional vectors
@@ -86,63 +75,61 @@ public:
 	{
 		DirectX::XMFLOAT3A vec;
 		const DirectX::XMVECTOR tempRight = { 1.0f, 0.0f, 0.0f, 0.0f };
-		DirectX::XMStoreFloat3A(&vec, DirectX::XMVector3Rotate(tempRight, rotation));
+		DirectX::XMStoreFloat3A(&vec, DirectX::XMVector3Rotate(tempRight, LoadRotation()));
 		return vec;
 	}
 	DirectX::XMFLOAT3A GetUp()
 	{
 		DirectX::XMFLOAT3A vec;
 		const DirectX::XMVECTOR tempUp = { 0.0f, 1.0f, 0.0f, 0.0f };
-		DirectX::XMStoreFloat3A(&vec, DirectX::XMVector3Rotate(tempUp, rotation));
+		DirectX::XMStoreFloat3A(&vec, DirectX::XMVector3Rotate(tempUp, LoadRotation()));
 		return vec;
 	}
 	DirectX::XMFLOAT3A GetForward()
 	{
 		DirectX::XMFLOAT3A vec;
 		const DirectX::XMVECTOR tempForward = { 0.0f, 0.0f, 1.0f, 0.0f };
-		DirectX::XMStoreFloat3A(&vec, DirectX::XMVector3Rotate(tempForward, rotation));
+		DirectX::XMStoreFloat3A(&vec, DirectX::XMVector3Rotate(tempForward, LoadRotation()));
 		return vec;
 	}
 
-	// Get Pointer to buffers
+	// World matrices as of the last TransformSystem::Update()
+	inline DirectX::XMMATRIX GetWorld() const { return TransformSystem::Get().GetWorld(handle); }
+	inline DirectX::XMMATRIX GetInverseWorld() const { return TransformSystem::Get().GetInverseWorld(handle); }
+	inline uint32_t GetVersion() const { return TransformSystem::Get().GetVersion(handle); }
+
+	// Get Pointer to buffer, only uploads when the world matrix changed since the last call
 	inline ConstantBufferMat& GetBuffer(ID3D11DeviceContext* const pDeviceContext)
 	{
-		if (bDirty) UpdateTransformMatrix(pDeviceContext);
+		const uint32_t version = GetVersion();
+		if (version != uploadedVersion) {
+			cbuffer.Update(pDeviceContext, DirectX::XMMatrixTranspose(GetWorld()));
+			uploadedVersion = version;
+		}
 		return cbuffer;
 	}
-	inline ConstantBufferMat& GetInverseBuffer(ID3D11DeviceContext* const pDeviceContext)
-	{
-		if (bDirty) UpdateTransformMatrix(pDeviceContext);
-		return inverseCbuffer;
-	}
 
 private:
-	inline void UpdateTransformMatrix(ID3D11DeviceContext* const pDeviceContext)
+	static TransformSystem::Handle CreateHandle(const DirectX::XMFLOAT3A& pos, const DirectX::XMFLOAT3A& rot, const DirectX::XMFLOAT3A& scale)
+	{
+		DirectX::XMFLOAT4 rotation;
+		DirectX::XMStoreFloat4(&rotation, DirectX::XMQuaternionRotationRollPitchYaw(rot.x, rot.y, rot.z));
+		return TransformSystem::Get().Create(pos, rotation, scale);
+	}
+	inline DirectX::XMVECTOR LoadRotation() const
 	{
-		cbuffer.GetData() = CalcMatrix(false);
-		cbuffer.Update(pDeviceContext);
-		inverseCbuffer.GetData() = CalcMatrix(true);
-		inverseCbuffer.Update(pDeviceContext);
-		bDirty = false;
+		const DirectX::XMFLOAT4A rotation = GetRotation();
+		return DirectX::XMLoadFloat4A(&rotation);
 	}
-	inline DirectX::XMMATRIX CalcMatrix(bool bInverted = false)
+	inline void StoreRotation(DirectX::FXMVECTOR quaternion)
 	{
-		auto mat = DirectX::XMMatrixMultiplyTranspose(
-			DirectX::XMMatrixMultiply(
-				DirectX::XMMatrixScalingFromVector(scale),
-				DirectX::XMMatrixRotationQuaternion(rotation)),
-			DirectX::XMMatrixTranslationFromVector(position));
-		if (bInverted) mat = DirectX::XMMatrixInverse(nullptr, mat);
-		return mat;
+		DirectX::XMFLOAT4A rotation;
+		DirectX::XMStoreFloat4A(&rotation, quaternion);
+		SetRotation(rotation.x, rotation.y, rotation.z, rotation.w);
 	}
 
 private:
-	DirectX::XMVECTOR position;
-	DirectX::XMVECTOR rotation; // quaternion
-	DirectX::XMVECTOR scale;
-
-	bool bDirty;
-
+	const TransformSystem::Handle handle;
+	uint32_t uploadedVersion;
 	ConstantBufferMat cbuffer;
-	ConstantBufferMat inverseCbuffer;
 };
\ No newline at end of file
@@ -0,0 +1,251 @@
+#pragma once
+
+// structure of arrays store for every transform in the scene, updated in one pass per frame
+// local matrices and their inverses are built four transforms at a time, one transform per simd lane
+// inverses come straight from translation, rotation and scale, so no general matrix inversion is needed
+class TransformSystem
+{
+public:
+	typedef UINT Handle;
+	static constexpr Handle invalidHandle = UINT_MAX;
+
+private:
+	TransformSystem() = default;
+	~TransformSystem() = default;
+	ROF_DELETE(TransformSystem);
+
+public:
+	static inline TransformSystem& Get()
+	{
+		static TransformSystem instance;
+		return instance;
+	}
+
+	Handle Create(const DirectX::XMFLOAT3& pos, const DirectX::XMFLOAT4& rot, const DirectX::XMFLOAT3& scale)
+	{
+		Handle handle;
+		if (!freeHandles.empty()) {
+			handle = freeHandles.back();
+			freeHandles.pop_back();
+		}
+		else {
+			handle = static_cast<Handle>(parents.size());
+			Resize(parents.size() + 1u);
+		}
+
+		bActive[handle] = 1u;
+		parents[handle] = invalidHandle;
+		depths[handle] = 0u;
+		SetPosition(handle, pos.x, pos.y, pos.z);
+		SetRotation(handle, rot.x, rot.y, rot.z, rot.w);
+		SetScale(handle, scale.x, scale.y, scale.z);
+		bOrderDirty = true;
+		return handle;
+	}
+	void Destroy(Handle handle)
+	{
+		// children fall back to the root instead of pointing at a reused slot
+		for (size_t i = 0u; i < parents.size(); i++) {
+			if (bActive[i] && parents[i] == handle) SetParent(static_cast<Handle>(i), invalidHandle);
+		}
+		bActive[handle] = 0u;
+		bLocalDirty[handle] = 0u;
+		freeHandles.push_back(handle);
+		bOrderDirty = true;
+	}
+
+	// local transform, relative to the parent if there is one
+	inline void SetPosition(Handle handle, float x, float y, float z)
+	{
+		px[handle] = x; py[handle] = y; pz[handle] = z;
+		bLocalDirty[handle] = 1u;
+	}
+	inline void SetRotation(Handle handle, float x, float y, float z, float w)
+	{
+		qx[handle] = x; qy[handle] = y; qz[handle] = z; qw[handle] = w;
+		bLocalDirty[handle] = 1u;
+	}
+	inline void SetScale(Handle handle, float x, float y, float z)
+	{
+		sx[handle] = x; sy[handle] = y; sz[handle] = z;
+		bLocalDirty[handle] = 1u;
+	}
+	inline DirectX::XMFLOAT3A GetPosition(Handle handle) const { return { px[handle], py[handle], pz[handle] }; }
+	inline DirectX::XMFLOAT4A GetRotation(Handle handle) const { return { qx[handle], qy[handle], qz[handle], qw[handle] }; }
+	inline DirectX::XMFLOAT3A GetScale(Handle handle) const { return { sx[handle], sy[handle], sz[handle] }; }
+
+	void SetParent(Handle handle, Handle parent)
+	{
+		for (Handle cur = parent; cur != invalidHandle; cur = parents[cur]) {
+			if (cur == handle) throw std::runtime_error("Transform hierarchy must not contain cycles");
+		}
+		parents[handle] = parent;
+		bLocalDirty[handle] = 1u;
+		bOrderDirty = true;
+	}
+	inline Handle GetParent(Handle handle) const { return parents[handle]; }
+
+	// world matrices of the last Update(), row vector convention like the rest of DirectXMath
+	inline DirectX::XMMATRIX GetWorld(Handle handle) const { return DirectX::XMLoadFloat4x4A(&worlds[handle]); }
+	inline DirectX::XMMATRIX GetInverseWorld(Handle handle) const { return DirectX::XMLoadFloat4x4A(&inverseWorlds[handle]); }
+	// changes whenever the world matrix does, so gpu copies know when to refresh
+	inline uint32_t GetVersion(Handle handle) const { return versions[handle]; }
+
+	void Update()
+	{
+		PROFILE_SCOPE("TransformSystem::Update");
+		if (bOrderDirty) RebuildOrder();
+		UpdateLocals();
+		UpdateWorlds();
+	}
+
+private:
+	void Resize(size_t size)
+	{
+		// scalar arrays are padded to whole simd groups, so the batched pass never reads past the end
+		const size_t paddedSize = (size + 3u) & ~size_t(3u);
+		for (auto* pArray : { &px, &py, &pz, &qx, &qy, &qz }) pArray->resize(paddedSize, 0.0f);
+		for (auto* pArray : { &qw, &sx, &sy, &sz }) pArray->resize(paddedSize, 1.0f);
+		bLocalDirty.resize(paddedSize, 0u);
+
+		bActive.resize(size, 0u);
+		bWorldDirty.resize(size, 0u);
+		parents.resize(size, invalidHandle);
+		depths.resize(size, 0u);
+		versions.resize(size, 0u);
+		locals.resize(size);
+		inverseLocals.resize(size);
+		worlds.resize(size);
+		inverseWorlds.resize(size);
+	}
+	void RebuildOrder()
+	{
+		// parents before children: sort by hierarchy depth
+		order.clear();
+		for (size_t i = 0u; i < parents.size(); i++) {
+			if (!bActive[i]) continue;
+			UINT depth = 0u;
+			for (Handle cur = parents[i]; cur != invalidHandle; cur = parents[cur]) depth++;
+			depths[i] = depth;
+			order.push_back(static_cast<Handle>(i));
+		}
+		std::stable_sort(order.begin(), order.end(), [this](Handle a, Handle b) { return depths[a] < depths[b]; });
+		bOrderDirty = false;
+	}
+	void UpdateLocals()
+	{
+		using namespace DirectX;
+		const XMVECTOR one = XMVectorReplicate(1.0f);
+		const XMVECTOR two = XMVectorReplicate(2.0f);
+
+		for (size_t i = 0u; i < parents.size(); i += 4u) {
+			if (!(bLocalDirty[i] || bLocalDirty[i + 1u] || bLocalDirty[i + 2u] || bLocalDirty[i + 3u])) continue;
+
+			// each lane holds a different transform
+			const XMVECTOR x = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&qx[i]));
+			const XMVECTOR y = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&qy[i]));
+			const XMVECTOR z = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&qz[i]));
+			const XMVECTOR w = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&qw[i]));
+			const XMVECTOR scaleX = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&sx[i]));
+			const XMVECTOR scaleY = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&sy[i]));
+			const XMVECTOR scaleZ = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&sz[i]));
+			const XMVECTOR posX = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&px[i]));
+			const XMVECTOR posY = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&py[i]));
+			const XMVECTOR posZ = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&pz[i]));
+
+			// rotation matrix from the quaternion, r[row][col] in row vector convention
+			const XMVECTOR xx = XMVectorMultiply(x, x), yy = XMVectorMultiply(y, y), zz = XMVectorMultiply(z, z);
+			const XMVECTOR xy = XMVectorMultiply(x, y), xz = XMVectorMultiply(x, z), yz = XMVectorMultiply(y, z);
+			const XMVECTOR wx = XMVectorMultiply(w, x), wy = XMVectorMultiply(w, y), wz = XMVectorMultiply(w, z);
+			const XMVECTOR r[3][3] = {
+				{ XMVectorNegativeMultiplySubtract(two, XMVectorAdd(yy, zz), one), XMVectorMultiply(two, XMVectorAdd(xy, wz)), XMVectorMultiply(two, XMVectorSubtract(xz, wy)) },
+				{ XMVectorMultiply(two, XMVectorSubtract(xy, wz)), XMVectorNegativeMultiplySubtract(two, XMVectorAdd(xx, zz), one), XMVectorMultiply(two, XMVectorAdd(yz, wx)) },
+				{ XMVectorMultiply(two, XMVectorAdd(xz, wy)), XMVectorMultiply(two, XMVectorSubtract(yz, wx)), XMVectorNegativeMultiplySubtract(two, XMVectorAdd(xx, yy), one) }
+			};
+			const XMVECTOR s[3] = { scaleX, scaleY, scaleZ };
+			const XMVECTOR invS[3] = { XMVectorReciprocal(scaleX), XMVectorReciprocal(scaleY), XMVectorReciprocal(scaleZ) };
+			const XMVECTOR p[3] = { posX, posY, posZ };
+
+			// local = S * R * T, rows of R scaled by s, translation in the last row
+			// inverse = T^-1 * R^T * S^-1, so element (i, j) is r[j][i] / s[j] and the last row is -p * R^T * S^-1
+			XMVECTOR local[4][4], inverse[4][4];
+			for (UINT row = 0u; row < 3u; row++) {
+				for (UINT col = 0u; col < 3u; col++) {
+					local[row][col] = XMVectorMultiply(r[row][col], s[row]);
+					inverse[row][col] = XMVectorMultiply(r[col][row], invS[col]);
+				}
+				local[row][3] = XMVectorZero();
+				inverse[row][3] = XMVectorZero();
+			}
+			for (UINT col = 0u; col < 3u; col++) {
+				local[3][col] = p[col];
+				XMVECTOR dot = XMVectorMultiply(p[0], r[col][0]);
+				dot = XMVectorMultiplyAdd(p[1], r[col][1], dot);
+				dot = XMVectorMultiplyAdd(p[2], r[col][2], dot);
+				inverse[3][col] = XMVectorNegate(XMVectorMultiply(dot, invS[col]));
+			}
+			local[3][3] = one;
+			inverse[3][3] = one;
+
+			// scatter the lanes back into per-transform matrices
+			XMFLOAT4A localLanes[4][4], inverseLanes[4][4];
+			for (UINT row = 0u; row < 4u; row++) {
+				for (UINT col = 0u; col < 4u; col++) {
+					XMStoreFloat4A(&localLanes[row][col], local[row][col]);
+					XMStoreFloat4A(&inverseLanes[row][col], inverse[row][col]);
+				}
+			}
+			for (UINT lane = 0u; lane < 4u && i + lane < parents.size(); lane++) {
+				const size_t index = i + lane;
+				if (!bLocalDirty[index] || !bActive[index]) continue;
+				for (UINT row = 0u; row < 4u; row++) {
+					for (UINT col = 0u; col < 4u; col++) {
+						locals[index].m[row][col] = (&localLanes[row][col].x)[lane];
+						inverseLocals[index].m[row][col] = (&inverseLanes[row][col].x)[lane];
+					}
+				}
+				bLocalDirty[index] = 0u;
+				bWorldDirty[index] = 1u;
+			}
+		}
+	}
+	void UpdateWorlds()
+	{
+		using namespace DirectX;
+
+		// parents come first in the order, so their world matrices are final by the time children read them
+		for (Handle handle : order) {
+			const Handle parent = parents[handle];
+			if (parent != invalidHandle && bWorldDirty[parent]) bWorldDirty[handle] = 1u;
+			if (!bWorldDirty[handle]) continue;
+
+			if (parent == invalidHandle) {
+				worlds[handle] = locals[handle];
+				inverseWorlds[handle] = inverseLocals[handle];
+			}
+			else {
+				XMStoreFloat4x4A(&worlds[handle], XMMatrixMultiply(XMLoadFloat4x4A(&locals[handle]), XMLoadFloat4x4A(&worlds[parent])));
+				XMStoreFloat4x4A(&inverseWorlds[handle], XMMatrixMultiply(XMLoadFloat4x4A(&inverseWorlds[parent]), XMLoadFloat4x4A(&inverseLocals[handle])));
+			}
+			versions[handle]++;
+		}
+
+		// flags are only cleared afterwards, children further down the order still need to see them
+		for (Handle handle : order) bWorldDirty[handle] = 0u;
+	}
+
+private:
+	// local components, one array per scalar
+	std::vector<float> px, py, pz;
+	std::vector<float> qx, qy, qz, qw;
+	std::vector<float> sx, sy, sz;
+	std::vector<uint8_t> bLocalDirty; // bytes rather than bits, flags get tested in the hot loop
+
+	// hierarchy and results
+	std::vector<uint8_t> bActive, bWorldDirty;
+	std::vector<Handle> parents, freeHandles, order;
+	std::vector<UINT> depths;
+	std::vector<uint32_t> versions;
+	std::vector<DirectX::XMFLOAT4X4A> locals, inverseLocals, worlds, inverseWorlds;
+	bool bOrderDirty = false;
+};
\ No newline at end of file
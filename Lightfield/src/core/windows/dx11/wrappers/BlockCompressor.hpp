@@ -0,0 +1,420 @@
+#pragma once
+
+// cpu encoder/decoder for 4x4 texel blocks in BC1, BC3 and BC7 (mode 6) layout
+// texels are passed as 16 rgba8 values in row-major order
+class BlockCompressor
+{
+public:
+	enum class Format : UINT { eBC1, eBC3, eBC7 };
+
+public:
+	static inline constexpr UINT GetBlockSize(Format format) { return format == Format::eBC1 ? 8u : 16u; }
+
+	static void EncodeBlock(Format format, const BYTE* const pTexels, BYTE* const pBlock)
+	{
+		switch (format)
+		{
+			case Format::eBC1: EncodeColor(pTexels, pBlock); break;
+			case Format::eBC3: EncodeAlpha(pTexels, pBlock); EncodeColor(pTexels, pBlock + 8u); break;
+			case Format::eBC7: EncodeBC7Mode6(pTexels, pBlock); break;
+		}
+	}
+	// returns false for bc7 blocks not using mode 6, those are filled with opaque magenta
+	static bool DecodeBlock(Format format, const BYTE* const pBlock, BYTE* const pTexels)
+	{
+		switch (format)
+		{
+			case Format::eBC1: DecodeColor(pBlock, pTexels, true); return true;
+			case Format::eBC3: DecodeColor(pBlock + 8u, pTexels, false); DecodeAlpha(pBlock, pTexels); return true;
+			case Format::eBC7: return DecodeBC7Mode6(pBlock, pTexels);
+		}
+		return false;
+	}
+
+	// compresses a whole image, block rows are distributed across threads
+	// bBGR swizzles the source channels, bOpaque ignores the source alpha (for X8 formats)
+	static std::vector<BYTE> Compress(Format format, const BYTE* const pData, UINT width, UINT height, bool bBGR, bool bOpaque)
+	{
+		const UINT nBlocksX = std::max(1u, (width + 3u) / 4u);
+		const UINT nBlocksY = std::max(1u, (height + 3u) / 4u);
+		const UINT blockSize = GetBlockSize(format);
+		std::vector<BYTE> blocks(static_cast<size_t>(nBlocksX) * nBlocksY * blockSize);
+
+		ParallelFor(0u, nBlocksY, [&](size_t by) {
+			BYTE texels[16u * 4u];
+			for (UINT bx = 0u; bx < nBlocksX; bx++) {
+
+				// gather block, clamping at the edges of small or odd sized levels
+				for (UINT i = 0u; i < 16u; i++) {
+					const UINT x = std::min(bx * 4u + (i & 3u), width - 1u);
+					const UINT y = std::min(static_cast<UINT>(by) * 4u + (i >> 2u), height - 1u);
+					const BYTE* pSrc = pData + (static_cast<size_t>(y) * width + x) * 4u;
+					texels[i * 4u + 0u] = pSrc[bBGR ? 2u : 0u];
+					texels[i * 4u + 1u] = pSrc[1u];
+					texels[i * 4u + 2u] = pSrc[bBGR ? 0u : 2u];
+					texels[i * 4u + 3u] = bOpaque ? UCHAR_MAX : pSrc[3u];
+				}
+				EncodeBlock(format, texels, &blocks[(by * nBlocksX + bx) * blockSize]);
+			}
+		});
+		return blocks;
+	}
+
+private:
+	// BC1 color endpoints along the principal axis of the block, refined once with least squares
+	static void EncodeColor(const BYTE* const pTexels, BYTE* const pBlock)
+	{
+		float mean[3] = { 0.0f, 0.0f, 0.0f };
+		for (UINT i = 0u; i < 16u; i++) for (UINT c = 0u; c < 3u; c++) mean[c] += pTexels[i * 4u + c];
+		for (UINT c = 0u; c < 3u; c++) mean[c] /= 16.0f;
+
+		// covariance and power iteration for the dominant direction
+		float cov[6] = {};
+		for (UINT i = 0u; i < 16u; i++) {
+			const float r = pTexels[i * 4u + 0u] - mean[0], g = pTexels[i * 4u + 1u] - mean[1], b = pTexels[i * 4u + 2u] - mean[2];
+			cov[0] += r * r; cov[1] += r * g; cov[2] += r * b;
+			cov[3] += g * g; cov[4] += g * b; cov[5] += b * b;
+		}
+		float axis[3] = { 1.0f, 1.0f, 1.0f };
+		for (UINT iter = 0u; iter < 4u; iter++) {
+			const float x = axis[0] * cov[0] + axis[1] * cov[1] + axis[2] * cov[2];
+			const float y = axis[0] * cov[1] + axis[1] * cov[3] + axis[2] * cov[4];
+			const float z = axis[0] * cov[2] + axis[1] * cov[4] + axis[2] * cov[5];
+			const float magn = std::max({ std::abs(x), std::abs(y), std::abs(z) });
+			if (magn < 1e-6f) break;
+			axis[0] = x / magn; axis[1] = y / magn; axis[2] = z / magn;
+		}
+
+		// extremes along the axis become the endpoints
+		float minT = FLT_MAX, maxT = -FLT_MAX;
+		for (UINT i = 0u; i < 16u; i++) {
+			const float t = (pTexels[i * 4u + 0u] - mean[0]) * axis[0] + (pTexels[i * 4u + 1u] - mean[1]) * axis[1] + (pTexels[i * 4u + 2u] - mean[2]) * axis[2];
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+		const float axisLenSq = std::max(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2], 1e-6f);
+		float e0[3], e1[3];
+		for (UINT c = 0u; c < 3u; c++) {
+			e0[c] = mean[c] + axis[c] * maxT / axisLenSq;
+			e1[c] = mean[c] + axis[c] * minT / axisLenSq;
+		}
+
+		uint16_t c0 = PackRGB565(e0), c1 = PackRGB565(e1);
+		uint32_t indices = FindColorIndices(pTexels, c0, c1);
+
+		// least squares refinement of the endpoints for the chosen indices
+		{
+			static constexpr float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+			float aa = 0.0f, bb = 0.0f, ab = 0.0f, ax[3] = {}, bx[3] = {};
+			for (UINT i = 0u; i < 16u; i++) {
+				const float w = weights[(indices >> (i * 2u)) & 3u];
+				const float a = 1.0f - w, b = w;
+				aa += a * a; bb += b * b; ab += a * b;
+				for (UINT c = 0u; c < 3u; c++) {
+					ax[c] += a * pTexels[i * 4u + c];
+					bx[c] += b * pTexels[i * 4u + c];
+				}
+			}
+			const float det = aa * bb - ab * ab;
+			if (std::abs(det) > 1e-6f) {
+				for (UINT c = 0u; c < 3u; c++) {
+					e0[c] = (ax[c] * bb - bx[c] * ab) / det;
+					e1[c] = (bx[c] * aa - ax[c] * ab) / det;
+				}
+				c0 = PackRGB565(e0);
+				c1 = PackRGB565(e1);
+			}
+		}
+
+		// always encodes opaque 4-color blocks, which requires c0 > c1 (identical endpoints only use index 0)
+		if (c0 < c1) std::swap(c0, c1);
+		indices = c0 == c1 ? 0u : FindColorIndices(pTexels, c0, c1);
+
+		pBlock[0] = static_cast<BYTE>(c0 & 0xFFu);
+		pBlock[1] = static_cast<BYTE>(c0 >> 8u);
+		pBlock[2] = static_cast<BYTE>(c1 & 0xFFu);
+		pBlock[3] = static_cast<BYTE>(c1 >> 8u);
+		for (UINT i = 0u; i < 4u; i++) pBlock[4u + i] = static_cast<BYTE>(indices >> (i * 8u));
+	}
+	static uint32_t FindColorIndices(const BYTE* const pTexels, uint16_t c0, uint16_t c1)
+	{
+		BYTE palette[4][3];
+		BuildPalette(c0, c1, true, palette);
+
+		uint32_t indices = 0u;
+		for (UINT i = 0u; i < 16u; i++) {
+			UINT iBest = 0u;
+			int bestDist = INT_MAX;
+			for (UINT p = 0u; p < 4u; p++) {
+				int dist = 0;
+				for (UINT c = 0u; c < 3u; c++) {
+					const int d = static_cast<int>(pTexels[i * 4u + c]) - palette[p][c];
+					dist += d * d;
+				}
+				if (dist < bestDist) {
+					bestDist = dist;
+					iBest = p;
+				}
+			}
+			indices |= iBest << (i * 2u);
+		}
+		return indices;
+	}
+	static void DecodeColor(const BYTE* const pBlock, BYTE* const pTexels, bool bAllowPunchThrough)
+	{
+		const uint16_t c0 = static_cast<uint16_t>(pBlock[0] | (pBlock[1] << 8u));
+		const uint16_t c1 = static_cast<uint16_t>(pBlock[2] | (pBlock[3] << 8u));
+		const bool bFourColor = !bAllowPunchThrough || c0 > c1;
+
+		BYTE palette[4][3];
+		BuildPalette(c0, c1, bFourColor, palette);
+
+		const uint32_t indices = pBlock[4] | (pBlock[5] << 8u) | (pBlock[6] << 16u) | (static_cast<uint32_t>(pBlock[7]) << 24u);
+		for (UINT i = 0u; i < 16u; i++) {
+			const UINT index = (indices >> (i * 2u)) & 3u;
+			for (UINT c = 0u; c < 3u; c++) pTexels[i * 4u + c] = palette[index][c];
+			pTexels[i * 4u + 3u] = (!bFourColor && index == 3u) ? 0u : UCHAR_MAX;
+		}
+	}
+	static void BuildPalette(uint16_t c0, uint16_t c1, bool bFourColor, BYTE palette[4][3])
+	{
+		UnpackRGB565(c0, palette[0]);
+		UnpackRGB565(c1, palette[1]);
+		for (UINT c = 0u; c < 3u; c++) {
+			if (bFourColor) {
+				palette[2][c] = static_cast<BYTE>((2u * palette[0][c] + palette[1][c] + 1u) / 3u);
+				palette[3][c] = static_cast<BYTE>((palette[0][c] + 2u * palette[1][c] + 1u) / 3u);
+			}
+			else {
+				palette[2][c] = static_cast<BYTE>((palette[0][c] + palette[1][c]) / 2u);
+				palette[3][c] = 0u;
+			}
+		}
+	}
+	static inline uint16_t PackRGB565(const float rgb[3])
+	{
+		const UINT r = static_cast<UINT>(std::clamp(rgb[0] * 31.0f / 255.0f + .5f, 0.0f, 31.0f));
+		const UINT g = static_cast<UINT>(std::clamp(rgb[1] * 63.0f / 255.0f + .5f, 0.0f, 63.0f));
+		const UINT b = static_cast<UINT>(std::clamp(rgb[2] * 31.0f / 255.0f + .5f, 0.0f, 31.0f));
+		return static_cast<uint16_t>((r << 11u) | (g << 5u) | b);
+	}
+	static inline void UnpackRGB565(uint16_t col, BYTE rgb[3])
+	{
+		const UINT r = (col >> 11u) & 31u, g = (col >> 5u) & 63u, b = col & 31u;
+		rgb[0] = static_cast<BYTE>((r << 3u) | (r >> 2u));
+		rgb[1] = static_cast<BYTE>((g << 2u) | (g >> 4u));
+		rgb[2] = static_cast<BYTE>((b << 3u) | (b >> 2u));
+	}
+
+	// BC3 alpha, always using the 8-value interpolation mode
+	static void EncodeAlpha(const BYTE* const pTexels, BYTE* const pBlock)
+	{
+		BYTE a0 = 0u, a1 = UCHAR_MAX;
+		for (UINT i = 0u; i < 16u; i++) {
+			a0 = std::max(a0, pTexels[i * 4u + 3u]);
+			a1 = std::min(a1, pTexels[i * 4u + 3u]);
+		}
+		pBlock[0] = a0;
+		pBlock[1] = a1;
+
+		BYTE palette[8];
+		BuildAlphaPalette(a0, a1, palette);
+		uint64_t indices = 0u;
+		if (a0 != a1) {
+			for (UINT i = 0u; i < 16u; i++) {
+				UINT iBest = 0u;
+				int bestDist = INT_MAX;
+				for (UINT p = 0u; p < 8u; p++) {
+					const int dist = std::abs(static_cast<int>(pTexels[i * 4u + 3u]) - palette[p]);
+					if (dist < bestDist) {
+						bestDist = dist;
+						iBest = p;
+					}
+				}
+				indices |= static_cast<uint64_t>(iBest) << (i * 3u);
+			}
+		}
+		for (UINT i = 0u; i < 6u; i++) pBlock[2u + i] = static_cast<BYTE>(indices >> (i * 8u));
+	}
+	static void DecodeAlpha(const BYTE* const pBlock, BYTE* const pTexels)
+	{
+		BYTE palette[8];
+		BuildAlphaPalette(pBlock[0], pBlock[1], palette);
+
+		uint64_t indices = 0u;
+		for (UINT i = 0u; i < 6u; i++) indices |= static_cast<uint64_t>(pBlock[2u + i]) << (i * 8u);
+		for (UINT i = 0u; i < 16u; i++) pTexels[i * 4u + 3u] = palette[(indices >> (i * 3u)) & 7u];
+	}
+	static void BuildAlphaPalette(BYTE a0, BYTE a1, BYTE palette[8])
+	{
+		palette[0] = a0;
+		palette[1] = a1;
+		if (a0 > a1) {
+			for (UINT i = 1u; i < 7u; i++) palette[i + 1u] = static_cast<BYTE>(((7u - i) * a0 + i * a1 + 3u) / 7u);
+		}
+		else {
+			for (UINT i = 1u; i < 5u; i++) palette[i + 1u] = static_cast<BYTE>(((5u - i) * a0 + i * a1 + 2u) / 5u);
+			palette[6] = 0u;
+			palette[7] = UCHAR_MAX;
+		}
+	}
+
+	// BC7 mode 6: single subset, rgba 7.7.7.7 endpoints with unique p-bits, 4-bit indices
+	static void EncodeBC7Mode6(const BYTE* const pTexels, BYTE* const pBlock)
+	{
+		float mean[4] = {};
+		for (UINT i = 0u; i < 16u; i++) for (UINT c = 0u; c < 4u; c++) mean[c] += pTexels[i * 4u + c];
+		for (UINT c = 0u; c < 4u; c++) mean[c] /= 16.0f;
+
+		// principal axis in rgba via power iteration
+		float cov[4][4] = {};
+		for (UINT i = 0u; i < 16u; i++) {
+			float d[4];
+			for (UINT c = 0u; c < 4u; c++) d[c] = pTexels[i * 4u + c] - mean[c];
+			for (UINT r = 0u; r < 4u; r++) for (UINT c = 0u; c < 4u; c++) cov[r][c] += d[r] * d[c];
+		}
+		float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		for (UINT iter = 0u; iter < 4u; iter++) {
+			float next[4] = {};
+			for (UINT r = 0u; r < 4u; r++) for (UINT c = 0u; c < 4u; c++) next[r] += cov[r][c] * axis[c];
+			const float magn = std::max({ std::abs(next[0]), std::abs(next[1]), std::abs(next[2]), std::abs(next[3]) });
+			if (magn < 1e-6f) break;
+			for (UINT c = 0u; c < 4u; c++) axis[c] = next[c] / magn;
+		}
+		float minT = FLT_MAX, maxT = -FLT_MAX;
+		for (UINT i = 0u; i < 16u; i++) {
+			float t = 0.0f;
+			for (UINT c = 0u; c < 4u; c++) t += (pTexels[i * 4u + c] - mean[c]) * axis[c];
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+		float axisLenSq = 0.0f;
+		for (UINT c = 0u; c < 4u; c++) axisLenSq += axis[c] * axis[c];
+		axisLenSq = std::max(axisLenSq, 1e-6f);
+
+		// quantize endpoints to 7 bits plus the p-bit that fits best
+		UINT q[2][4], p[2];
+		BYTE e[2][4];
+		for (UINT iEnd = 0u; iEnd < 2u; iEnd++) {
+			float target[4];
+			for (UINT c = 0u; c < 4u; c++) target[c] = std::clamp(mean[c] + axis[c] * (iEnd == 0u ? minT : maxT) / axisLenSq, 0.0f, 255.0f);
+
+			float bestErr = FLT_MAX;
+			for (UINT pBit = 0u; pBit < 2u; pBit++) {
+				UINT cand[4];
+				float err = 0.0f;
+				for (UINT c = 0u; c < 4u; c++) {
+					cand[c] = static_cast<UINT>(std::clamp((target[c] - pBit) / 2.0f + .5f, 0.0f, 127.0f));
+					const float d = target[c] - static_cast<float>((cand[c] << 1u) | pBit);
+					err += d * d;
+				}
+				if (err < bestErr) {
+					bestErr = err;
+					p[iEnd] = pBit;
+					for (UINT c = 0u; c < 4u; c++) q[iEnd][c] = cand[c];
+				}
+			}
+			for (UINT c = 0u; c < 4u; c++) e[iEnd][c] = static_cast<BYTE>((q[iEnd][c] << 1u) | p[iEnd]);
+		}
+
+		// nearest interpolation weight per texel
+		UINT indices[16];
+		for (UINT i = 0u; i < 16u; i++) {
+			UINT iBest = 0u;
+			int bestDist = INT_MAX;
+			for (UINT w = 0u; w < 16u; w++) {
+				int dist = 0;
+				for (UINT c = 0u; c < 4u; c++) {
+					const int d = static_cast<int>(pTexels[i * 4u + c]) - Interpolate(e[0][c], e[1][c], bc7Weights[w]);
+					dist += d * d;
+				}
+				if (dist < bestDist) {
+					bestDist = dist;
+					iBest = w;
+				}
+			}
+			indices[i] = iBest;
+		}
+
+		// anchor index must have its msb cleared, swap endpoints otherwise
+		if (indices[0] & 8u) {
+			for (UINT c = 0u; c < 4u; c++) std::swap(q[0][c], q[1][c]);
+			std::swap(p[0], p[1]);
+			for (UINT i = 0u; i < 16u; i++) indices[i] = 15u - indices[i];
+		}
+
+		BitWriter writer(pBlock);
+		writer.Write(1u << 6u, 7u); // mode 6
+		for (UINT c = 0u; c < 4u; c++) {
+			writer.Write(q[0][c], 7u);
+			writer.Write(q[1][c], 7u);
+		}
+		writer.Write(p[0], 1u);
+		writer.Write(p[1], 1u);
+		writer.Write(indices[0], 3u);
+		for (UINT i = 1u; i < 16u; i++) writer.Write(indices[i], 4u);
+	}
+	static bool DecodeBC7Mode6(const BYTE* const pBlock, BYTE* const pTexels)
+	{
+		BitReader reader(pBlock);
+		if (reader.Read(7u) != (1u << 6u)) {
+			for (UINT i = 0u; i < 16u; i++) {
+				pTexels[i * 4u + 0u] = UCHAR_MAX;
+				pTexels[i * 4u + 1u] = 0u;
+				pTexels[i * 4u + 2u] = UCHAR_MAX;
+				pTexels[i * 4u + 3u] = UCHAR_MAX;
+			}
+			return false;
+		}
+
+		UINT q[2][4];
+		for (UINT c = 0u; c < 4u; c++) {
+			q[0][c] = reader.Read(7u);
+			q[1][c] = reader.Read(7u);
+		}
+		const UINT p0 = reader.Read(1u), p1 = reader.Read(1u);
+		BYTE e[2][4];
+		for (UINT c = 0u; c < 4u; c++) {
+			e[0][c] = static_cast<BYTE>((q[0][c] << 1u) | p0);
+			e[1][c] = static_cast<BYTE>((q[1][c] << 1u) | p1);
+		}
+		for (UINT i = 0u; i < 16u; i++) {
+			const UINT index = reader.Read(i == 0u ? 3u : 4u);
+			for (UINT c = 0u; c < 4u; c++) pTexels[i * 4u + c] = static_cast<BYTE>(Interpolate(e[0][c], e[1][c], bc7Weights[index]));
+		}
+		return true;
+	}
+	static inline int Interpolate(BYTE e0, BYTE e1, UINT weight)
+	{
+		return static_cast<int>(((64u - weight) * e0 + weight * e1 + 32u) >> 6u);
+	}
+
+	// lsb-first bit packing as used by bc7
+	struct BitWriter
+	{
+		BitWriter(BYTE* const pData) : pData(pData) { std::fill(pData, pData + 16u, BYTE(0u)); }
+		void Write(UINT value, UINT nBits)
+		{
+			for (UINT i = 0u; i < nBits; i++, pos++) {
+				if ((value >> i) & 1u) pData[pos >> 3u] |= static_cast<BYTE>(1u << (pos & 7u));
+			}
+		}
+		BYTE* const pData;
+		UINT pos = 0u;
+	};
+	struct BitReader
+	{
+		BitReader(const BYTE* const pData) : pData(pData) {}
+		UINT Read(UINT nBits)
+		{
+			UINT value = 0u;
+			for (UINT i = 0u; i < nBits; i++, pos++) value |= ((pData[pos >> 3u] >> (pos & 7u)) & 1u) << i;
+			return value;
+		}
+		const BYTE* const pData;
+		UINT pos = 0u;
+	};
+
+private:
+	static constexpr UINT bc7Weights[16] = { 0u, 4u, 9u, 13u, 17u, 21u, 26u, 30u, 34u, 38u, 43u, 47u, 51u, 55u, 60u, 64u };
+};
\ No newline at end of file
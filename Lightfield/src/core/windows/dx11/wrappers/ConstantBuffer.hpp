@@ -38,6 +38,7 @@ public:
 		// Create the buffer.
 		HRESULT hr = pDevice->CreateBuffer(&cbDesc, &initData, pBuffer.GetAddressOf());
 		if (FAILED(hr)) throw std::runtime_error("Could not create constant buffer");
+		memory.Track(MemoryTag::eConstantBuffers, sizeof(BufferStruct));
 	}
 
 	inline void Update(ID3D11DeviceContext* const pDeviceContext)
@@ -65,5 +66,6 @@ public:
 private:
 	struct alignas(16) BufferStruct { BufferType data; } bufferStruct; // 16-byte aligned
 	Microsoft::WRL::ComPtr<ID3D11Buffer> pBuffer;
+	TrackedMemory memory;
 };
 typedef ConstantBuffer<DirectX::XMMATRIX> ConstantBufferMat;
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "TexFormatConverter.hpp"
+
 class DepthStencil
 {
 public:
@@ -7,7 +9,7 @@ public:
 	~DepthStencil() = default;
 	ROF_DELETE(DepthStencil);
 
-	void Init(ID3D11Device* const pDevice, UINT width, UINT height)
+	void Init(ID3D11Device* const pDevice, UINT width, UINT height, MemoryTag tag = MemoryTag::eRenderTargets)
 	{
 
 		HRESULT hr;
@@ -24,7 +26,9 @@ public:
 			descDepth.SampleDesc.Quality = 0u;
 			descDepth.Usage = D3D11_USAGE_DEFAULT;
 			descDepth.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE; // for write and read
-			pDevice->CreateTexture2D(&descDepth, nullptr, &pDepthStencilTex);
+			hr = pDevice->CreateTexture2D(&descDepth, nullptr, &pDepthStencilTex);
+			if (FAILED(hr)) throw std::runtime_error("Depth stencil texture creation failed");
+			memory.Track(tag, TexFormatConverter::GetTextureSize(descDepth));
 		}
 
 		// create view of depth stensil texture
@@ -77,4 +81,5 @@ private:
 
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilView>	pDepthStencilView;
 	Microsoft::WRL::ComPtr<ID3D11Texture2D> pDepthStencilTex;
+	TrackedMemory memory;
 };
\ No newline at end of file
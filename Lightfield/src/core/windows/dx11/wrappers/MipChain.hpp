@@ -0,0 +1,120 @@
+#pragma once
+
+// builds a full mip chain for 8-bit four channel textures on the cpu
+// filtering happens in linear space, so srgb-encoded color data does not darken towards the smaller levels
+class MipChain
+{
+public:
+	struct Level
+	{
+		UINT width, height;
+		std::vector<BYTE> data; // tightly packed, 4 bytes per texel
+	};
+
+public:
+	MipChain(const BYTE* const pData, UINT width, UINT height, bool bSRGB = true) : bSRGB(bSRGB)
+	{
+		levels.resize(CalcLevelCount(width, height));
+		levels.front().width = width;
+		levels.front().height = height;
+		levels.front().data.assign(pData, pData + static_cast<size_t>(width) * height * texelSize);
+
+		// decode base level once, every further level gets filtered from the previous linear float level
+		// the float levels are scratch in the arena, only the encoded levels outlive the constructor
+		ScopedArena arena;
+		ArenaVector<DirectX::XMFLOAT4A> src(static_cast<size_t>(width) * height), dst;
+		ParallelFor(0u, height, [&](size_t y) {
+			const BYTE* pRow = pData + y * width * texelSize;
+			for (size_t x = 0u; x < width; x++) {
+				DirectX::XMStoreFloat4A(&src[y * width + x], Decode(pRow + x * texelSize));
+			}
+		});
+
+		for (size_t i = 1u; i < levels.size(); i++) {
+			const Level& prev = levels[i - 1u];
+			Level& cur = levels[i];
+			cur.width = std::max(prev.width / 2u, 1u);
+			cur.height = std::max(prev.height / 2u, 1u);
+			cur.data.resize(static_cast<size_t>(cur.width) * cur.height * texelSize);
+			dst.resize(static_cast<size_t>(cur.width) * cur.height);
+
+			ParallelFor(0u, cur.height, [&](size_t y) {
+				// clamp sample rows/columns for odd or 1-texel dimensions
+				const size_t y0 = std::min<size_t>(y * 2u, prev.height - 1u) * prev.width;
+				const size_t y1 = std::min<size_t>(y * 2u + 1u, prev.height - 1u) * prev.width;
+				for (size_t x = 0u; x < cur.width; x++) {
+					const size_t x0 = std::min<size_t>(x * 2u, prev.width - 1u);
+					const size_t x1 = std::min<size_t>(x * 2u + 1u, prev.width - 1u);
+
+					// 2x2 box filter
+					DirectX::XMVECTOR sum = DirectX::XMVectorAdd(
+						DirectX::XMVectorAdd(DirectX::XMLoadFloat4A(&src[y0 + x0]), DirectX::XMLoadFloat4A(&src[y0 + x1])),
+						DirectX::XMVectorAdd(DirectX::XMLoadFloat4A(&src[y1 + x0]), DirectX::XMLoadFloat4A(&src[y1 + x1])));
+					sum = DirectX::XMVectorScale(sum, .25f);
+
+					DirectX::XMStoreFloat4A(&dst[y * cur.width + x], sum);
+					Encode(sum, &cur.data[(y * cur.width + x) * texelSize]);
+				}
+			});
+			std::swap(src, dst);
+		}
+	}
+	~MipChain() = default;
+	ROF_DELETE(MipChain);
+
+public:
+	static inline UINT CalcLevelCount(UINT width, UINT height)
+	{
+		UINT nLevels = 1u;
+		for (UINT size = std::max(width, height); size > 1u; size >>= 1u) nLevels++;
+		return nLevels;
+	}
+	// only plain 8-bit four channel formats are filtered, everything else keeps a single level
+	static inline bool IsSupportedFormat(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+			case DXGI_FORMAT_R8G8B8A8_UNORM:
+			case DXGI_FORMAT_B8G8R8A8_UNORM:
+			case DXGI_FORMAT_B8G8R8X8_UNORM:
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	// subresource data for all levels, ready for texture creation
+	std::vector<D3D11_SUBRESOURCE_DATA> GetSubresourceData() const
+	{
+		std::vector<D3D11_SUBRESOURCE_DATA> subresources(levels.size());
+		for (size_t i = 0u; i < levels.size(); i++) {
+			subresources[i].pSysMem = levels[i].data.data();
+			subresources[i].SysMemPitch = levels[i].width * texelSize;
+			subresources[i].SysMemSlicePitch = levels[i].width * levels[i].height * texelSize;
+		}
+		return subresources;
+	}
+	inline UINT GetLevelCount() const { return static_cast<UINT>(levels.size()); }
+	inline const Level& GetLevel(UINT i) const { return levels[i]; }
+
+private:
+	inline DirectX::XMVECTOR Decode(const BYTE* const pTexel) const
+	{
+		DirectX::XMVECTOR col = DirectX::PackedVector::XMLoadUByteN4(reinterpret_cast<const DirectX::PackedVector::XMUBYTEN4*>(pTexel));
+		if (bSRGB) col = DirectX::XMColorSRGBToRGB(col); // alpha stays linear
+		return col;
+	}
+	inline void Encode(DirectX::FXMVECTOR linear, BYTE* const pTexel) const
+	{
+		DirectX::XMVECTOR col = bSRGB ? DirectX::XMColorRGBToSRGB(linear) : linear;
+
+		// round to nearest instead of truncating
+		col = DirectX::XMVectorMultiplyAdd(DirectX::XMVectorSaturate(col), DirectX::XMVectorReplicate(255.0f), DirectX::XMVectorReplicate(.5f));
+		DirectX::PackedVector::XMStoreUByte4(reinterpret_cast<DirectX::PackedVector::XMUBYTE4*>(pTexel), col);
+	}
+
+private:
+	static constexpr UINT texelSize = 4u;
+	const bool bSRGB;
+	std::vector<Level> levels;
+};
\ No newline at end of file
@@ -117,6 +117,14 @@ void Shader<ID3D11GeometryShader>::Bind(ID3D11DeviceContext* const pDeviceContex
 	if (cbs.size() > 0) pDeviceContext->GSSetConstantBuffers(0u, static_cast<UINT>(cbs.size()), cbs.data());
 	if (srvs.size() > 0) pDeviceContext->GSSetShaderResources(0u, static_cast<UINT>(srvs.size()), srvs.data());
 }
+template<>
+void Shader<ID3D11ComputeShader>::Bind(ID3D11DeviceContext* const pDeviceContext) const
+{
+	pDeviceContext->CSSetShader(pShader, nullptr, 0u);
+
+	if (cbs.size() > 0) pDeviceContext->CSSetConstantBuffers(0u, static_cast<UINT>(cbs.size()), cbs.data());
+	if (srvs.size() > 0) pDeviceContext->CSSetShaderResources(0u, static_cast<UINT>(srvs.size()), srvs.data());
+}
 
 // shader and resource unbinding
 template<>
@@ -143,6 +151,14 @@ void Shader<ID3D11GeometryShader>::Unbind(ID3D11DeviceContext* const pDeviceCont
 	if (nullCBs.size() > 0) pDeviceContext->PSSetConstantBuffers(0u, static_cast<UINT>(nullCBs.size()), nullCBs.data());
 	if (nullSRVs.size() > 0) pDeviceContext->PSSetShaderResources(0u, static_cast<UINT>(nullSRVs.size()), nullSRVs.data());
 }
+template<>
+void Shader<ID3D11ComputeShader>::Unbind(ID3D11DeviceContext* const pDeviceContext) const
+{
+	pDeviceContext->CSSetShader(nullptr, nullptr, 0u);
+
+	if (nullCBs.size() > 0) pDeviceContext->CSSetConstantBuffers(0u, static_cast<UINT>(nullCBs.size()), nullCBs.data());
+	if (nullSRVs.size() > 0) pDeviceContext->CSSetShaderResources(0u, static_cast<UINT>(nullSRVs.size()), nullSRVs.data());
+}
 
 template<class T>
 void Shader<T>::CreateInputLayout(ID3D11Device* const pDevice, LPCVOID bufferPointer, SIZE_T bufferSize)
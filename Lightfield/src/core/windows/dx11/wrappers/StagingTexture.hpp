@@ -0,0 +1,94 @@
+#pragma once
+
+// cpu-readable copy target for reading back single texture subresources
+// the staging texture is created on first use and reused for as long as the source layout matches
+class StagingTexture
+{
+public:
+	StagingTexture() = default;
+	~StagingTexture() = default;
+	ROF_DELETE(StagingTexture);
+
+public:
+	// split readback: copy now and read a few frames later, by which point the gpu has long finished the copy
+	// mapping right after the copy would stall the cpu until the whole frame ran on the gpu
+	void Copy(ID3D11DeviceContext* const pDeviceContext, ID3D11Texture2D* const pSource, UINT iArraySlice = 0u)
+	{
+		D3D11_TEXTURE2D_DESC srcDesc;
+		pSource->GetDesc(&srcDesc);
+		Prepare(pSource, srcDesc);
+
+		// copy mip 0 of the requested slice
+		pDeviceContext->CopySubresourceRegion(pStaging.Get(), 0u, 0u, 0u, 0u, pSource, D3D11CalcSubresource(0u, iArraySlice, srcDesc.MipLevels), nullptr);
+	}
+	// maps the last copy, reuses the image memory if it already has the right size
+	void Read(ID3D11DeviceContext* const pDeviceContext, Image& image)
+	{
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		HRESULT hr = pDeviceContext->Map(pStaging.Get(), 0u, D3D11_MAP_READ, 0u, &mapped);
+		if (FAILED(hr)) throw std::runtime_error("Could not map staging texture");
+
+		image.width = desc.Width;
+		image.height = desc.Height;
+		image.format = GetImageFormat(desc.Format);
+		const UINT rowPitch = image.GetRowPitch();
+		image.data.resize(static_cast<size_t>(rowPitch) * image.height);
+		for (UINT y = 0u; y < image.height; y++) {
+			memcpy(&image.data[static_cast<size_t>(y) * rowPitch], static_cast<const BYTE*>(mapped.pData) + static_cast<size_t>(y) * mapped.RowPitch, rowPitch);
+		}
+		pDeviceContext->Unmap(pStaging.Get(), 0u);
+	}
+	// cpu image matching a source texture, without data
+	static Image GetLayout(ID3D11Texture2D* const pSource)
+	{
+		D3D11_TEXTURE2D_DESC srcDesc;
+		pSource->GetDesc(&srcDesc);
+
+		Image image;
+		image.width = srcDesc.Width;
+		image.height = srcDesc.Height;
+		image.format = GetImageFormat(srcDesc.Format);
+		return image;
+	}
+
+	static Image::Format GetImageFormat(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+			case DXGI_FORMAT_B8G8R8A8_UNORM: return Image::Format::eBGRA8;
+			case DXGI_FORMAT_R16_UNORM: return Image::Format::eR16Unorm;
+			case DXGI_FORMAT_R16_FLOAT: return Image::Format::eR16Float;
+			case DXGI_FORMAT_R32_FLOAT: return Image::Format::eR32Float;
+			case DXGI_FORMAT_R32G32B32A32_FLOAT: return Image::Format::eR32G32B32A32Float;
+			default: throw std::runtime_error("Texture format not supported for readback");
+		}
+	}
+
+private:
+	void Prepare(ID3D11Texture2D* const pSource, const D3D11_TEXTURE2D_DESC& srcDesc)
+	{
+		if (pStaging && desc.Width == srcDesc.Width && desc.Height == srcDesc.Height && desc.Format == srcDesc.Format) return;
+
+		desc = {};
+		desc.Width = srcDesc.Width;
+		desc.Height = srcDesc.Height;
+		desc.MipLevels = 1u;
+		desc.ArraySize = 1u;
+		desc.Format = srcDesc.Format;
+		desc.SampleDesc.Count = 1u;
+		desc.Usage = D3D11_USAGE_STAGING;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+		Microsoft::WRL::ComPtr<ID3D11Device> pDevice;
+		pSource->GetDevice(pDevice.GetAddressOf());
+		pStaging.Reset();
+		HRESULT hr = pDevice->CreateTexture2D(&desc, nullptr, pStaging.GetAddressOf());
+		if (FAILED(hr)) throw std::runtime_error("Staging texture creation failed");
+		memory.Track(MemoryTag::eReadback, TexFormatConverter::GetTextureSize(desc));
+	}
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> pStaging;
+	D3D11_TEXTURE2D_DESC desc = {};
+	TrackedMemory memory;
+};
\ No newline at end of file
@@ -106,6 +106,70 @@ public:
         return DXGI_FORMAT_UNKNOWN;
     }
 
+    // bits per texel, block compressed formats report their average
+    [[nodiscard]] static constexpr UINT GetBitsPerPixel(DXGI_FORMAT format) noexcept
+    {
+        switch (format)
+        {
+            case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            case DXGI_FORMAT_R32G32B32A32_UINT:
+                return 128u;
+            case DXGI_FORMAT_R16G16B16A16_FLOAT:
+            case DXGI_FORMAT_R16G16B16A16_UNORM:
+            case DXGI_FORMAT_R32G32_FLOAT:
+                return 64u;
+            case DXGI_FORMAT_R8G8B8A8_UNORM:
+            case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+            case DXGI_FORMAT_B8G8R8A8_UNORM:
+            case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+            case DXGI_FORMAT_B8G8R8X8_UNORM:
+            case DXGI_FORMAT_R10G10B10A2_UNORM:
+            case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
+            case DXGI_FORMAT_R16G16_FLOAT:
+            case DXGI_FORMAT_R32_FLOAT:
+            case DXGI_FORMAT_R32_UINT:
+            case DXGI_FORMAT_R24G8_TYPELESS:
+            case DXGI_FORMAT_D24_UNORM_S8_UINT:
+            case DXGI_FORMAT_D32_FLOAT:
+                return 32u;
+            case DXGI_FORMAT_R16_FLOAT:
+            case DXGI_FORMAT_R16_UNORM:
+            case DXGI_FORMAT_B5G5R5A1_UNORM:
+            case DXGI_FORMAT_B5G6R5_UNORM:
+            case DXGI_FORMAT_D16_UNORM:
+                return 16u;
+            case DXGI_FORMAT_R8_UNORM:
+            case DXGI_FORMAT_A8_UNORM:
+            case DXGI_FORMAT_BC2_UNORM:
+            case DXGI_FORMAT_BC3_UNORM:
+            case DXGI_FORMAT_BC5_UNORM:
+            case DXGI_FORMAT_BC7_UNORM:
+                return 8u;
+            case DXGI_FORMAT_BC1_UNORM:
+            case DXGI_FORMAT_BC4_UNORM:
+                return 4u;
+            default:
+                return 32u; // conservative guess for anything not listed
+        }
+    }
+    // memory footprint of a texture including all mips and array slices, ignoring driver padding
+    [[nodiscard]] static size_t GetTextureSize(const D3D11_TEXTURE2D_DESC& desc) noexcept
+    {
+        const bool bBlockCompressed = (desc.Format >= DXGI_FORMAT_BC1_TYPELESS && desc.Format <= DXGI_FORMAT_BC5_SNORM)
+            || (desc.Format >= DXGI_FORMAT_BC6H_TYPELESS && desc.Format <= DXGI_FORMAT_BC7_UNORM_SRGB);
+        size_t size = 0u;
+        for (UINT i = 0u; i < std::max(desc.MipLevels, 1u); i++) {
+            UINT width = std::max(desc.Width >> i, 1u);
+            UINT height = std::max(desc.Height >> i, 1u);
+            if (bBlockCompressed) {
+                width = (width + 3u) & ~3u;
+                height = (height + 3u) & ~3u;
+            }
+            size += static_cast<size_t>(width) * height * GetBitsPerPixel(desc.Format) / 8u;
+        }
+        return size * desc.ArraySize * std::max(desc.SampleDesc.Count, 1u);
+    }
+
 private:
     struct GUIDHash {
         inline std::size_t operator()(const WICPixelFormatGUID& guid) const noexcept {
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "TexFormatConverter.hpp"
+#include "MipChain.hpp"
+#include "TextureCompressor.hpp"
 
 class TextureBase
 {
@@ -57,6 +59,16 @@ public:
 public:
 	void CreateTextureFromJPG(ID3D11Device* const pDevice, std::wstring filepath)
 	{
+		// previously imported textures come straight from the block compressed cache
+		auto& compressor = TextureCompressor::Get();
+		if (compressor.bEnabled) {
+			auto cached = compressor.LoadCached(filepath);
+			if (cached.has_value()) {
+				CreateTextureFromBlocks(pDevice, cached.value());
+				return;
+			}
+		}
+
 		Microsoft::WRL::ComPtr<IWICImagingFactory> pImgFactory;
 		HRESULT hr = CoCreateInstance(
 			CLSID_WICImagingFactory,
@@ -103,7 +115,12 @@ public:
 		pFrame->GetSize(&width, &height);
 		UINT rowStride = stride * width;
 		UINT totalStride = rowStride * height;
-		std::vector<BYTE> buffer(totalStride);
+
+		// decoded pixels are scratch of the loading job, sized for the padded format so no second copy is needed
+		ScopedArena arena;
+		ArenaVector<BYTE> buffer;
+		buffer.reserve(static_cast<size_t>(std::max(stride, 4u)) * width * height);
+		buffer.resize(totalStride);
 		hr = pFrame->CopyPixels(NULL, rowStride, totalStride, buffer.data());
 		if (FAILED(hr)) throw std::runtime_error("Failed copying image data to memory");
 
@@ -114,29 +131,44 @@ public:
 			stride = 4u;
 			rowStride = stride * width;
 			totalStride = rowStride * height;
-
-			// copy original buffer into seperate vector for iteration
-			// then resize new vector according to new strides
-			std::vector<BYTE> cpy(buffer);
 			buffer.resize(totalStride);
-			auto* curCpy = cpy.begin()._Ptr;
-			auto* cur = buffer.begin()._Ptr;
-			auto* end = buffer.end()._Ptr;
-
-			// insert padding to match dx11 format
-			while (cur < end) {
-				*cur++ = *curCpy++; // r or b
-				*cur++ = *curCpy++; // g
-				*cur++ = *curCpy++; // b or r
-				*cur++ = UCHAR_MAX;	// a
+
+			// insert padding to match dx11 format, back to front so no pixel is overwritten before it was moved
+			const BYTE* curSrc = buffer.data() + static_cast<size_t>(width) * height * 3u;
+			BYTE* cur = buffer.data() + totalStride;
+			while (cur > buffer.data()) {
+				*--cur = UCHAR_MAX; // a
+				*--cur = *--curSrc; // b or r
+				*--cur = *--curSrc; // g
+				*--cur = *--curSrc; // r or b
 			}
 		}
 
+		// build mip chain on the cpu for formats that support it, otherwise keep the single level
+		std::optional<MipChain> mipChain;
+		std::vector<D3D11_SUBRESOURCE_DATA> initData;
+		if (MipChain::IsSupportedFormat(format)) {
+			mipChain.emplace(buffer.data(), width, height);
+
+			// import step: encode every level into blocks and cache them for the next run
+			if (compressor.bEnabled && TextureCompressor::IsCompressible(format, width, height)) {
+				const auto image = compressor.Compress(mipChain.value(), format);
+				compressor.SaveCached(filepath, image);
+				CreateTextureFromBlocks(pDevice, image);
+				return;
+			}
+			initData = mipChain->GetSubresourceData();
+		}
+		else {
+			initData.push_back({ buffer.data(), rowStride, totalStride });
+		}
+		const UINT nMipLevels = static_cast<UINT>(initData.size());
+
 		// Create texture
 		D3D11_TEXTURE2D_DESC desc;
 		desc.Width = width;
 		desc.Height = height;
-		desc.MipLevels = 1;
+		desc.MipLevels = nMipLevels;
 		desc.ArraySize = 1;
 		desc.Format = format;
 		desc.SampleDesc.Count = 1;
@@ -145,30 +177,62 @@ public:
 		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 		desc.CPUAccessFlags = 0;
 		desc.MiscFlags = 0;
+		CreateTexture(pDevice, desc, initData.data(), MemoryTag::eTextures);
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = format;
+		srvDesc.Texture2D.MipLevels = nMipLevels;
+		srvDesc.Texture2D.MostDetailedMip = 0u;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		CreateSRV(pDevice, srvDesc);
+	}
+	void CreateTextureFromBlocks(ID3D11Device* const pDevice, const TextureCompressor::CompressedImage& image)
+	{
+		const DXGI_FORMAT format = TextureCompressor::GetDXGIFormat(image.format);
+		const UINT blockSize = BlockCompressor::GetBlockSize(image.format);
+		const UINT nMipLevels = static_cast<UINT>(image.levels.size());
+
+		// row pitch of block compressed data covers one row of 4x4 blocks
+		std::vector<D3D11_SUBRESOURCE_DATA> initData(nMipLevels);
+		for (UINT i = 0u; i < nMipLevels; i++) {
+			const UINT levelWidth = std::max(image.width >> i, 1u);
+			const UINT levelHeight = std::max(image.height >> i, 1u);
+			initData[i].pSysMem = image.levels[i].data();
+			initData[i].SysMemPitch = ((levelWidth + 3u) / 4u) * blockSize;
+			initData[i].SysMemSlicePitch = initData[i].SysMemPitch * ((levelHeight + 3u) / 4u);
+		}
 
-		D3D11_SUBRESOURCE_DATA initData;
-		initData.pSysMem = buffer.data();
-		initData.SysMemPitch = rowStride;
-		initData.SysMemSlicePitch = totalStride;
-		CreateTexture(pDevice, desc, &initData);
+		D3D11_TEXTURE2D_DESC desc = {};
+		desc.Width = image.width;
+		desc.Height = image.height;
+		desc.MipLevels = nMipLevels;
+		desc.ArraySize = 1u;
+		desc.Format = format;
+		desc.SampleDesc.Count = 1u;
+		desc.SampleDesc.Quality = 0u;
+		desc.Usage = D3D11_USAGE_IMMUTABLE;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		CreateTexture(pDevice, desc, initData.data(), MemoryTag::eTextures);
 
 		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 		srvDesc.Format = format;
-		srvDesc.Texture2D.MipLevels = 1u;
+		srvDesc.Texture2D.MipLevels = nMipLevels;
 		srvDesc.Texture2D.MostDetailedMip = 0u;
 		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
 		CreateSRV(pDevice, srvDesc);
 	}
-	void CreateTexture(ID3D11Device* const pDevice, D3D11_TEXTURE2D_DESC desc, D3D11_SUBRESOURCE_DATA* data = nullptr)
+	void CreateTexture(ID3D11Device* const pDevice, D3D11_TEXTURE2D_DESC desc, D3D11_SUBRESOURCE_DATA* data = nullptr, MemoryTag tag = MemoryTag::eRenderTargets)
 	{
 		pTex.Reset();
+		memory.Release();
 		descTex = desc;
 		HRESULT hr = pDevice->CreateTexture2D(&descTex.value(), data, pTex.GetAddressOf());
 		if (FAILED(hr)) throw std::runtime_error("Texture creation failed");
+		memory.Track(tag, TexFormatConverter::GetTextureSize(desc));
 	}
 	void WrapTexture(ID3D11Texture2D* pTexture)
 	{
-		pTex.Attach(pTexture);
+		pTex.Attach(pTexture); // memory stays with the owner, e.g. the swapchain
 	}
 
 	void SaveTextureToFile(ID3D11DeviceContext* const pDeviceContext, std::wstring fileName, const GUID& guidContainerFormat = GUID_ContainerFormatJpeg)
@@ -192,6 +256,7 @@ private:
 private:
 	Microsoft::WRL::ComPtr<ID3D11Texture2D> pTex;
 	std::optional<D3D11_TEXTURE2D_DESC> descTex;
+	TrackedMemory memory;
 };
 
 class Texture3D : public TextureBase
@@ -202,12 +267,23 @@ public:
 	ROF_DELETE(Texture3D);
 
 public:
-	void CreateTexture(ID3D11Device* const pDevice, D3D11_TEXTURE3D_DESC desc, D3D11_SUBRESOURCE_DATA* data = nullptr)
+	void CreateTexture(ID3D11Device* const pDevice, D3D11_TEXTURE3D_DESC desc, D3D11_SUBRESOURCE_DATA* data = nullptr, MemoryTag tag = MemoryTag::eRenderTargets)
 	{
 		pTex.Reset();
+		memory.Release();
 		descTex = desc;
 		HRESULT hr = pDevice->CreateTexture3D(&descTex.value(), data, pTex.GetAddressOf());
 		if (FAILED(hr)) throw std::runtime_error("Texture creation failed");
+
+		// a volume is sized like a 2d array with one slice per depth layer, without the depth mips
+		D3D11_TEXTURE2D_DESC sliceDesc = {};
+		sliceDesc.Width = desc.Width;
+		sliceDesc.Height = desc.Height;
+		sliceDesc.MipLevels = 1u;
+		sliceDesc.ArraySize = desc.Depth;
+		sliceDesc.Format = desc.Format;
+		sliceDesc.SampleDesc.Count = 1u;
+		memory.Track(tag, TexFormatConverter::GetTextureSize(sliceDesc));
 	}
 	inline D3D11_SUBRESOURCE_DATA SubresTemplate(UINT bytesPerPixel, UINT width, UINT height)
 	{
@@ -224,4 +300,5 @@ private:
 private:
 	Microsoft::WRL::ComPtr<ID3D11Texture3D> pTex;
 	std::optional<D3D11_TEXTURE3D_DESC> descTex;
+	TrackedMemory memory;
 };
\ No newline at end of file
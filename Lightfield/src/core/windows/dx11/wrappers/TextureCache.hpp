@@ -0,0 +1,45 @@
+#pragma once
+
+#include <mutex>
+
+// shares textures between submeshes, so every image file only gets decoded, filtered and uploaded once
+class TextureCache
+{
+private:
+	TextureCache() = default;
+	~TextureCache() = default;
+	ROF_DELETE(TextureCache);
+
+public:
+	static inline TextureCache& Get()
+	{
+		static TextureCache instance;
+		return instance;
+	}
+
+	// threadsafe, decoding happens outside the lock so different files can load concurrently
+	std::shared_ptr<Texture2D> Load(ID3D11Device* const pDevice, const std::wstring& filepath)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto pCached = textures.find(filepath);
+			if (pCached != textures.end()) return pCached->second;
+		}
+
+		auto pTexture = std::make_shared<Texture2D>();
+		pTexture->CreateTextureFromJPG(pDevice, filepath);
+
+		// keep whichever texture got inserted first if another thread loaded the same file meanwhile
+		std::lock_guard<std::mutex> lock(mutex);
+		return textures.emplace(filepath, pTexture).first->second;
+	}
+	inline void Clear()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		textures.clear();
+	}
+
+private:
+	std::mutex mutex;
+	std::unordered_map<std::wstring, std::shared_ptr<Texture2D>> textures;
+};
\ No newline at end of file
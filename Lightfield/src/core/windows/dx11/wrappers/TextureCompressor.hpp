@@ -0,0 +1,189 @@
+#pragma once
+
+#include <fstream>
+#include "BlockCompressor.hpp"
+
+// import step turning decoded mip chains into block compressed textures, cached on disk next to the other data
+// later runs load the cached blocks directly and skip decoding, filtering and encoding entirely
+class TextureCompressor
+{
+public:
+	struct CompressedImage
+	{
+		BlockCompressor::Format format;
+		UINT width, height;
+		std::vector<std::vector<BYTE>> levels;
+	};
+
+private:
+	TextureCompressor() = default;
+	~TextureCompressor() = default;
+	ROF_DELETE(TextureCompressor);
+
+public:
+	static inline TextureCompressor& Get()
+	{
+		static TextureCompressor instance;
+		return instance;
+	}
+
+	// formats the encoder understands, block compression also needs the top level to be made of whole blocks
+	static inline bool IsCompressible(DXGI_FORMAT format, UINT width, UINT height)
+	{
+		return MipChain::IsSupportedFormat(format) && width % 4u == 0u && height % 4u == 0u;
+	}
+	static inline DXGI_FORMAT GetDXGIFormat(BlockCompressor::Format format)
+	{
+		switch (format)
+		{
+			case BlockCompressor::Format::eBC1: return DXGI_FORMAT_BC1_UNORM;
+			case BlockCompressor::Format::eBC3: return DXGI_FORMAT_BC3_UNORM;
+			case BlockCompressor::Format::eBC7: return DXGI_FORMAT_BC7_UNORM;
+		}
+		return DXGI_FORMAT_UNKNOWN;
+	}
+
+	// opaque textures get BC1, textures with alpha BC3, unless high quality asks for BC7
+	CompressedImage Compress(const MipChain& mipChain, DXGI_FORMAT sourceFormat) const
+	{
+		PROFILE_SCOPE("TextureCompressor::Compress");
+		const bool bBGR = sourceFormat != DXGI_FORMAT_R8G8B8A8_UNORM;
+		const bool bOpaque = sourceFormat == DXGI_FORMAT_B8G8R8X8_UNORM || IsOpaque(mipChain.GetLevel(0u));
+
+		CompressedImage image;
+		image.format = bHighQuality ? BlockCompressor::Format::eBC7 : bOpaque ? BlockCompressor::Format::eBC1 : BlockCompressor::Format::eBC3;
+		image.width = mipChain.GetLevel(0u).width;
+		image.height = mipChain.GetLevel(0u).height;
+		image.levels.reserve(mipChain.GetLevelCount());
+		for (UINT i = 0u; i < mipChain.GetLevelCount(); i++) {
+			const MipChain::Level& level = mipChain.GetLevel(i);
+			image.levels.push_back(BlockCompressor::Compress(image.format, level.data.data(), level.width, level.height, bBGR, bOpaque));
+		}
+		return image;
+	}
+
+	// cache files are invalidated whenever the source file changes or the quality setting differs
+	// entries that do not describe a valid block compressed mip chain are dropped, so the caller rebuilds them
+	std::optional<CompressedImage> LoadCached(const std::wstring& sourcePath) const
+	{
+		const std::filesystem::path cachePath = GetCachePath(sourcePath);
+		std::ifstream file(cachePath, std::ios::binary | std::ios::ate);
+		if (!file) return std::nullopt;
+		uint64_t nRemaining = static_cast<uint64_t>(file.tellg());
+		file.seekg(0);
+
+		CacheHeader header = {};
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (!file || header.magic != cacheMagic || header.version != cacheVersion) return DropCached(file, cachePath);
+		if (header.sourceStamp != GetSourceStamp(sourcePath) || header.bHighQuality != static_cast<UINT>(bHighQuality)) return DropCached(file, cachePath);
+		if (!IsExpectedHeader(header)) return DropCached(file, cachePath);
+		nRemaining -= sizeof(header);
+
+		CompressedImage image;
+		image.format = static_cast<BlockCompressor::Format>(header.format);
+		image.width = header.width;
+		image.height = header.height;
+		image.levels.resize(header.nLevels);
+		for (UINT i = 0u; i < header.nLevels; i++) {
+			uint64_t size = 0u;
+			file.read(reinterpret_cast<char*>(&size), sizeof(size));
+			if (!file || size != GetLevelSize(image, i) || size > nRemaining - sizeof(size)) return DropCached(file, cachePath);
+			nRemaining -= sizeof(size) + size;
+			image.levels[i].resize(static_cast<size_t>(size));
+			file.read(reinterpret_cast<char*>(image.levels[i].data()), size);
+		}
+		if (!file || nRemaining != 0u) return DropCached(file, cachePath);
+		return image;
+	}
+	void SaveCached(const std::wstring& sourcePath, const CompressedImage& image) const
+	{
+		const std::filesystem::path cachePath = GetCachePath(sourcePath);
+		std::filesystem::create_directories(cachePath.parent_path());
+
+		CacheHeader header = {};
+		header.magic = cacheMagic;
+		header.version = cacheVersion;
+		header.format = static_cast<UINT>(image.format);
+		header.width = image.width;
+		header.height = image.height;
+		header.nLevels = static_cast<UINT>(image.levels.size());
+		header.bHighQuality = static_cast<UINT>(bHighQuality);
+		header.sourceStamp = GetSourceStamp(sourcePath);
+
+		// write to a temporary file first, so a concurrent or interrupted run never sees half a cache entry
+		std::filesystem::path tempPath = cachePath;
+		tempPath += L".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file) return; // caching is optional, the texture itself is already usable
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			for (const auto& level : image.levels) {
+				const uint64_t size = level.size();
+				file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+				file.write(reinterpret_cast<const char*>(level.data()), size);
+			}
+		}
+		std::error_code error;
+		std::filesystem::rename(tempPath, cachePath, error);
+	}
+
+public:
+	bool bEnabled = true;
+	bool bHighQuality = false;
+
+private:
+	struct CacheHeader
+	{
+		UINT magic, version;
+		UINT format, width, height, nLevels;
+		UINT bHighQuality, padding;
+		uint64_t sourceStamp;
+	};
+
+	// the format has to match the quality setting and the chain has to be complete for the top level
+	bool IsExpectedHeader(const CacheHeader& header) const
+	{
+		if (bHighQuality ? header.format != static_cast<UINT>(BlockCompressor::Format::eBC7)
+			: header.format != static_cast<UINT>(BlockCompressor::Format::eBC1) && header.format != static_cast<UINT>(BlockCompressor::Format::eBC3)) return false;
+		if (header.width == 0u || header.height == 0u || header.width > D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION || header.height > D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION) return false;
+		if (header.width % 4u != 0u || header.height % 4u != 0u) return false;
+		return header.nLevels == MipChain::CalcLevelCount(header.width, header.height);
+	}
+	static uint64_t GetLevelSize(const CompressedImage& image, UINT iLevel)
+	{
+		const uint64_t nBlocksX = (std::max(image.width >> iLevel, 1u) + 3u) / 4u;
+		const uint64_t nBlocksY = (std::max(image.height >> iLevel, 1u) + 3u) / 4u;
+		return nBlocksX * nBlocksY * BlockCompressor::GetBlockSize(image.format);
+	}
+	static std::nullopt_t DropCached(std::ifstream& file, const std::filesystem::path& cachePath)
+	{
+		file.close();
+		std::error_code error;
+		std::filesystem::remove(cachePath, error);
+		return std::nullopt;
+	}
+	static bool IsOpaque(const MipChain::Level& level)
+	{
+		for (size_t i = 3u; i < level.data.size(); i += 4u) {
+			if (level.data[i] != UCHAR_MAX) return false;
+		}
+		return true;
+	}
+	static std::filesystem::path GetCachePath(const std::wstring& sourcePath)
+	{
+		std::wstringstream wss;
+		wss << L"data/cache/textures/" << std::hex << std::hash<std::wstring>()(sourcePath) << L".lfbc";
+		return wss.str();
+	}
+	static uint64_t GetSourceStamp(const std::wstring& sourcePath)
+	{
+		std::error_code error;
+		const uint64_t size = std::filesystem::file_size(sourcePath, error);
+		const uint64_t time = static_cast<uint64_t>(std::filesystem::last_write_time(sourcePath, error).time_since_epoch().count());
+		return time ^ (size * 0x9E3779B97F4A7C15ull);
+	}
+
+private:
+	static constexpr UINT cacheMagic = 0x4346424Cu; // "LBFC"
+	static constexpr UINT cacheVersion = 1u;
+};
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "pch.hpp"
+#include "cpu/HeadlessBackend.hpp"
+
+// runs the lightfield pipeline on the cpu backend and writes the last frame's capture
+// usage: lightfield_headless [--width N] [--height N] [--frames N] [--out DIR] [--profile] [--unfused] [--epi] [--sweep] [--planes MIN MAX N] [--depth-scale N] [--unrefined] [--ply] [--mesh] [--synthesize N] [--archive] [--replay FILE] [--timestep S] [--dataset DIR] [--dataset-step N] [--crop X Y W H] [--load-archive FILE]
+int main(int argc, char** argv)
+{
+	UINT width = 1280u, height = 720u, nFrames = 1u, nSynthesized = 0u;
+	std::filesystem::path outDir = "capture", replayPath, datasetPath, archivePath;
+	LightfieldDataset::Options datasetOptions;
+	HeadlessBackend::DepthEngine depthEngine = HeadlessBackend::DepthEngine::eGradients;
+	float minDisparity = -2.0f, maxDisparity = 6.0f;
+	UINT nPlanes = 33u, depthScale = 1u;
+	double timestep = 1.0 / 60.0;
+	bool bProfile = false, bFused = true, bRefine = true, bPly = false, bMesh = false, bArchive = false;
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		const bool bHasValue = i + 1 < argc;
+		if (arg == "--width" && bHasValue) width = static_cast<UINT>(std::stoul(argv[++i]));
+		else if (arg == "--height" && bHasValue) height = static_cast<UINT>(std::stoul(argv[++i]));
+		else if (arg == "--frames" && bHasValue) nFrames = static_cast<UINT>(std::stoul(argv[++i]));
+		else if (arg == "--out" && bHasValue) outDir = argv[++i];
+		else if (arg == "--profile") bProfile = true;
+		else if (arg == "--unfused") bFused = false; // gradients go through memory between two passes
+		else if (arg == "--epi") depthEngine = HeadlessBackend::DepthEngine::eEpi; // epipolar plane image engine instead of the gradients
+		else if (arg == "--sweep") depthEngine = HeadlessBackend::DepthEngine::ePlaneSweep; // plane sweep for disparities beyond the gradients' range
+		else if (arg == "--planes" && i + 3 < argc) {
+			minDisparity = std::stof(argv[++i]);
+			maxDisparity = std::stof(argv[++i]);
+			nPlanes = static_cast<UINT>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--depth-scale" && bHasValue) depthScale = static_cast<UINT>(std::stoul(argv[++i])); // 2 or 4, depth on reduced views upsampled to full resolution
+		else if (arg == "--unrefined") bRefine = false; // raw least squares depth
+		else if (arg == "--ply") bPly = true; // point cloud of the output depth
+		else if (arg == "--mesh") bPly = bMesh = true;
+		else if (arg == "--archive") bArchive = true; // views as one lightfield archive
+		else if (arg == "--synthesize" && bHasValue) nSynthesized = static_cast<UINT>(std::stoul(argv[++i])); // N x N virtual views across the grid
+		else if (arg == "--replay" && bHasValue) replayPath = argv[++i]; // camera path recorded by the application, replaces --frames
+		else if (arg == "--timestep" && bHasValue) timestep = std::stod(argv[++i]); // seconds between replayed frames
+		else if (arg == "--dataset" && bHasValue) datasetPath = argv[++i]; // directory of sub-aperture views instead of the scene, replaces --width and --height
+		else if (arg == "--load-archive" && bHasValue) archivePath = argv[++i]; // views of a lightfield archive written with --archive, replaces --width and --height
+		else if (arg == "--dataset-step" && bHasValue) datasetOptions.step = static_cast<UINT>(std::stoul(argv[++i])); // cameras between the chosen views
+		else if (arg == "--crop" && i + 4 < argc) {
+			datasetOptions.cropX = static_cast<UINT>(std::stoul(argv[++i]));
+			datasetOptions.cropY = static_cast<UINT>(std::stoul(argv[++i]));
+			datasetOptions.cropWidth = static_cast<UINT>(std::stoul(argv[++i]));
+			datasetOptions.cropHeight = static_cast<UINT>(std::stoul(argv[++i]));
+		}
+		else {
+			std::cerr << "usage: " << argv[0] << " [--width N] [--height N] [--frames N] [--out DIR] [--profile] [--unfused] [--epi] [--sweep] [--planes MIN MAX N] [--depth-scale N] [--unrefined] [--ply] [--mesh] [--synthesize N] [--archive] [--replay FILE] [--timestep S] [--dataset DIR] [--dataset-step N] [--crop X Y W H] [--load-archive FILE]\n";
+			return 1;
+		}
+	}
+
+	try {
+		Profiler::Get().SetThreadName("Main");
+		Profiler::Get().SetEnabled(bProfile);
+
+		// real captures decide the resolution, their ground truth is compared against the output depth at the end
+		LightfieldDataset dataset;
+		if (!datasetPath.empty()) {
+			const auto loadStart = std::chrono::steady_clock::now();
+			dataset.Load(datasetPath, datasetOptions);
+			width = dataset.GetWidth();
+			height = dataset.GetHeight();
+			std::cout << "loaded dataset in " << std::fixed << std::setprecision(2)
+				<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count() << " ms\n";
+		}
+
+		// archived captures decode in parallel stripes, the views stay bit exact
+		std::vector<Image> archivedViews;
+		if (!archivePath.empty()) {
+			const auto decodeStart = std::chrono::steady_clock::now();
+			LightfieldCodec::Read(archivePath, archivedViews);
+			width = archivedViews.front().width;
+			height = archivedViews.front().height;
+			std::cout << "decoded archive in " << std::fixed << std::setprecision(2)
+				<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - decodeStart).count() << " ms\n";
+		}
+
+		HeadlessBackend backend(width, height);
+		backend.LoadDefaultScene();
+		if (!datasetPath.empty()) backend.SetViews(dataset.GetViews());
+		else if (!archivedViews.empty()) backend.SetViews(std::move(archivedViews));
+		backend.SetFusedDepth(bFused);
+		backend.SetDepthEngine(depthEngine);
+		backend.GetPlaneSweepEngine().SetRange(minDisparity, maxDisparity, nPlanes);
+		backend.SetDepthScale(depthScale);
+		backend.SetDepthRefinement(bRefine);
+
+		// replays render the recorded trajectory at a fixed timestep, so runs on different builds and machines see the same frames
+		CameraPath cameraPath;
+		if (!replayPath.empty()) {
+			if (timestep <= 0.0) throw std::runtime_error("Replay timestep has to be positive");
+			cameraPath.Read(replayPath);
+			nFrames = cameraPath.GetFrameCount(timestep);
+		}
+
+		FrameTimings timings;
+		const auto start = std::chrono::steady_clock::now();
+		for (UINT i = 0u; i < nFrames; i++) {
+			PROFILE_SCOPE("Frame");
+			if (!replayPath.empty()) {
+				const CameraPath::Pose pose = cameraPath.GetPose(i * timestep);
+				backend.SetCamera({ pose.position[0], pose.position[1], pose.position[2] }, { pose.rotation[0], pose.rotation[1], pose.rotation[2] });
+			}
+			if (i + 1u == nFrames) backend.RequestCapture(); // only the last frame keeps its intermediates
+
+			const auto frameStart = std::chrono::steady_clock::now();
+			backend.RenderFrame();
+			timings.BeginFrame();
+			timings.Set("Frame", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+			timings.SetPasses(backend.GetFrameGraph());
+		}
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << nFrames << " frames at " << width << "x" << height << ", " << std::fixed << std::setprecision(2)
+			<< seconds * 1000.0 / std::max(nFrames, 1u) << " ms per frame\n";
+
+		// no wic outside of windows, so only the uncompressed formats are available
+		std::filesystem::create_directories(outDir);
+		if (!replayPath.empty()) {
+			timings.WriteCsv(outDir / "frame_timings.csv");
+			timings.WriteSummary(std::cout);
+		}
+		PipelineBackend::CaptureFormats formats;
+		formats.color = ImageWriter::FileFormat::eRaw;
+		formats.simDepth = ImageWriter::FileFormat::ePFM;
+		formats.outputDepth = ImageWriter::FileFormat::ePFM;
+		formats.bArchiveViews = bArchive;
+		ImageWriter imageWriter;
+		backend.WriteCapture(imageWriter, outDir, formats);
+		if (bPly) {
+			GeometryExporter::Options options;
+			options.bMesh = bMesh;
+			const GeometryExporter::Stats stats = backend.ExportGeometry(outDir / "geometry.ply", options);
+			std::cout << "exported " << stats.nVertices << " vertices and " << stats.nFaces << " faces\n";
+		}
+		if (nSynthesized > 0u) {
+			ViewSynthesizer synthesizer;
+			const float extent = static_cast<float>(CameraGrid::camLoopLim);
+			const float step = nSynthesized > 1u ? 2.0f * extent / (nSynthesized - 1u) : 0.0f;
+			for (UINT i = 0u; i < nSynthesized * nSynthesized; i++) {
+				// same column by column order as the real views
+				const float u = nSynthesized > 1u ? step * (i / nSynthesized) - extent : 0.0f;
+				const float v = nSynthesized > 1u ? extent - step * (i % nSynthesized) : 0.0f;
+				std::wstringstream wss;
+				wss << L"synthesized_color" << i << ImageWriter::GetExtension(formats.color);
+				imageWriter.Enqueue(backend.SynthesizeView(synthesizer, u, v), (outDir / wss.str()).wstring(), formats.color);
+			}
+		}
+		imageWriter.Flush();
+
+		if (bProfile) {
+			Profiler::Get().ExportChromeTrace(outDir / "profile.json");
+			Profiler::Get().ExportSummary(outDir / "profile.txt");
+		}
+		if (const Image* pGroundTruth = dataset.GetGroundTruth()) {
+			const LightfieldDataset::Accuracy accuracy = LightfieldDataset::Evaluate(backend.Capture(PipelineBackend::CaptureTarget::eOutputDepth), *pGroundTruth);
+			std::cout << "accuracy over " << accuracy.nTexels << " texels: mse*100 " << std::setprecision(3) << accuracy.mse
+				<< ", badpix(.07) " << accuracy.badPixels * 100.0 << "%, mean absolute error " << accuracy.meanAbsoluteError << "\n";
+		}
+		std::cout << "frame graph of the captured frame:\n";
+		backend.GetFrameGraph().WriteReport(std::cout);
+		MemoryTracker::Get().WriteReport(std::cout);
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Unhandled Exception: " << e.what() << "\n";
+		return 1;
+	}
+	return 0;
+}
\ No newline at end of file
@@ -6,17 +6,23 @@
 #include <algorithm>
 #include <functional>
 #include <random>
+#include <cstdint>
+#include <climits>
+#include <cstring>
 
 #define _USE_MATH_DEFINES
 #include <math.h>
 
 #include <string>
 #include <sstream>
+#include <iomanip>
+#include <ctime>
 #include <iostream>
 #include <filesystem>
 
 // containers
 #include <vector>
+#include <array>
 #include <unordered_map>
 #include <unordered_set>
 #include <bitset>
@@ -31,6 +37,7 @@
 	#include <wincodec.h> // file conversion codecs
 	#include <wrl.h> // smart pointers for COM objects
 	#include <DirectXMath.h>
+	#include <DirectXPackedVector.h>
 
 	// DirectX 11 Debugging
 	#ifdef _DEBUG
@@ -64,9 +71,24 @@
 	//#include "SpriteFont.h"
 	//#include "VertexTypes.h"
 	//#include "WICTextureLoader.h"
+#else
+	// windows integer types used throughout the portable code
+	typedef uint32_t UINT;
+	typedef uint8_t BYTE;
 #endif
 
 // utils
 #include "utils/Helpers.hpp"
 #include "utils/Time.hpp"
-#include "utils/TempStringConverter.hpp"
\ No newline at end of file
+#include "utils/Profiler.hpp"
+#include "utils/MemoryTracker.hpp"
+#include "utils/Arena.hpp"
+#include "utils/TaskScheduler.hpp"
+#include "utils/Parallel.hpp"
+#include "utils/JobSystem.hpp"
+#include "utils/ImageWriter.hpp"
+#include "utils/ImageReader.hpp"
+#include "utils/Recorder.hpp"
+#ifdef Win32
+#include "utils/TempStringConverter.hpp"
+#endif
\ No newline at end of file
@@ -1,6 +1,20 @@
 Texture2D gradientBuffer : register(t0);
 
-float main(float4 screenPos : SV_Position) : SV_Target
+struct DeductionOutput
+{
+	float depth : SV_Target0;
+	float confidence : SV_Target1; // grows with the spatial gradient energy, same mapping as the cpu engine
+};
+
+DeductionOutput Deduce(float a, float b)
+{
+	DeductionOutput output;
+	output.depth = b > 0.0f ? a / b : 0.0f; // flat windows have no gradient to deduce from, same as the cpu engine
+	output.confidence = b / (b + 1e-3f);
+	return output;
+}
+
+DeductionOutput main(float4 screenPos : SV_Position)
 {
 	int2 texPos = int2(screenPos.xy);
 
@@ -21,7 +35,7 @@ float main(float4 screenPos : SV_Position) : SV_Target
 			}
 		}
 
-		return (a / b);
+		return Deduce(a, b);
 
 	}
 	// version B
@@ -31,6 +45,6 @@ float main(float4 screenPos : SV_Position) : SV_Target
 		a = gradients.x * gradients.z + gradients.y * gradients.w;
 		b = gradients.x * gradients.x + gradients.y * gradients.y;
 
-		return (a / b);
+		return Deduce(a, b);
 	}
 }
\ No newline at end of file
@@ -0,0 +1,28 @@
+// box filters every view down by the depth scale for reduced resolution depth, same as the cpu DepthUpsampler::Downsample
+// blocks along the far edges are clipped to the views
+
+Texture2DArray colBuffArr : register(t0);
+RWTexture2DArray<unorm float4> reducedViews : register(u0);
+
+cbuffer DepthScaleBuffer : register(b0) { uint factor; };
+
+[numthreads(8, 8, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+	uint width, height, nViews;
+	colBuffArr.GetDimensions(width, height, nViews);
+	uint reducedWidth, reducedHeight, nReducedViews;
+	reducedViews.GetDimensions(reducedWidth, reducedHeight, nReducedViews);
+	if (id.x >= reducedWidth || id.y >= reducedHeight) return;
+
+	const uint2 blockMin = id.xy * factor;
+	const uint2 blockMax = min(blockMin + factor, uint2(width, height));
+	const float count = float((blockMax.x - blockMin.x) * (blockMax.y - blockMin.y));
+	for (uint cam = 0u; cam < nViews; cam++) {
+		float4 sum = float4(0.0f, 0.0f, 0.0f, 0.0f);
+		for (uint y = blockMin.y; y < blockMax.y; y++) {
+			for (uint x = blockMin.x; x < blockMax.x; x++) sum += colBuffArr.Load(int4(x, y, cam, 0));
+		}
+		reducedViews[uint3(id.xy, cam)] = sum / count;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+// depth from the orientation of lines in epipolar plane images, same as the cpu EpiDepthEngine
+// the center row of views gives horizontal epis, the center column vertical ones, the latter are stored transposed
+// so both directions run through the same code, [line][along] with along being the spatial axis of the epi
+
+#define TILE 16
+#define RADIUS 3 // of the gaussian the tensors are smoothed with
+#define TENSOR_SIZE (TILE + 2 * RADIUS)
+#define ALONG_SIZE (TENSOR_SIZE + 2) // 1 pixel derivative halo along the epi
+#define N_VIEWS_PER_AXIS 3
+
+Texture2DArray colBuffArr : register(t0);
+RWTexture2D<float> outputDepth : register(u0);
+RWTexture2D<float> confidence : register(u1); // may be unbound when nothing refines the depth
+
+groupshared float epiLuma[2][N_VIEWS_PER_AXIS][TENSOR_SIZE][ALONG_SIZE];
+groupshared float3 tensors[2][TENSOR_SIZE][TENSOR_SIZE]; // Jss, Jsa, Jaa
+
+static const float3 p = float3(0.229879f, 0.540242f, 0.229879f);
+static const float3 d = float3(-0.425287f, 0.0f, 0.425287f);
+static const float smoothing[2 * RADIUS + 1] = { 0.036633f, 0.111281f, 0.216745f, 0.270682f, 0.216745f, 0.111281f, 0.036633f };
+
+// horizontal epis have their lines along image rows, vertical ones along image columns
+int2 ToImage(uint dir, int line, int along)
+{
+	return dir == 0u ? int2(along, line) : int2(line, along);
+}
+
+[numthreads(TILE, TILE, 1)]
+void main(uint3 groupId : SV_GroupID, uint3 threadId : SV_GroupThreadID, uint threadIndex : SV_GroupIndex)
+{
+	uint width, height, nViews;
+	colBuffArr.GetDimensions(width, height, nViews);
+	const int2 tileOrigin = int2(groupId.xy * TILE);
+	const int2 imageMax = int2(width, height) - 1;
+
+	// luma of the epis, edges are clamped since a zero border would look like a strong line in the epi
+	for (uint i = threadIndex; i < 2u * N_VIEWS_PER_AXIS * TENSOR_SIZE * ALONG_SIZE; i += TILE * TILE) {
+		const uint along = i % ALONG_SIZE;
+		const uint line = (i / ALONG_SIZE) % TENSOR_SIZE;
+		const uint s = (i / (ALONG_SIZE * TENSOR_SIZE)) % N_VIEWS_PER_AXIS;
+		const uint dir = i / (ALONG_SIZE * TENSOR_SIZE * N_VIEWS_PER_AXIS);
+		const int2 origin = dir == 0u ? tileOrigin : tileOrigin.yx;
+		const int2 texPos = clamp(ToImage(dir, origin.y - RADIUS + int(line), origin.x - RADIUS - 1 + int(along)), int2(0, 0), imageMax);
+		const uint cam = dir == 0u ? s * N_VIEWS_PER_AXIS + 1u : N_VIEWS_PER_AXIS + s;
+		const float3 color = colBuffArr.Load(int4(texPos, cam, 0)).rgb;
+		epiLuma[dir][s][line][along] = dot(color, float3(0.333333f, 0.333333f, 0.333333f));
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	// structure tensor of the center line of every epi, positions outside the image repeat the edge
+	for (uint j = threadIndex; j < 2u * TENSOR_SIZE * TENSOR_SIZE; j += TILE * TILE) {
+		const uint along = j % TENSOR_SIZE;
+		const uint line = (j / TENSOR_SIZE) % TENSOR_SIZE;
+		const uint dir = j / (TENSOR_SIZE * TENSOR_SIZE);
+		const int base = (dir == 0u ? tileOrigin.x : tileOrigin.y) - RADIUS;
+		const int alongMax = dir == 0u ? imageMax.x : imageMax.y;
+		const int center = clamp(base + int(along), 0, alongMax);
+		float gs = 0.0f, ga = 0.0f;
+		for (int x = 0; x <= 2; x++) {
+			const uint iAlong = uint(clamp(center + x - 1, 0, alongMax) - base + 1);
+			for (uint s = 0u; s < N_VIEWS_PER_AXIS; s++) {
+				const float luma = epiLuma[dir][s][line][iAlong];
+				gs += p[s] * d[x] * luma;
+				ga += d[s] * p[x] * luma;
+			}
+		}
+		tensors[dir][line][along] = float3(gs * gs, gs * ga, ga * ga);
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	// separable smoothing, along the epis first, the results of this thread stay in registers until everyone has read
+	#define N_SMOOTHED (2 * TENSOR_SIZE * TILE)
+	#define N_SMOOTHED_PER_THREAD ((N_SMOOTHED + TILE * TILE - 1) / (TILE * TILE))
+	float3 smoothedAlong[N_SMOOTHED_PER_THREAD];
+	uint3 smoothedPosition[N_SMOOTHED_PER_THREAD]; // along, line, direction
+	for (uint k = 0u; k < N_SMOOTHED_PER_THREAD; k++) {
+		const uint m = threadIndex + k * TILE * TILE;
+		if (m >= N_SMOOTHED) continue;
+		smoothedPosition[k] = uint3(m % TILE + RADIUS, (m / TILE) % TENSOR_SIZE, m / (TILE * TENSOR_SIZE));
+		float3 sum = float3(0.0f, 0.0f, 0.0f);
+		for (int r = -RADIUS; r <= RADIUS; r++) sum += smoothing[r + RADIUS] * tensors[smoothedPosition[k].z][smoothedPosition[k].y][smoothedPosition[k].x + r];
+		smoothedAlong[k] = sum;
+	}
+	GroupMemoryBarrierWithGroupSync();
+	for (uint l = 0u; l < N_SMOOTHED_PER_THREAD; l++) {
+		if (threadIndex + l * TILE * TILE >= N_SMOOTHED) continue;
+		tensors[smoothedPosition[l].z][smoothedPosition[l].y][smoothedPosition[l].x] = smoothedAlong[l];
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	const int2 texPos = tileOrigin + int2(threadId.xy);
+	if (texPos.x >= int(width) || texPos.y >= int(height)) return;
+
+	// then across neighbouring epis, each direction gives a disparity and the more coherent one wins
+	float bestDisparity = 0.0f, bestCoherence = -1.0f, bestEnergy = 0.0f;
+	for (uint dir = 0u; dir < 2u; dir++) {
+		const uint2 position = (dir == 0u ? threadId.xy : threadId.yx) + RADIUS;
+		float3 tensor = float3(0.0f, 0.0f, 0.0f);
+		for (int r = -RADIUS; r <= RADIUS; r++) tensor += smoothing[r + RADIUS] * tensors[dir][position.y + r][position.x];
+
+		// lines in an epi run along s + a * disparity = const, so the dominant gradient points along (1, disparity)
+		const float energy = tensor.x + tensor.z;
+		float disparity = 0.0f, coherence = 0.0f;
+		if (energy > 0.0f) {
+			disparity = tan(.5f * atan2(2.0f * tensor.y, tensor.x - tensor.z));
+			coherence = sqrt((tensor.x - tensor.z) * (tensor.x - tensor.z) + 4.0f * tensor.y * tensor.y) / energy;
+		}
+		if (coherence > bestCoherence) {
+			bestDisparity = disparity;
+			bestCoherence = coherence;
+			bestEnergy = energy;
+		}
+	}
+	outputDepth[texPos] = bestDisparity;
+	confidence[texPos] = bestCoherence * bestEnergy / (bestEnergy + 1e-3f);
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+// gradients and depth deduction in one pass, the gradients of a tile only ever live in groupshared memory
+// same filters and window as GradientsPS and DepthDeductionPS
+
+#define TILE 16
+#define LUMA_SIZE (TILE + 4) // 1 pixel gradient halo plus 1 pixel filter halo
+#define GRAD_SIZE (TILE + 2) // 1 pixel halo for the 3x3 deduction window
+#define N_VIEWS 9
+
+Texture2DArray colBuffArr : register(t0);
+RWTexture2D<float> outputDepth : register(u0);
+RWTexture2D<float> confidence : register(u1); // may be unbound when nothing refines the depth
+
+groupshared float lumaTile[N_VIEWS][LUMA_SIZE][LUMA_SIZE];
+groupshared float4 gradTile[GRAD_SIZE][GRAD_SIZE]; // Lx, Ly, Lu, Lv
+
+[numthreads(TILE, TILE, 1)]
+void main(uint3 groupId : SV_GroupID, uint3 threadId : SV_GroupThreadID, uint threadIndex : SV_GroupIndex)
+{
+	const float3 p = float3(0.229879f, 0.540242f, 0.229879f);
+	const float3 d = float3(-0.425287f, 0.0f, 0.425287f);
+
+	uint width, height, nViews;
+	colBuffArr.GetDimensions(width, height, nViews);
+	const int2 tileOrigin = int2(groupId.xy * TILE);
+
+	// luma of all views for the tile and both halos, out of bounds loads return zero
+	for (uint i = threadIndex; i < N_VIEWS * LUMA_SIZE * LUMA_SIZE; i += TILE * TILE) {
+		const uint cam = i / (LUMA_SIZE * LUMA_SIZE);
+		const uint x = i % LUMA_SIZE;
+		const uint y = (i / LUMA_SIZE) % LUMA_SIZE;
+		const float3 color = colBuffArr.Load(int4(tileOrigin + int2(x, y) - 2, cam, 0)).rgb;
+		lumaTile[cam][y][x] = dot(color, float3(0.333333f, 0.333333f, 0.333333f));
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	// gradients for the tile and one pixel halo, gradients outside the texture are zero like the gradient buffer's
+	for (uint j = threadIndex; j < GRAD_SIZE * GRAD_SIZE; j += TILE * TILE) {
+		const uint gx = j % GRAD_SIZE;
+		const uint gy = j / GRAD_SIZE;
+		const int2 texPos = tileOrigin + int2(gx, gy) - 1;
+		float4 gradients = float4(0.0f, 0.0f, 0.0f, 0.0f);
+		if (all(texPos >= 0) && texPos.x < int(width) && texPos.y < int(height)) {
+			for (int u = 0; u <= 2; u++) {
+				for (int v = 0; v <= 2; v++) {
+					const int camIndex = u * 3 + v;
+					float dxpy = 0.0f, pxdy = 0.0f, pxpy = 0.0f;
+					for (int y = 0; y <= 2; y++) {
+						for (int x = 0; x <= 2; x++) {
+							const float luma = lumaTile[camIndex][gy + y][gx + x];
+							dxpy += d[x] * p[y] * luma;
+							pxdy += p[x] * d[y] * luma;
+							pxpy += p[x] * p[y] * luma;
+						}
+					}
+					gradients += float4(p[u] * p[v] * dxpy, p[u] * p[v] * pxdy, d[u] * p[v] * pxpy, p[u] * d[v] * pxpy);
+				}
+			}
+		}
+		gradTile[gy][gx] = gradients;
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	const int2 texPos = tileOrigin + int2(threadId.xy);
+	if (texPos.x >= int(width) || texPos.y >= int(height)) return;
+
+	float a = 0.0f;
+	float b = 0.0f;
+	for (int x = 0; x <= 2; x++) {
+		for (int y = 0; y <= 2; y++) {
+			const float4 gradients = gradTile[threadId.y + y][threadId.x + x];
+			a += gradients.x * gradients.z + gradients.y * gradients.w;
+			b += gradients.x * gradients.x + gradients.y * gradients.y;
+		}
+	}
+	outputDepth[texPos] = b > 0.0f ? a / b : 0.0f;
+	confidence[texPos] = b / (b + 1e-3f);
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+// last stage of the depth refinement, every window covering a texel contributes its linear model
+
+Texture2DArray colBuffArr : register(t0);
+Texture2DArray<float4> coefficients : register(t1); // boxed a.rgb, b
+RWTexture2D<float> outputDepth : register(u0);
+
+cbuffer GuidedFilterBuffer : register(b0) { uint radius; uint bVertical; uint nSlices; float epsilon; };
+
+[numthreads(16, 16, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+	uint width, height, nElements;
+	coefficients.GetDimensions(width, height, nElements);
+	if (id.x >= width || id.y >= height) return;
+
+	// windows are clipped at the borders
+	const uint2 windowMin = uint2(max(int2(id.xy) - int(radius), 0));
+	const uint2 windowMax = min(id.xy + radius, uint2(width, height) - 1);
+	const uint2 count = windowMax - windowMin + 1;
+
+	const float3 I = colBuffArr[uint3(id.xy, 4)].rgb; // center view
+	const float4 ab = coefficients[uint3(id.xy, 0)];
+	outputDepth[id.xy] = (dot(ab.rgb, I) + ab.a) / float(count.x * count.y);
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+// one direction of the box filter behind the depth refinement, unnormalized sums over windows clipped to the texture
+// each thread slides a running sum along one row or column, so the cost per texel does not depend on the radius
+
+Texture2DArray<float4> src : register(t0);
+RWTexture2DArray<float4> dst : register(u0);
+
+cbuffer GuidedFilterBuffer : register(b0) { uint radius; uint bVertical; uint nSlices; float epsilon; };
+
+uint3 GetPos(uint iLine, uint i, uint iSlice)
+{
+	return bVertical ? uint3(iLine, i, iSlice) : uint3(i, iLine, iSlice);
+}
+
+[numthreads(64, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+	uint width, height, nElements;
+	src.GetDimensions(width, height, nElements);
+	const uint length = bVertical ? height : width;
+	const uint nLines = bVertical ? width : height;
+	if (id.x >= nLines || id.y >= nSlices) return;
+
+	// compensated, plain float sums drift too far over a whole row for windows that carry almost no weight
+	precise float4 sum = float4(0.0f, 0.0f, 0.0f, 0.0f);
+	precise float4 compensation = float4(0.0f, 0.0f, 0.0f, 0.0f);
+	for (uint i = 0; i < min(radius, length); i++) {
+		precise float4 y = src[GetPos(id.x, i, id.y)] - compensation;
+		precise float4 t = sum + y;
+		compensation = (t - sum) - y;
+		sum = t;
+	}
+	for (uint j = 0; j < length; j++) {
+		float4 delta = float4(0.0f, 0.0f, 0.0f, 0.0f);
+		if (j + radius < length) delta += src[GetPos(id.x, j + radius, id.y)];
+		if (j > radius) delta -= src[GetPos(id.x, j - radius - 1, id.y)];
+
+		precise float4 y = delta - compensation;
+		precise float4 t = sum + y;
+		compensation = (t - sum) - y;
+		sum = t;
+		dst[GetPos(id.x, j, id.y)] = sum;
+	}
+}
\ No newline at end of file
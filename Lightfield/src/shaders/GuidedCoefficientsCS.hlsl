@@ -0,0 +1,44 @@
+// linear model of each window from the boxed moments, output = a . guide + b
+
+Texture2DArray<float4> moments : register(t0);
+RWTexture2DArray<float4> coefficients : register(u0);
+
+cbuffer GuidedFilterBuffer : register(b0) { uint radius; uint bVertical; uint nSlices; float epsilon; };
+
+[numthreads(16, 16, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+	uint width, height, nElements;
+	moments.GetDimensions(width, height, nElements);
+	if (id.x >= width || id.y >= height) return;
+
+	const float4 m0 = moments[uint3(id.xy, 0)]; // w, wI
+	const float4 m1 = moments[uint3(id.xy, 1)]; // wp, wrr, wrg, wrb
+	const float4 m2 = moments[uint3(id.xy, 2)]; // wgg, wgb, wbb, wpr
+	const float4 m3 = moments[uint3(id.xy, 3)]; // wpg, wpb
+
+	// all sums share the window, so normalizing by the weight sum gives weighted means
+	const float invW = 1.0f / m0.x;
+	const float3 mI = m0.yzw * invW;
+	const float mp = m1.x * invW;
+
+	// covariance of the guide with epsilon on the diagonal, and covariance of guide and input
+	const float crr = max(m1.y * invW - mI.r * mI.r, 0.0f) + epsilon;
+	const float crg = m1.z * invW - mI.r * mI.g;
+	const float crb = m1.w * invW - mI.r * mI.b;
+	const float cgg = max(m2.x * invW - mI.g * mI.g, 0.0f) + epsilon;
+	const float cgb = m2.y * invW - mI.g * mI.b;
+	const float cbb = max(m2.z * invW - mI.b * mI.b, 0.0f) + epsilon;
+	const float3 cpI = float3(m2.w, m3.x, m3.y) * invW - mp * mI;
+
+	// symmetric 3x3 solve through the adjugate
+	const float irr = cgg * cbb - cgb * cgb, irg = cgb * crb - crg * cbb, irb = crg * cgb - cgg * crb;
+	const float igg = crr * cbb - crb * crb, igb = crb * crg - crr * cgb, ibb = crr * cgg - crg * crg;
+	const float invDet = 1.0f / (crr * irr + crg * irg + crb * irb);
+	const float3 a = float3(
+		dot(float3(irr, irg, irb), cpI),
+		dot(float3(irg, igg, igb), cpI),
+		dot(float3(irb, igb, ibb), cpI)) * invDet;
+
+	coefficients[uint3(id.xy, 0)] = float4(a, mp - dot(a, mI));
+}
\ No newline at end of file
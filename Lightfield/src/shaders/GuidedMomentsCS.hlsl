@@ -0,0 +1,31 @@
+// first stage of the depth refinement, same weighted guided filter as the cpu GuidedFilter
+// writes the weighted moments of guide (center view) and input (depth) that the box filter sums up per window
+
+Texture2DArray colBuffArr : register(t0);
+Texture2D<float> depthBuffer : register(t1);
+Texture2D<float> confidenceBuffer : register(t2);
+RWTexture2DArray<float4> moments : register(u0);
+
+cbuffer GuidedFilterBuffer : register(b0) { uint radius; uint bVertical; uint nSlices; float epsilon; };
+
+[numthreads(16, 16, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+	uint width, height;
+	depthBuffer.GetDimensions(width, height);
+	if (id.x >= width || id.y >= height) return;
+
+	const float3 I = colBuffArr[uint3(id.xy, 4)].rgb; // center view
+	float p = depthBuffer[id.xy];
+	float w = max(confidenceBuffer[id.xy], 0.0f) + 1e-4f; // weight floor keeps empty windows solvable
+	if (isnan(p) || isinf(p)) {
+		p = 0.0f;
+		w = 1e-4f;
+	}
+
+	// w, wI | wp, wrr, wrg, wrb | wgg, wgb, wbb, wpr | wpg, wpb
+	moments[uint3(id.xy, 0)] = w * float4(1.0f, I);
+	moments[uint3(id.xy, 1)] = w * float4(p, I.r * I.r, I.r * I.g, I.r * I.b);
+	moments[uint3(id.xy, 2)] = w * float4(I.g * I.g, I.g * I.b, I.b * I.b, p * I.r);
+	moments[uint3(id.xy, 3)] = w * float4(p * I.g, p * I.b, 0.0f, 0.0f);
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+// brings depth deduced on the reduced views back to full resolution, same as the cpu DepthUpsampler::Upsample
+// each texel takes the 2x2 reduced texels it lies between, weighted by distance, by how close their color is
+// to its own in the center view and by their confidence, disparities grow with the resolution
+// non-finite taps are left out, a texel without any finite tap gets zero like the deduction of a flat window
+
+#define N_TAPS 2
+#define CENTER_VIEW 4
+
+Texture2DArray colBuffArr : register(t0);
+Texture2DArray reducedViews : register(t1);
+Texture2D<float> reducedDepth : register(t2);
+Texture2D<float> reducedConfidence : register(t3);
+RWTexture2D<float> outputDepth : register(u0);
+RWTexture2D<float> confidence : register(u1); // may be unbound when nothing refines the depth
+
+cbuffer DepthScaleBuffer : register(b0) { uint factor; };
+
+static const float spatialSigma = .5f; // in reduced texels
+static const float rangeSigma = .05f; // of the mean channel difference
+static const float rangeWeightFloor = 1e-4f; // a texel unlike all of its taps falls back to the spatial weights
+static const float confidenceFloor = 1e-3f; // textureless neighbourhoods still get a plain bilateral average
+
+[numthreads(16, 16, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+	uint width, height, nViews;
+	colBuffArr.GetDimensions(width, height, nViews);
+	if (id.x >= width || id.y >= height) return;
+	uint reducedWidth, reducedHeight;
+	reducedDepth.GetDimensions(reducedWidth, reducedHeight);
+
+	const float2 center = (float2(id.xy) + .5f) / float(factor) - .5f;
+	const int2 first = int2(floor(center)) - (N_TAPS / 2 - 1);
+	const int2 reducedMax = int2(reducedWidth, reducedHeight) - 1;
+	const float3 color = colBuffArr[uint3(id.xy, CENTER_VIEW)].rgb;
+
+	float depthSum = 0.0f, depthWeightSum = 0.0f, confidenceSum = 0.0f, weightSum = 0.0f;
+	for (int ty = 0; ty < N_TAPS; ty++) {
+		for (int tx = 0; tx < N_TAPS; tx++) {
+			const uint2 tap = uint2(clamp(first + int2(tx, ty), int2(0, 0), reducedMax));
+			const float tapDepth = reducedDepth[tap];
+			if (isnan(tapDepth) || isinf(tapDepth)) continue;
+			const float2 distance = center - float2(first + int2(tx, ty));
+			const float difference = dot(abs(color - reducedViews[uint3(tap, CENTER_VIEW)].rgb), float3(0.333333f, 0.333333f, 0.333333f));
+			const float spatialWeight = exp(-.5f * dot(distance, distance) / (spatialSigma * spatialSigma));
+			const float rangeWeight = max(exp(-.5f * difference * difference / (rangeSigma * rangeSigma)), rangeWeightFloor);
+			const float weight = spatialWeight * rangeWeight;
+			const float tapConfidence = reducedConfidence[tap];
+			const float depthWeight = weight * (tapConfidence + confidenceFloor);
+			depthSum += depthWeight * tapDepth;
+			depthWeightSum += depthWeight;
+			confidenceSum += weight * tapConfidence;
+			weightSum += weight;
+		}
+	}
+	outputDepth[id.xy] = depthWeightSum > 0.0f ? depthSum / depthWeightSum * float(factor) : 0.0f;
+	confidence[id.xy] = weightSum > 0.0f ? confidenceSum / weightSum : 0.0f;
+}
\ No newline at end of file
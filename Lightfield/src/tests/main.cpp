@@ -0,0 +1,173 @@
+#include "pch.hpp"
+#include "cpu/CpuDepthEngine.hpp"
+#include "cpu/DepthQuery.hpp"
+#include "cpu/HeadlessBackend.hpp"
+
+// consistency checks of the cpu depth paths, run by ctest
+// every check returns false and prints what differs on failure
+namespace
+{
+	// random texture, so every pixel has gradients and mismatches cannot hide in flat regions
+	std::array<Image, CameraGrid::nViews> CreateViews(UINT width, UINT height)
+	{
+		std::mt19937 rng(1u);
+		std::uniform_int_distribution<int> texel(0, UCHAR_MAX);
+		std::array<Image, CameraGrid::nViews> views;
+		for (Image& view : views) {
+			view = { width, height, Image::Format::eBGRA8, std::vector<BYTE>(static_cast<size_t>(width) * height * 4u) };
+			for (BYTE& value : view.data) value = static_cast<BYTE>(texel(rng));
+		}
+		return views;
+	}
+	Image CreateDepth(UINT width, UINT height)
+	{
+		return { width, height, Image::Format::eR32Float, std::vector<BYTE>(static_cast<size_t>(width) * height * sizeof(float)) };
+	}
+	bool Compare(const char* name, const Image& a, const Image& b)
+	{
+		for (UINT y = 0u; y < a.height; y++) {
+			for (UINT x = 0u; x < a.width; x++) {
+				if (a.GetValue(x, y) == b.GetValue(x, y)) continue;
+				std::cerr << name << ": " << a.GetValue(x, y) << " != " << b.GetValue(x, y) << " at " << x << ", " << y << std::endl;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// the fused tiles have to match the separate gradient and deduction passes, borders and clipped tiles included
+	bool TestFusedMatchesUnfused()
+	{
+		bool bPassed = true;
+		for (const auto& size : { std::pair<UINT, UINT>(75u, 41u), std::pair<UINT, UINT>(32u, 32u), std::pair<UINT, UINT>(3u, 2u) }) {
+			const auto [width, height] = size;
+			const std::array<Image, CameraGrid::nViews> images = CreateViews(width, height);
+			std::array<ImageView, CameraGrid::nViews> views;
+			for (UINT i = 0u; i < CameraGrid::nViews; i++) views[i] = images[i];
+
+			CpuDepthEngine engine;
+			Image gradients = { width, height, Image::Format::eR32G32B32A32Float, std::vector<BYTE>(static_cast<size_t>(width) * height * 16u) };
+			Image depth = CreateDepth(width, height), confidence = CreateDepth(width, height);
+			engine.ComputeGradients(views, gradients);
+			engine.DeduceDepth(gradients, depth, &confidence);
+
+			Image fusedDepth = CreateDepth(width, height), fusedConfidence = CreateDepth(width, height);
+			engine.DeduceDepthFused(views, fusedDepth, &fusedConfidence);
+			bPassed &= Compare("Fused depth", fusedDepth, depth) && Compare("Fused confidence", fusedConfidence, confidence);
+		}
+		return bPassed;
+	}
+
+	// rectangles and pixels share one contract: starting outside the frame throws, reaching past its edges clips
+	bool TestQueryBounds()
+	{
+		const UINT width = 75u, height = 41u;
+		const std::array<Image, CameraGrid::nViews> images = CreateViews(width, height);
+		std::array<ImageView, CameraGrid::nViews> views;
+		for (UINT i = 0u; i < CameraGrid::nViews; i++) views[i] = images[i];
+		CpuDepthEngine engine;
+		Image depth = CreateDepth(width, height);
+		engine.DeduceDepthFused(views, depth);
+
+		DepthQuery query;
+		query.BeginFrame(views);
+		const auto throws = [&](auto query) {
+			try {
+				query();
+				return false;
+			}
+			catch (const std::runtime_error&) {
+				return true;
+			}
+		};
+		const DepthQuery::Rect outsideRects[] = { { width, 0u, 1u, 1u }, { 0u, height, 1u, 1u } };
+		const DepthQuery::Pixel outsidePixels[] = { { width, 0u }, { 0u, height } };
+		for (const auto& rect : outsideRects) {
+			if (throws([&] { query.Evaluate(&rect, 1u); })) continue;
+			std::cerr << "Rectangle at " << rect.x << ", " << rect.y << " outside the frame was accepted" << std::endl;
+			return false;
+		}
+		for (const auto& pixel : outsidePixels) {
+			if (throws([&] { query.Evaluate(&pixel, 1u); })) continue;
+			std::cerr << "Pixel at " << pixel.x << ", " << pixel.y << " outside the frame was accepted" << std::endl;
+			return false;
+		}
+
+		// the clipped rectangle covers the bottom right corner, an empty one adds nothing
+		const DepthQuery::Rect rects[] = { { 40u, 20u, 100u, 100u }, { 0u, 0u, 0u, 5u } };
+		query.Evaluate(rects, 2u);
+		for (UINT y = 20u; y < height; y++) {
+			for (UINT x = 40u; x < width; x++) {
+				if (query.GetDepth(x, y) == depth.GetValue(x, y)) continue;
+				std::cerr << "Clipped query: " << query.GetDepth(x, y) << " != " << depth.GetValue(x, y) << " at " << x << ", " << y << std::endl;
+				return false;
+			}
+		}
+		if (query.GetStats().nTilesComputed != 2u * 2u) {
+			std::cerr << "Clipped query computed " << query.GetStats().nTilesComputed << " tiles instead of 4" << std::endl;
+			return false;
+		}
+
+		// a batch with one query outside the frame computes nothing, the valid queries of it still work afterwards
+		const DepthQuery::Rect mixedRects[] = { { 0u, 0u, 10u, 10u }, { width, 0u, 1u, 1u } };
+		const DepthQuery::Pixel mixedPixels[] = { { 5u, 30u }, { 0u, height } };
+		if (!throws([&] { query.Evaluate(mixedRects, 2u); }) || !throws([&] { query.Evaluate(mixedPixels, 2u); })) {
+			std::cerr << "Batch with a query outside the frame was accepted" << std::endl;
+			return false;
+		}
+		query.Evaluate(mixedRects, 1u);
+		query.Evaluate(mixedPixels, 1u);
+		for (UINT y = 0u; y < 10u; y++) {
+			for (UINT x = 0u; x < 10u; x++) {
+				if (query.GetDepth(x, y) == depth.GetValue(x, y)) continue;
+				std::cerr << "Query after a rejected batch: " << query.GetDepth(x, y) << " != " << depth.GetValue(x, y) << " at " << x << ", " << y << std::endl;
+				return false;
+			}
+		}
+		if (query.GetDepth(5u, 30u) != depth.GetValue(5u, 30u)) {
+			std::cerr << "Pixel query after a rejected batch: " << query.GetDepth(5u, 30u) << " != " << depth.GetValue(5u, 30u) << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	// archived views of a rendered capture have to decode bit exact, stripes clipped at the bottom and blocks at the right included
+	bool TestArchiveRoundTrip()
+	{
+		HeadlessBackend backend(75u, 41u);
+		backend.LoadDefaultScene();
+		backend.RequestCapture();
+		backend.RenderFrame();
+		const std::vector<Image> views = backend.CaptureViews();
+		const std::vector<BYTE> archive = LightfieldCodec::Encode(views, backend.Capture(PipelineBackend::CaptureTarget::eOutputDepth), 16u);
+
+		std::vector<Image> decoded;
+		LightfieldCodec::Decode(archive, decoded);
+		if (decoded.size() != views.size()) {
+			std::cerr << "Archive decoded into " << decoded.size() << " views instead of " << views.size() << std::endl;
+			return false;
+		}
+		for (size_t i = 0u; i < views.size(); i++) {
+			if (decoded[i].width == views[i].width && decoded[i].height == views[i].height && decoded[i].format == views[i].format && decoded[i].data == views[i].data) continue;
+			std::cerr << "Archived view " << i << " differs after decoding" << std::endl;
+			return false;
+		}
+		return true;
+	}
+}
+
+int main()
+{
+	const std::pair<const char*, bool(*)()> tests[] = {
+		{ "FusedMatchesUnfused", TestFusedMatchesUnfused },
+		{ "QueryBounds", TestQueryBounds },
+		{ "ArchiveRoundTrip", TestArchiveRoundTrip }
+	};
+	int nFailed = 0;
+	for (const auto& [name, test] : tests) {
+		const bool bPassed = test();
+		std::cout << (bPassed ? "passed " : "FAILED ") << name << std::endl;
+		nFailed += bPassed ? 0 : 1;
+	}
+	return nFailed;
+}
\ No newline at end of file